@@ -0,0 +1,41 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "scheduler.h"
+#include "elm_link.h"
+#include "elm_recovery.h"
+#include "elm_profile.h"
+#include "broadcast.h"
+
+#define BCAST_WINDOW_MS 100
+#define BCAST_STOP_SETTLE_MS 20
+#define ACQ_PROFILE_MISSES_MAX 2 // Answers a tuned profile lost to NO DATA before it is dropped
+
+typedef void (*AcquisitionError_t)(const char *pcJob, int8_t i8Status);
+
+// Runs the scheduled jobs over an ElmLink and publishes the decoded values
+typedef struct
+{
+    Scheduler_t xScheduler;
+    ElmLink_t *pxLink;
+    BroadcastMonitor_t *pxMonitor;
+    ElmRecovery_t xRecovery;
+    BroadcastPublish_t xPublish;
+    AcquisitionError_t xOnError;
+    const HalClock_t *pxClock;
+    uint32_t ulSentUs;   // Of the exchange being published, for latency metrics
+    uint32_t ulParsedUs; // 0 while monitoring, frames are published as they are decoded
+    uint8_t ucProfileMisses;
+    bool bProfileDropped; // Set once the link went back to the ELM327's timeout, for the owner's cache
+} Acquisition_t;
+
+void vAcquisitionInit(Acquisition_t *pxAcquisition, PidSchedule_t *pxJobs, uint8_t ucJobCount, uint8_t ucBatchMax,
+                      ElmLink_t *pxLink, BroadcastMonitor_t *pxMonitor, BroadcastPublish_t xPublish,
+                      AcquisitionError_t xOnError, const HalClock_t *pxClock);
+uint32_t ulAcquisitionStep(Acquisition_t *pxAcquisition);
+bool bAcquisitionReadSupport(Acquisition_t *pxAcquisition);
+bool bAcquisitionCalibrate(Acquisition_t *pxAcquisition, ElmCalibrationResult_t *pxResult);
+
+#endif
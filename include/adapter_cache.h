@@ -0,0 +1,41 @@
+#ifndef ADAPTER_CACHE_H
+#define ADAPTER_CACHE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "elm_link.h"
+
+#define ADAPTER_CACHE_KEY "adapter"
+#define ADAPTER_CACHE_VERSION 2
+#define ADAPTER_ADDRESS_LENGTH 6
+
+// The record as it sits in flash
+typedef struct
+{
+    uint8_t ucVersion;
+    bool bHasAddress;
+    uint8_t ucAddress[ADAPTER_ADDRESS_LENGTH]; // Bluetooth address of the last adapter that answered
+    uint8_t ucProtocol;                        // AT DPN number of the last car, ELM_PROTOCOL_AUTO if unknown
+    bool bHasProfile;
+    ElmProfile_t xProfile; // Kept by the last calibration with this adapter and car
+    uint32_t ulWrites;
+} AdapterRecord_t;
+
+// What the last good connection needed, so the next boot can skip the
+// discovery, the protocol search and the profile calibration. Written only when something changed
+typedef struct
+{
+    const HalKeyValue_t *pxStore;
+    AdapterRecord_t xRecord;
+    bool bLoaded;
+    uint32_t ulFailures;
+} AdapterCache_t;
+
+void vAdapterCacheInit(AdapterCache_t *pxCache, const HalKeyValue_t *pxKeyValue);
+bool bAdapterCacheLoad(AdapterCache_t *pxCache);
+bool bAdapterCacheSetAddress(AdapterCache_t *pxCache, const uint8_t *pucAddress);
+bool bAdapterCacheSetProtocol(AdapterCache_t *pxCache, uint8_t ucProtocol);
+bool bAdapterCacheSetProfile(AdapterCache_t *pxCache, const ElmProfile_t *pxProfile);
+bool bAdapterCacheClearProfile(AdapterCache_t *pxCache);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+#include "hal.h"
+
+#define BOOT_STAGE_MAX 16
+#define BOOT_STAGE_NONE (-1)
+
+typedef struct
+{
+    const char *pcName;
+    uint32_t ulStartUs;
+    uint32_t ulEndUs; // 0 while it runs
+} BootStage_t;
+
+// Start and end of each startup stage, and when the first boost value was
+// published. Times are from the clock's zero, the application start on the
+// ESP32, so the ROM and second stage bootloaders are not included
+typedef struct
+{
+    const HalClock_t *pxClock;
+    BootStage_t xStages[BOOT_STAGE_MAX];
+    uint8_t ucCount; // Slots taken, may exceed BOOT_STAGE_MAX
+    uint32_t ulFirstReadingUs; // 0 until then
+} BootProfile_t;
+
+void vBootProfileInit(BootProfile_t *pxProfile, const HalClock_t *pxClock);
+int8_t i8BootProfileBegin(BootProfile_t *pxProfile, const char *pcName);
+void vBootProfileEnd(BootProfile_t *pxProfile, int8_t i8Stage);
+bool bBootProfileFirstReading(BootProfile_t *pxProfile);
+
+#endif
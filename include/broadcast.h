@@ -0,0 +1,37 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "can_decoder.h"
+
+#define BCAST_MAX_IDS 8
+
+// A value carried in a non-OBD CAN frame that ECUs broadcast on their own
+typedef struct
+{
+    uint16_t ui16CanId;
+    SignalDef_t xSignal;
+} BroadcastSignal_t;
+
+typedef void (*BroadcastPublish_t)(uint8_t ucChannel, float fValue);
+
+typedef struct
+{
+    const BroadcastSignal_t *pxSignals;
+    uint8_t ucSignalCount;
+    uint16_t ui16Ids[BCAST_MAX_IDS];
+    uint8_t ucIdCount;
+    uint8_t ucSeenMask;
+    uint32_t ulWindows;
+    uint32_t ulFrames;
+    uint32_t ulRejectedLines;
+} BroadcastMonitor_t;
+
+void vBroadcastInit(BroadcastMonitor_t *pxMonitor, const BroadcastSignal_t *pxSignals, uint8_t ucSignalCount);
+void vBroadcastBuildReceiveAddress(const BroadcastMonitor_t *pxMonitor, char *pcPattern);
+bool bBroadcastNeedsHeaders(const BroadcastMonitor_t *pxMonitor);
+void vBroadcastStartWindow(BroadcastMonitor_t *pxMonitor);
+bool bBroadcastFeedLine(BroadcastMonitor_t *pxMonitor, const char *pcLine, size_t xLength, bool bHeaders, BroadcastPublish_t xPublish);
+
+#endif
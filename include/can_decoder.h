@@ -0,0 +1,67 @@
+#ifndef CAN_DECODER_H
+#define CAN_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CAN_NO_ID 0xFFFF
+#define CAN_NO_INDEX (-1)
+#define CAN_FRAME_BYTES 8
+#define ISOTP_PAYLOAD_MAX 48
+
+extern const int8_t cHexLut[256];
+
+typedef enum
+{
+    DECODE_OK,
+    DECODE_NOT_DATA,     // Echo, status text or prompt
+    DECODE_BAD_LENGTH,   // Odd digit count, or PCI length does not match
+    DECODE_BAD_SEQUENCE, // Missing or repeated consecutive frame
+    DECODE_OVERFLOW      // More bytes than a frame or message can hold
+} DecodeResult_t;
+
+// One ELM output line. With headers off (AT H0) ui16Id is CAN_NO_ID. Multi
+// frame answers printed with AT CAF1 H0 carry a "N:" index, and are preceded
+// by a 3 digit line with the message length in ui16MessageLength
+typedef struct
+{
+    uint16_t ui16Id;
+    int8_t cIndex;
+    uint16_t ui16MessageLength;
+    uint8_t ucLength;
+    uint8_t ucData[CAN_FRAME_BYTES];
+} CanFrame_t;
+
+// A value inside a payload. Raw bytes are big endian:
+// fValue = raw * fScale + fOffset
+typedef struct
+{
+    uint8_t ucChannel;
+    uint8_t ucByteOffset;
+    uint8_t ucLength;
+    bool bSigned;
+    float fScale;
+    float fOffset;
+} SignalDef_t;
+
+// ISO-TP reassembly of a Mode 01 answer from either output format
+typedef struct
+{
+    uint16_t ui16Id;
+    uint16_t ui16Expected;
+    uint8_t ucLength;
+    uint8_t ucNextIndex;
+    bool bStarted;
+    DecodeResult_t xError;
+    uint8_t ucPayload[ISOTP_PAYLOAD_MAX];
+} IsoTpMessage_t;
+
+DecodeResult_t xCanParseLine(const char *pcLine, size_t xLength, bool bHeaders, CanFrame_t *pxFrame);
+bool bSignalExtract(const SignalDef_t *pxSignal, const uint8_t *pucData, uint8_t ucLength, float *pfValue);
+
+void vIsoTpStart(IsoTpMessage_t *pxMessage);
+DecodeResult_t xIsoTpFeedLine(IsoTpMessage_t *pxMessage, const char *pcLine, size_t xLength, bool bHeaders);
+bool bIsoTpComplete(const IsoTpMessage_t *pxMessage);
+uint8_t ucIsoTpPayloadLength(const IsoTpMessage_t *pxMessage);
+
+#endif
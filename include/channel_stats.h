@@ -0,0 +1,67 @@
+#ifndef CHANNEL_STATS_H
+#define CHANNEL_STATS_H
+
+#include <stdint.h>
+#include <float.h>
+
+#define STATS_WINDOW_SAMPLES 64    // Per deque, a 3 s window at 20 Hz needs 60
+#define STATS_NO_THRESHOLD FLT_MAX // Time above it is never counted
+
+// How one channel's derived values follow its samples
+typedef struct
+{
+    uint32_t ulWindowMs;  // Of the rolling min and max
+    uint32_t ulAverageMs; // EWMA time constant
+    uint32_t ulHoldMs;    // The peak is held this long, then decays
+    float fDecayPerS;     // Units per second, never below the current value
+    float fThreshold;     // Time above it is counted
+} ChannelStatsConfig_t;
+
+// What readers see, small enough to be copied with every telemetry snapshot
+typedef struct
+{
+    float fMin; // Over the last ulWindowMs
+    float fMax;
+    float fAverage;
+    float fPeak;
+    uint32_t ulAboveMs; // Since the last reset
+} ChannelSummary_t;
+
+typedef struct
+{
+    float fValue;
+    uint32_t ulTimeMs;
+} StatsEntry_t;
+
+// Ring of samples kept in order of their value: the front is the window's
+// extreme, and a new sample drops every entry behind it that it beats, as
+// those can never be the extreme again
+typedef struct
+{
+    StatsEntry_t xEntries[STATS_WINDOW_SAMPLES];
+    uint8_t ucFront;
+    uint8_t ucCount;
+} StatsDeque_t;
+
+// Writer side state of one channel, updated in O(1) amortized per sample in
+// fixed buffers. A full deque drops its oldest entry, which only shortens the
+// window when the rate is above STATS_WINDOW_SAMPLES per window
+typedef struct
+{
+    const ChannelStatsConfig_t *pxConfig;
+    StatsDeque_t xMin;
+    StatsDeque_t xMax;
+    float fAverage;
+    float fHeld;      // Last value the peak was set to
+    uint32_t ulHeldMs;
+    float fLast;
+    uint32_t ulLastMs;
+    bool bStarted;
+    uint32_t ulAboveMs;
+} ChannelStats_t;
+
+void vChannelStatsInit(ChannelStats_t *pxStats, const ChannelStatsConfig_t *pxConfig);
+void vChannelStatsReset(ChannelStats_t *pxStats);
+void vChannelStatsAdd(ChannelStats_t *pxStats, float fValue, uint32_t ulNowMs, ChannelSummary_t *pxSummary);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <stdint.h>
+
+#define CHANNEL_NONE 0xFF // Decoded, but no gauge shows it
+
+// Every value shown on the display
+typedef enum
+{
+    CHANNEL_BOOST,
+    CHANNEL_IAT,
+    CHANNEL_OIL,
+    CHANNEL_COOLANT,
+    CHANNEL_TIMING,
+    CHANNEL_HPFP,
+    CHANNEL_COUNT
+} Channel_t;
+
+const char *pcChannelName(uint8_t ucChannel);
+
+#endif
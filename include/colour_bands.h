@@ -0,0 +1,51 @@
+#ifndef COLOUR_BANDS_H
+#define COLOUR_BANDS_H
+
+#include <stdint.h>
+
+// One colour from i16From upwards, up to the next band's i16From
+template <int16_t From, uint16_t Colour> struct ColourBand
+{
+    static constexpr int16_t i16From = From;
+    static constexpr uint16_t ui16Colour = Colour;
+};
+
+template <int16_t Previous, typename... Bands> struct ColourBandIndex;
+
+template <int16_t Previous> struct ColourBandIndex<Previous>
+{
+    static constexpr uint8_t ucOf(int16_t)
+    {
+        return 0;
+    }
+};
+
+// The number of bands the value reaches, summed from the compares without
+// branching on them
+template <int16_t Previous, typename Band, typename... Rest> struct ColourBandIndex<Previous, Band, Rest...>
+{
+    static_assert(Band::i16From > Previous, "colour bands must be in ascending order");
+
+    static constexpr uint8_t ucOf(int16_t i16Value)
+    {
+        return (uint8_t)(i16Value >= Band::i16From) + ColourBandIndex<Band::i16From, Rest...>::ucOf(i16Value);
+    }
+};
+
+// Colour of a value: Base below the first band, e.g.
+//   typedef ColourBands<WHITE, ColourBand<40, YELLOW>, ColourBand<60, RED>> IATColour_t;
+// The band index picks from a table, and IATColour_t::ui16Of fits the layout
+// table's colour pointer
+template <uint16_t Base, typename... Bands> struct ColourBands
+{
+    static constexpr uint16_t ui16Colours[sizeof...(Bands) + 1] = {Base, Bands::ui16Colour...};
+
+    static constexpr uint16_t ui16Of(int16_t i16Value)
+    {
+        return ui16Colours[ColourBandIndex<INT16_MIN, Bands...>::ucOf(i16Value)];
+    }
+};
+
+template <uint16_t Base, typename... Bands> constexpr uint16_t ColourBands<Base, Bands...>::ui16Colours[sizeof...(Bands) + 1];
+
+#endif
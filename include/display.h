@@ -0,0 +1,81 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+#include "hal.h"
+
+#define DISPLAY_WIDTH 130
+#define DISPLAY_HEIGHT 130
+#define DISPLAY_BACK_COLOUR 0x0000
+#define DISPLAY_CENTER 9998 // Same value as LCDWIKI_GUI's CENTER
+
+#define FIELD_WIDTH_MAX 6 // Characters
+#define GLYPH_COLUMNS 6   // 5x7 font plus one column of spacing
+#define GLYPH_ROWS 8
+#define GLYPH_SIZE_MAX 5
+
+#define BAR_WIDTH_MAX 8
+#define BAR_HEIGHT_MAX 64
+
+#define RENDER_HISTOGRAM_BUCKETS 8 // <250 us, <500 us, ... doubling, last is open ended
+#define RENDER_HISTOGRAM_FIRST_US 250
+
+// A fixed text box on screen that remembers what it shows, so a redraw only
+// repaints the characters that differ
+typedef struct
+{
+    int16_t i16X;
+    int16_t i16Y;
+    uint8_t ucSize;
+    uint8_t ucWidth;
+    char cText[FIELD_WIDTH_MAX + 1];
+    uint16_t ui16Colour;
+    bool bDrawn;
+} DisplayField_t;
+
+// A vertical bar growing from the bottom of its box that remembers how far
+// it is filled, so a redraw only repaints the rows between the old and the
+// new level. Every row keeps the colour of the value it stands for, so the
+// filled part never needs repainting when the value moves
+typedef struct
+{
+    int16_t i16X;
+    int16_t i16Y; // Top row
+    uint8_t ucWidth;
+    uint8_t ucHeight;
+    float fMin; // Empty at or below
+    float fMax; // Full at or above
+    uint16_t ui16RowColour[BAR_HEIGHT_MAX]; // From the bottom
+    uint16_t ui16MarkerColour;
+    uint8_t ucLevel;   // Filled rows
+    int16_t i16Marker; // Row of the marker, -1 for none
+    bool bDrawn;
+} DisplayBar_t;
+
+typedef struct
+{
+    uint32_t ulBytesPushed;
+    uint32_t ulGlyphsDrawn;
+    uint32_t ulGlyphsSkipped;
+    uint32_t ulFieldsSkipped;
+    uint32_t ulCacheHits;
+    uint32_t ulCacheMisses;
+    uint32_t ulRenderHistogram[RENDER_HISTOGRAM_BUCKETS];
+} DisplayStats_t;
+
+void vDisplayInit(const HalSurface_t *pxSurface, uint32_t (*pxMicros)(void));
+
+void vFieldInit(DisplayField_t *pxField, int16_t i16X, int16_t i16Y, uint8_t ucSize, uint8_t ucWidth);
+void vFieldInvalidate(DisplayField_t *pxField);
+void vFieldDrawText(DisplayField_t *pxField, const char *pcText, uint16_t ui16Colour);
+void vFieldDrawInt(DisplayField_t *pxField, int32_t i32Value, uint16_t ui16Colour);
+void vFieldDrawFloat(DisplayField_t *pxField, float fValue, uint8_t ucDecimals, uint16_t ui16Colour);
+
+void vBarInit(DisplayBar_t *pxBar, int16_t i16X, int16_t i16Y, uint8_t ucWidth, uint8_t ucHeight, float fMin, float fMax,
+              uint16_t (*pxColour)(int16_t), uint16_t ui16MarkerColour);
+void vBarInvalidate(DisplayBar_t *pxBar);
+void vBarDraw(DisplayBar_t *pxBar, float fValue, float fMarker);
+
+DisplayStats_t xDisplayTakeStats(void);
+
+#endif
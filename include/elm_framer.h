@@ -0,0 +1,56 @@
+#ifndef ELM_FRAMER_H
+#define ELM_FRAMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ELM_RING_SIZE 1024 // Must be a power of two
+#define ELM_LINE_MAX 96
+
+// Single producer (Bluetooth SPP callback), single consumer (link owner)
+// byte ring. Indexes are free running and masked on access
+typedef struct
+{
+    char cData[ELM_RING_SIZE];
+    uint32_t ulHead;
+    uint32_t ulTail;
+    uint32_t ulDropped;
+} ElmRing_t;
+
+typedef enum
+{
+    ELM_FRAME_NONE,
+    ELM_FRAME_LINE,
+    ELM_FRAME_PROMPT
+} ElmFrameEvent_t;
+
+// A response line without its terminator. It points into the ring and stays
+// valid until the next call to xElmFramerNext
+typedef struct
+{
+    const char *pcData;
+    uint16_t ui16Length;
+} ElmLine_t;
+
+typedef struct
+{
+    ElmRing_t *pxRing;
+    uint32_t ulLineStart;
+    uint32_t ulScan;
+    char cScratch[ELM_LINE_MAX];
+    uint32_t ulLines;
+    uint32_t ulWrappedLines;
+    uint32_t ulTruncatedLines;
+} ElmFramer_t;
+
+void vElmRingInit(ElmRing_t *pxRing);
+size_t xElmRingWrite(ElmRing_t *pxRing, const uint8_t *pucData, size_t xLength);
+
+void vElmFramerInit(ElmFramer_t *pxFramer, ElmRing_t *pxRing);
+void vElmFramerDiscard(ElmFramer_t *pxFramer);
+ElmFrameEvent_t xElmFramerNext(ElmFramer_t *pxFramer, ElmLine_t *pxLine);
+
+bool bElmLineEquals(const ElmLine_t *pxLine, const char *pcText);
+bool bElmLineContains(const ElmLine_t *pxLine, const char *pcText);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef ELM_LINK_H
+#define ELM_LINK_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "elm_framer.h"
+#include "obd.h"
+#include "broadcast.h"
+
+#define ELM_RESPONSE_TIMEOUT_MS 500
+#define ELM_COMMAND_MAX 24
+#define ELM_RESET_TIMEOUT_MS 1500 // AT Z to prompt, about 1 s on a genuine ELM327
+#define ELM_PROTOCOL_AUTO 0
+#define ELM_TIMEOUT_DEFAULT 0x32 // AT ST in 4 ms units, the ELM327's own 200 ms
+#define ELM_TIMING_DEFAULT 1     // AT AT1
+
+// Same values as ELMduino's status codes, so logs read the same
+typedef enum
+{
+    ELM_STATUS_SUCCESS = 0,
+    ELM_STATUS_NO_RESPONSE = 1,
+    ELM_STATUS_BUFFER_OVERFLOW = 2,
+    ELM_STATUS_UNABLE_TO_CONNECT = 4,
+    ELM_STATUS_NO_DATA = 5,
+    ELM_STATUS_STOPPED = 6,
+    ELM_STATUS_TIMEOUT = 7
+} ElmStatus_t;
+
+// How the ELM327 decides an answer is complete. Without a response count it
+// waits for the AT ST timeout after the last frame, shortened by adaptive
+// timing (AT AT1/AT2) once it has seen the ECU's answer times
+typedef struct
+{
+    uint8_t ucAdaptiveTiming; // AT AT0 to AT AT2
+    uint8_t ucTimeout;        // AT ST, 4 ms units
+    bool bResponseCount;      // Mode 01 requests end with the expected frame count
+} ElmProfile_t;
+
+// The OBD client: request/response exchanges with the ELM327 over a
+// transport. Only one task may use a link at a time
+typedef struct
+{
+    const HalTransport_t *pxTransport;
+    const HalClock_t *pxClock;
+    ElmRing_t xRing;
+    ElmFramer_t xFramer;
+    bool bHeaders; // Mirrors AT H0/H1 for the OBD response decoder
+    ElmProfile_t xProfile;
+    int8_t i8Status;
+} ElmLink_t;
+
+void vElmLinkInit(ElmLink_t *pxLink, const HalTransport_t *pxTransport, const HalClock_t *pxClock);
+void vElmLinkReceive(ElmLink_t *pxLink, const uint8_t *pucData, size_t xLength);
+
+void vElmLinkSend(ElmLink_t *pxLink, const char *pcCommand);
+void vElmLinkFlush(ElmLink_t *pxLink);
+ElmFrameEvent_t xElmLinkReadFrame(ElmLink_t *pxLink, ElmLine_t *pxLine, uint32_t ulStart, uint32_t ulTimeoutMs);
+bool bElmLinkWaitForPrompt(ElmLink_t *pxLink, uint32_t ulTimeoutMs);
+bool bElmLinkWaitForOK(ElmLink_t *pxLink);
+bool bElmLinkCommand(ElmLink_t *pxLink, const char *pcCommand);
+
+bool bElmLinkReadPids(ElmLink_t *pxLink, const uint8_t *pucPids, ObdPidValue_t *pxValues, uint8_t ucCount);
+bool bElmLinkReadSupport(ElmLink_t *pxLink, uint8_t *pucSupported);
+bool bElmLinkMonitorBroadcast(ElmLink_t *pxLink, BroadcastMonitor_t *pxMonitor, BroadcastPublish_t xPublish,
+                              uint32_t ulWindowMs, uint32_t ulSettleMs);
+bool bElmLinkResync(ElmLink_t *pxLink);
+bool bElmLinkReopen(ElmLink_t *pxLink);
+bool bElmLinkPollPrompt(ElmLink_t *pxLink);
+
+bool bElmLinkStart(ElmLink_t *pxLink, uint8_t ucProtocol);
+bool bElmLinkConfigure(ElmLink_t *pxLink, uint8_t ucProtocol);
+bool bElmLinkApplyProfile(ElmLink_t *pxLink, const ElmProfile_t *pxProfile);
+bool bElmLinkSelectProtocol(ElmLink_t *pxLink, uint8_t ucProtocol);
+int8_t i8ElmLinkProtocol(ElmLink_t *pxLink);
+
+int8_t i8ElmLineStatus(const ElmLine_t *pxLine);
+const char *pcElmStatusName(int8_t i8Status);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef ELM_PROFILE_H
+#define ELM_PROFILE_H
+
+#include <stdint.h>
+#include "elm_link.h"
+
+#define ELM_CALIBRATION_CANDIDATES 5
+#define ELM_CALIBRATION_SAMPLES 10
+#define ELM_TIMEOUT_MARGIN_PERCENT 150       // Tuned AT ST over the slowest answer seen
+#define ELM_TIMEOUT_FIXED_MARGIN_PERCENT 250 // The same with adaptive timing off, where AT ST alone ends a late answer
+#define ELM_TIMEOUT_MIN 0x04                 // 16 ms
+#define ELM_FIXED_GAIN_PERCENT 10            // Adaptive timing is only turned off for at least this much faster
+
+// One profile's measured round trips over the calibration batch
+typedef struct
+{
+    ElmProfile_t xProfile;
+    uint32_t ulMeanUs;
+    uint32_t ulWorstUs;
+    uint8_t ucFailures;
+    bool bMeasured;
+} ElmCalibration_t;
+
+// The candidates in the order they were tried and the one kept, or -1 when
+// none answered every request
+typedef struct
+{
+    ElmCalibration_t xCandidates[ELM_CALIBRATION_CANDIDATES];
+    uint8_t ucCount;
+    int8_t i8Chosen;
+} ElmCalibrationResult_t;
+
+bool bElmProfileTuned(const ElmProfile_t *pxProfile);
+bool bElmProfileCalibrate(ElmLink_t *pxLink, const uint8_t *pucPids, uint8_t ucCount, ElmCalibrationResult_t *pxResult);
+
+#endif
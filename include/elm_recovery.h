@@ -0,0 +1,50 @@
+#ifndef ELM_RECOVERY_H
+#define ELM_RECOVERY_H
+
+#include <stdint.h>
+#include "elm_link.h"
+
+#define ELM_RECOVERY_RESET_BACKOFF_MS 2000      // First wait between two resets
+#define ELM_RECOVERY_RESET_BACKOFF_MAX_MS 60000
+#define ELM_RECOVERY_POLL_MS 20                 // While the ELM327 is resetting
+
+// Cheapest first. Each failed exchange in a row goes one tier further, a
+// success starts over
+typedef enum
+{
+    ELM_RECOVERY_RETRY,    // Nothing sent, the next request is the retry
+    ELM_RECOVERY_RESYNC,   // Stop whatever runs and wait for the prompt
+    ELM_RECOVERY_PROTOCOL, // Close the protocol and restore the OBD settings
+    ELM_RECOVERY_RESET,    // AT Z, then the protocol again
+    ELM_RECOVERY_TIER_COUNT
+} ElmRecoveryTier_t;
+
+#define ELM_RECOVERY_NONE (-1)
+
+// Runs from the acquisition step, one action per step, so the link lock is
+// released in between and nothing waits for the reset: after AT Z the step
+// only polls for the prompt. Resets back off exponentially; when one is not
+// due yet the protocol tier runs instead
+typedef struct
+{
+    uint8_t ucProtocol; // Selected again after a reset
+    uint8_t ucLinkFailures;
+    int8_t i8Pending; // ElmRecoveryTier_t, or ELM_RECOVERY_NONE
+    bool bResetting;
+    uint32_t ulResetSentMs;
+    uint32_t ulResetBackoffMs;
+    uint32_t ulNextResetMs;
+
+    uint32_t ulCount[ELM_RECOVERY_TIER_COUNT];
+    uint32_t ulLinkUs[ELM_RECOVERY_TIER_COUNT]; // Time the link spent on each tier
+    uint32_t ulResetTimeouts;
+} ElmRecovery_t;
+
+void vElmRecoveryInit(ElmRecovery_t *pxRecovery, uint8_t ucProtocol, uint32_t ulNowMs);
+void vElmRecoveryFailed(ElmRecovery_t *pxRecovery, int8_t i8Status, uint32_t ulNowMs);
+void vElmRecoverySucceeded(ElmRecovery_t *pxRecovery);
+bool bElmRecoveryActive(const ElmRecovery_t *pxRecovery);
+uint32_t ulElmRecoveryStep(ElmRecovery_t *pxRecovery, ElmLink_t *pxLink);
+const char *pcElmRecoveryTierName(uint8_t ucTier);
+
+#endif
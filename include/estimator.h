@@ -0,0 +1,56 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+#define ESTIMATOR_FRAME_MS 40 // 25 Hz while an estimate is moving
+
+// Alpha-beta tracking of one channel. The estimate runs ahead of the last
+// sample for one and a half sample intervals, up to ulHorizonMs, but stays
+// within fMargin of the last two samples and inside the channel's valid
+// range, so it never shows a value far from anything measured. A channel
+// with ulHorizonMs 0 is shown as sampled
+typedef struct
+{
+    float fAlpha;         // Share of the prediction error taken into the value, 1 shows every sample as is
+    float fBeta;          // Share taken into the rate
+    float fMaxRatePerS;   // Bounds the rate, so one noisy sample cannot fling the readout
+    uint32_t ulHorizonMs; // Extrapolated at most this long after a sample, then held
+    float fMargin;        // Beyond the span of the last two samples
+    float fMin;           // Valid range of the channel
+    float fMax;
+} EstimatorConfig_t;
+
+typedef struct
+{
+    const EstimatorConfig_t *pxConfig;
+    float fValue; // At ulSampleMs
+    float fRate;  // Per ms
+    uint32_t ulSampleMs;
+    uint32_t ulIntervalMs; // Between the last two samples
+    float fLastSample;
+    float fLow; // Bounds of the estimate
+    float fHigh;
+    bool bStarted;
+} Estimator_t;
+
+// The reader side of the telemetry store: one estimator per channel, fed
+// with the samples found in the snapshots. The estimates also stay at or
+// below the max shown next to them
+typedef struct
+{
+    Estimator_t xEstimators[CHANNEL_COUNT];
+    uint32_t ulLastSampleMs[CHANNEL_COUNT];
+    float fLastSample[CHANNEL_COUNT]; // Two samples can share a millisecond
+} EstimatorBank_t;
+
+void vEstimatorInit(Estimator_t *pxEstimator, const EstimatorConfig_t *pxConfig);
+void vEstimatorUpdate(Estimator_t *pxEstimator, float fMeasured, uint32_t ulSampleMs);
+float fEstimatorAt(const Estimator_t *pxEstimator, uint32_t ulNowMs);
+bool bEstimatorMoving(const Estimator_t *pxEstimator, uint32_t ulNowMs);
+
+void vEstimatorBankInit(EstimatorBank_t *pxBank, const EstimatorConfig_t *pxConfigs);
+uint32_t ulEstimatorBankApply(EstimatorBank_t *pxBank, TelemetrySnapshot_t *pxSnapshot, uint32_t ulNowMs);
+
+#endif
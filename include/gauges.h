@@ -0,0 +1,29 @@
+#ifndef GAUGES_H
+#define GAUGES_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "telemetry.h"
+#include "layout.h"
+
+#define BLACK 0x0000
+#define CYAN 0x07FF
+#define WHITE 0xFFFF
+#define YELLOW 0xFFE0
+#define ORANGE 0xF900
+#define RED 0xF800
+#define MAGENTA 0xF81F
+
+#define BOOST_RESET_VALUE 99 // kPa, the max is shown once there was boost
+#define TEMP_MIN_VALUE -40   // Lowest temperature the OBD and broadcast encodings carry
+#define TEMP_MAX_VALUE 126
+
+#define GAUGES_CHANNEL_BIT(channel) ((uint32_t)1 << (channel))
+
+void vGaugesInit(const HalSurface_t *pxSurface, const HalClock_t *pxClock);
+void vGaugesSetLayout(uint8_t ucLayout);
+const Layout_t *pxGaugesLayout(void);
+void vGaugesInvalidate(void);
+void vGaugesRender(const TelemetrySnapshot_t *pxSnapshot, uint32_t ulChannelMask);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Thin interfaces to the hardware. The acquisition, decoding and rendering
+// code only talks to these, so it builds for the ESP32 as well as for the
+// host (env:native) against fakes
+
+typedef struct
+{
+    uint32_t (*ulMillis)(void);
+    uint32_t (*ulMicros)(void);
+} HalClock_t;
+
+// Byte stream to the ELM327. Whoever owns the transport hands received bytes
+// to vElmLinkReceive
+typedef struct
+{
+    void *pvContext;
+    size_t (*xWrite)(void *pvContext, const char *pcData, size_t xLength);
+    // Returns when new bytes arrived or after ulTimeoutMs, whichever is first
+    void (*vWaitForData)(void *pvContext, uint32_t ulTimeoutMs);
+} HalTransport_t;
+
+// RGB565 window writes, as used by the field renderer
+typedef struct
+{
+    void *pvContext;
+    void (*vSetWindow)(void *pvContext, int16_t i16X1, int16_t i16Y1, int16_t i16X2, int16_t i16Y2);
+    void (*vPushPixels)(void *pvContext, const uint16_t *pui16Pixels, uint32_t ulCount, bool bFirst);
+} HalSurface_t;
+
+typedef struct
+{
+    void *pvContext;
+    bool (*bIsPressed)(void *pvContext);
+} HalInput_t;
+
+// A file on the flash filesystem. xAppend returns the bytes stored, less
+// than xLength when it is full; xRead reads on from the start and returns
+// less at the end. Either may be NULL when the file is only used one way
+typedef struct
+{
+    void *pvContext;
+    size_t (*xAppend)(void *pvContext, const uint8_t *pucData, size_t xLength);
+    size_t (*xRead)(void *pvContext, uint8_t *pucData, size_t xLength);
+} HalStorage_t;
+
+// Small records that survive a power cycle, e.g. NVS blobs. bStore returns
+// once the record is committed
+typedef struct
+{
+    void *pvContext;
+    bool (*bLoad)(void *pvContext, const char *pcKey, void *pvData, size_t xLength);
+    bool (*bStore)(void *pvContext, const char *pcKey, const void *pvData, size_t xLength);
+} HalKeyValue_t;
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include "hal.h"
+
+#define INPUT_POLL_MS 30
+#define INPUT_HOLD_TICK_MS 100
+#define INPUT_RESET_TICKS 5 // Hold time, in INPUT_HOLD_TICK_MS, that resets the max values
+
+typedef enum
+{
+    INPUT_EVENT_NONE,
+    INPUT_EVENT_HELD, // Poll again after INPUT_HOLD_TICK_MS
+    INPUT_EVENT_RESET
+} InputEvent_t;
+
+typedef struct
+{
+    const HalInput_t *pxInput;
+    uint16_t ui16HeldTicks;
+} InputButton_t;
+
+void vInputInit(InputButton_t *pxButton, const HalInput_t *pxInput);
+InputEvent_t xInputPoll(InputButton_t *pxButton);
+
+#endif
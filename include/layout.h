@@ -0,0 +1,68 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include "channels.h"
+
+#define LAYOUT_WIDGETS_MAX 24
+
+// What a layout entry draws. Values, max values and bars follow a channel;
+// the rest is drawn once with the screen
+typedef enum
+{
+    WIDGET_VALUE, // Keeps the last good value when a sample is out of range
+    WIDGET_MAX,   // Blank until the max is in range
+    WIDGET_BAR,   // Filled to the value, the held peak marked
+    WIDGET_LABEL,
+    WIDGET_LINE,
+    WIDGET_FRAME,
+} WidgetKind_t;
+
+// How a channel's value becomes text. The value is taken in whole units,
+// (value - i32Zero) / i32Divisor is shown with ucDecimals, and for
+// bClampZero values below i32Zero show as 0
+typedef struct
+{
+    int32_t i32ValidMin; // Values outside are not drawn
+    int32_t i32ValidMax;
+    int32_t i32Zero;
+    int32_t i32Divisor;
+    uint8_t ucDecimals;
+    bool bClampZero;
+} WidgetFormat_t;
+
+typedef struct
+{
+    uint8_t ucKind;
+    uint8_t ucChannel;
+    int16_t i16X; // DISPLAY_CENTER centres text
+    int16_t i16Y;
+    int16_t i16Width;  // Characters for text, pixels (minus one for lines and frames) otherwise
+    int16_t i16Height; // Text size for text, pixels otherwise
+    const WidgetFormat_t *pxFormat;
+    uint16_t (*pxColour)(int16_t i16Value); // Of a value, in whole units
+    uint16_t ui16Colour;                    // Labels, lines and bar markers
+    const char *pcText;
+} LayoutWidget_t;
+
+typedef struct
+{
+    const char *pcName;
+    const LayoutWidget_t *pxWidgets;
+    uint8_t ucCount;
+} Layout_t;
+
+typedef enum
+{
+    LAYOUT_STREET,
+    LAYOUT_TRACK,
+    LAYOUT_DIAGNOSTICS,
+    LAYOUT_COUNT
+} LayoutId_t;
+
+extern const Layout_t xLayouts[LAYOUT_COUNT];
+
+int8_t i8LayoutFind(const char *pcName);
+const LayoutWidget_t *pxLayoutWidget(const Layout_t *pxLayout, uint8_t ucKind, uint8_t ucChannel);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal.h"
+#include "channels.h"
+
+// Session log layout:
+//   file header: "CPDL", version, channel count, block size (LE16)
+//   blocks of LOGGER_BLOCK_SIZE bytes, padded with 0xFF:
+//     start time in ms (LE32), bytes used including this header (LE16)
+//     records: channel, varint ms since the previous record, zigzag varint
+//     of the change in value * LOGGER_SCALE since the channel's previous
+//     record in the same block
+// Every block decodes on its own, so a torn write only loses that block
+#define LOGGER_MAGIC "CPDL"
+#define LOGGER_VERSION 1
+#define LOGGER_FILE_HEADER_SIZE 8
+#define LOGGER_BLOCK_HEADER_SIZE 6
+#define LOGGER_BLOCK_SIZE 512
+#define LOGGER_BLOCK_COUNT 16          // RAM ring, about a minute of samples at the full poll rate
+#define LOGGER_BLOCK_MAX_AGE_MS 10000 // Bounds what a power cut loses
+#define LOGGER_SCALE 100               // Values are stored with 0.01 resolution
+#define LOGGER_RECORD_MAX 11           // Channel plus two 5 byte varints
+
+// Single producer (the acquisition task) fills blocks in RAM, single consumer
+// (a low priority writer task) stores the sealed ones. A full ring drops
+// samples instead of blocking the producer
+typedef struct
+{
+    uint8_t ucBlocks[LOGGER_BLOCK_COUNT][LOGGER_BLOCK_SIZE];
+    uint32_t ulSealed;  // Blocks handed to the writer, producer owned
+    uint32_t ulWritten; // Blocks stored, consumer owned
+    uint16_t ui16Used;  // Bytes in the open block, 0 if none is open
+    uint32_t ulBlockStartMs;
+    uint32_t ulLastMs;
+    int32_t i32Last[CHANNEL_COUNT];
+    const HalStorage_t *pxStorage;
+    bool bFileHeaderWritten;
+    uint32_t ulSamples;
+    uint32_t ulDropped;
+    uint32_t ulWriteErrors;
+} Logger_t;
+
+typedef struct
+{
+    uint32_t ulTimestampMs;
+    uint8_t ucChannel;
+    float fValue;
+} LogSample_t;
+
+// Reads a log back one block at a time, so it works from flash as well
+typedef struct
+{
+    const HalStorage_t *pxStorage;
+    uint8_t ucBlock[LOGGER_BLOCK_SIZE];
+    uint16_t ui16BlockSize;
+    uint8_t ucChannelCount;
+    uint16_t ui16Offset; // Next record in ucBlock
+    uint16_t ui16End;    // End of its records
+    uint32_t ulTimestampMs;
+    int32_t i32Last[UINT8_MAX + 1];
+    uint32_t ulBlocks;
+    uint32_t ulBadBlocks;
+} LogReader_t;
+
+void vLoggerInit(Logger_t *pxLogger, const HalStorage_t *pxStorage);
+bool bLoggerAppend(Logger_t *pxLogger, uint8_t ucChannel, float fValue, uint32_t ulNowMs);
+bool bLoggerSeal(Logger_t *pxLogger);
+uint32_t ulLoggerFlush(Logger_t *pxLogger);
+
+bool bLogReaderOpen(LogReader_t *pxReader, const HalStorage_t *pxStorage);
+bool bLogReaderNext(LogReader_t *pxReader, LogSample_t *pxSample);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MAX_STORE_H
+#define MAX_STORE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "channels.h"
+
+#define MAX_STORE_KEY "maxima"
+#define MAX_STORE_VERSION 1
+#define MAX_STORE_MIN_INTERVAL_MS 120000  // Never commits more often, 30 writes per hour at worst
+#define MAX_STORE_PERIOD_MS 900000        // A small change waits at most this long, or for the ECU to go quiet
+#define MAX_STORE_SIGNIFICANT_PERMILLE 50 // Above the last committed value, commits at the next interval
+#define MAX_STORE_SIGNIFICANT_MIN 2.0f
+#define MAX_STORE_QUIET_MS 5000 // No value for this long ends the drive: a pending change is committed
+
+typedef struct
+{
+    float fMax;
+    uint32_t ulSession;  // Ignition cycle in which it was reached
+    uint32_t ulUptimeMs; // Time since that boot, there is no real time clock
+} StoredMax_t;
+
+// The record as it sits in flash
+typedef struct
+{
+    uint8_t ucVersion;
+    uint8_t ucChannelCount;
+    uint32_t ulSessions;
+    uint32_t ulWrites; // Lifetime commits, this one included
+    StoredMax_t xMax[CHANNEL_COUNT];
+} MaxRecord_t;
+
+// Keeps the max values in RAM and commits them to flash only when a change
+// is significant against what was last committed or has waited
+// MAX_STORE_PERIOD_MS, and never twice within MAX_STORE_MIN_INTERVAL_MS.
+// A pending change is also committed as soon as the values stop coming.
+// Owned by the acquisition task
+typedef struct
+{
+    const HalKeyValue_t *pxStore;
+    uint32_t ulChannelMask; // Channels whose max is kept
+    MaxRecord_t xRecord;
+    MaxRecord_t xCommitted;
+    bool bDirty;
+    bool bSignificant;
+    uint32_t ulDirtySinceMs;
+    uint32_t ulLastCommitMs;
+    uint32_t ulLastValueMs;
+    uint32_t ulCommits; // This session
+    uint32_t ulUpdates;
+    uint32_t ulFailures;
+} MaxStore_t;
+
+void vMaxStoreInit(MaxStore_t *pxStore, const HalKeyValue_t *pxKeyValue, uint32_t ulChannelMask);
+bool bMaxStoreLoad(MaxStore_t *pxStore, uint32_t ulNowMs);
+void vMaxStoreUpdate(MaxStore_t *pxStore, uint8_t ucChannel, float fMax, uint32_t ulNowMs);
+void vMaxStoreClear(MaxStore_t *pxStore, uint32_t ulChannelMask, uint32_t ulNowMs);
+bool bMaxStoreService(MaxStore_t *pxStore, uint32_t ulNowMs);
+bool bMaxStoreCommit(MaxStore_t *pxStore, uint32_t ulNowMs);
+bool bMaxStoreGet(const MaxStore_t *pxStore, uint8_t ucChannel, float *pfMax);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "channels.h"
+
+#define METRICS_HISTOGRAM_BUCKETS 12 // <250 us, <500 us, ... doubling up to <512 ms, last is open ended
+#define METRICS_HISTOGRAM_FIRST_US 250
+#define METRICS_STATUS_COUNT 8       // ElmStatus_t values, used as the index
+
+// The path of one sample from the request to the pixels on screen
+typedef enum
+{
+    METRICS_STAGE_RESPONSE, // Request sent to response parsed
+    METRICS_STAGE_PUBLISH,  // Parsed to published in the telemetry store
+    METRICS_STAGE_RENDER,   // Published to pixels pushed
+    METRICS_STAGE_GLASS,    // Request sent to pixels pushed
+    METRICS_STAGE_COUNT
+} MetricsStage_t;
+
+// Histograms and worst cases are kept until vMetricsClear, the rates only
+// for the current window. The acquisition side writes the first two stages
+// and the counters, the render side the last two
+typedef struct
+{
+    uint32_t ulHistogram[METRICS_STAGE_COUNT][METRICS_HISTOGRAM_BUCKETS];
+    uint32_t ulWorstUs[METRICS_STAGE_COUNT];
+    uint32_t ulPublished;
+    uint32_t ulDrawn;
+    uint32_t ulSentUs; // Of the newest sample that changed the screen
+    uint32_t ulPublishedUs;
+    volatile bool bPending;
+} MetricsChannel_t;
+
+typedef struct
+{
+    MetricsChannel_t xChannels[CHANNEL_COUNT];
+    uint32_t ulErrors[METRICS_STATUS_COUNT];
+    uint32_t ulWindowStartMs;
+} Metrics_t;
+
+void vMetricsInit(Metrics_t *pxMetrics, uint32_t ulNowMs);
+void vMetricsClear(Metrics_t *pxMetrics, uint32_t ulNowMs);
+void vMetricsResetWindow(Metrics_t *pxMetrics, uint32_t ulNowMs);
+
+void vMetricsPublished(Metrics_t *pxMetrics, uint8_t ucChannel, uint32_t ulSentUs, uint32_t ulParsedUs, uint32_t ulPublishedUs, bool bChanged);
+void vMetricsDrawn(Metrics_t *pxMetrics, uint32_t ulChannelMask, uint32_t ulPushedUs);
+void vMetricsError(Metrics_t *pxMetrics, int8_t i8Status);
+
+uint32_t ulMetricsPercentileUs(const MetricsChannel_t *pxChannel, MetricsStage_t xStage, uint16_t ui16Permille);
+
+#endif
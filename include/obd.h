@@ -0,0 +1,83 @@
+#ifndef OBD_H
+#define OBD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "can_decoder.h"
+
+#define OBD_MULTI_PID_MAX 6 // ELM327 accepts up to six PIDs in one CAN Mode 01 request
+#define OBD_REQUEST_MAX (4 + (2 * OBD_MULTI_PID_MAX)) // With the ELM327 response count digit
+#define OBD_SUPPORT_BYTES 32                          // One bit per PID, 0x00 to 0xFF
+
+#define PID_ENGINE_LOAD 0x04
+#define PID_COOLANT_TEMP 0x05
+#define PID_SHORT_TERM_FUEL_TRIM 0x06
+#define PID_LONG_TERM_FUEL_TRIM 0x07
+#define PID_INTAKE_MANIFOLD_PRESSURE 0x0B
+#define PID_ENGINE_SPEED 0x0C
+#define PID_VEHICLE_SPEED 0x0D
+#define PID_TIMING_ADVANCE 0x0E
+#define PID_INTAKE_AIR_TEMP 0x0F
+#define PID_MAF_RATE 0x10
+#define PID_THROTTLE_POSITION 0x11
+#define PID_RUN_TIME 0x1F
+#define PID_FUEL_RAIL_PRESSURE 0x22
+#define PID_FUEL_RAIL_GAUGE_PRESSURE 0x23
+#define PID_FUEL_LEVEL 0x2F
+#define PID_BAROMETRIC_PRESSURE 0x33
+#define PID_MODULE_VOLTAGE 0x42
+#define PID_ABSOLUTE_LOAD 0x43
+#define PID_COMMANDED_LAMBDA 0x44
+#define PID_RELATIVE_THROTTLE 0x45
+#define PID_AMBIENT_AIR_TEMP 0x46
+#define PID_ACCELERATOR_POSITION 0x49
+#define PID_OIL_TEMP 0x5C
+#define PID_FUEL_RATE 0x5E
+
+// A Mode 01 PID: how many data bytes it answers with, how to decode them and
+// which channel shows it. Built from a SensorChannel (sensor_channel.h), so
+// the table is constant data and adding a PID costs no RAM until a job
+// polls it
+typedef struct
+{
+    uint8_t ucPid;
+    uint8_t ucDataLength;
+    uint8_t ucChannel; // CHANNEL_NONE when no gauge shows it
+    const char *pcName;
+    const char *pcUnits;
+    float fMin; // Plausible range, bDecode fails outside
+    float fMax;
+    bool (*pxDecode)(const uint8_t *pucData, float *pfValue);
+    void (*pxEncode)(float fValue, uint8_t *pucData);
+} ObdPidDef_t;
+
+typedef struct
+{
+    uint8_t ucPid;
+    float fValue;
+    bool bPresent; // In the answer
+    bool bValid;   // And decoded within its plausible range
+} ObdPidValue_t;
+
+// One Mode 01 answer, accumulated line by line
+typedef struct
+{
+    IsoTpMessage_t xMessage;
+    const char *pcRequest;
+    bool bHeaders;
+} ObdResponse_t;
+
+const ObdPidDef_t *pxObdFindPid(uint8_t ucPid);
+const ObdPidDef_t *pxObdPidAt(uint8_t ucIndex);
+uint8_t ucObdPidCount(void);
+
+size_t xObdBuildMultiPidRequest(char *pcRequest, size_t xSize, const uint8_t *pucPids, uint8_t ucCount);
+uint8_t ucObdExpectedFrames(const uint8_t *pucPids, uint8_t ucCount);
+void vObdResponseStart(ObdResponse_t *pxResponse, const char *pcRequest, bool bHeaders);
+void vObdResponseFeedLine(ObdResponse_t *pxResponse, const char *pcLine, size_t xLength);
+uint8_t ucObdResponseDecode(const ObdResponse_t *pxResponse, ObdPidValue_t *pxValues, uint8_t ucCount);
+bool bObdResponseSupport(const ObdResponse_t *pxResponse, uint8_t ucBase, uint8_t *pucSupported);
+bool bObdPidSupported(const uint8_t *pucSupported, uint8_t ucPid);
+uint8_t ucObdParseMultiPidResponse(const char *pcResponse, const char *pcRequest, bool bHeaders, ObdPidValue_t *pxValues, uint8_t ucCount);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "logger.h"
+#include "broadcast.h"
+
+#define PLAYBACK_UNTHROTTLED 0 // Speed for the render benchmark
+#define PLAYBACK_END 0xFFFFFFFF
+
+// Feeds a session log to the same publish callback the acquisition uses, at
+// ui16SpeedPercent of the recorded pace
+typedef struct
+{
+    LogReader_t xReader;
+    LogSample_t xNext;
+    bool bHasNext;
+    uint16_t ui16SpeedPercent;
+    uint32_t ulLogStartMs;
+    uint32_t ulStartMs;
+    uint32_t ulSamples;
+    uint32_t ulSteps;
+} Playback_t;
+
+bool bPlaybackOpen(Playback_t *pxPlayback, const HalStorage_t *pxStorage, uint16_t ui16SpeedPercent, uint32_t ulNowMs);
+uint32_t ulPlaybackStep(Playback_t *pxPlayback, BroadcastPublish_t xPublish, uint32_t ulNowMs);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include "acquisition.h"
+#include "display.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "boot_profile.h"
+#include "elm_profile.h"
+
+void vReportPrint(const Acquisition_t *pxAcquisition, const DisplayStats_t *pxDisplayStats, const Telemetry_t *pxTelemetry, uint32_t ulNow);
+void vReportPrintMetrics(const Metrics_t *pxMetrics, uint32_t ulNow);
+void vReportPrintStats(const TelemetrySnapshot_t *pxSnapshot);
+void vReportPrintBoot(const BootProfile_t *pxProfile);
+void vReportPrintCalibration(const ElmCalibrationResult_t *pxResult);
+
+#endif
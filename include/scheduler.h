@@ -0,0 +1,66 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHED_NO_JOB (-1)
+#define SCHED_NON_OBD 0x00 // ucPid of jobs that are not a Mode 01 PID
+#define SCHED_BACKOFF_MAX_MS 5000       // Longest wait between retries of a PID that stopped answering
+#define SCHED_QUARANTINE_FAILURES 5     // Without the supported PIDs, misses before a PID that never answered is set aside
+#define SCHED_QUARANTINE_RETRY_MS 60000 // A set aside PID is still asked this often
+
+typedef enum
+{
+    SCHED_RESULT_OK,
+    SCHED_RESULT_LINK_FAILED, // The exchange failed or nothing was answered, the link recovery deals with it
+    SCHED_RESULT_NO_ANSWER,   // The ECU answered the request but left this PID out
+    SCHED_RESULT_REJECTED     // Answered outside its plausible range
+} SchedResult_t;
+
+// One schedulable acquisition job. A job is released every ui16PeriodMs and
+// must complete before ui16StaleMs after its last sample; released jobs run
+// earliest-deadline-first with ucPriority breaking ties
+typedef struct
+{
+    const char *pcName;
+    uint8_t ucPid;
+    uint16_t ui16PeriodMs;
+    uint8_t ucPriority;
+    uint16_t ui16StaleMs;
+
+    uint32_t ulRelease;
+    uint32_t ulDeadline;
+    uint32_t ulSamples;
+    uint32_t ulFailures;
+    uint32_t ulMissedDeadlines;
+    uint8_t ucUnanswered; // In a row, sets the backoff
+    bool bAnswered;       // At least once since boot
+    bool bQuarantined;
+} PidSchedule_t;
+
+// A job table entry: the configuration, and the run state vSchedulerInit sets
+#define SCHED_JOB(pcName, ucPid, ui16PeriodMs, ucPriority, ui16StaleMs) \
+    {(pcName), (ucPid), (ui16PeriodMs), (ucPriority), (ui16StaleMs), 0, 0, 0, 0, 0, 0, false, false}
+
+typedef struct
+{
+    PidSchedule_t *pxJobs;
+    uint8_t ucJobCount;
+    uint8_t ucBatchMax;
+    bool bSupportKnown; // The ECU's supported PIDs set the quarantine, not the misses
+    uint32_t ulWindowStart;
+} Scheduler_t;
+
+void vSchedulerInit(Scheduler_t *pxScheduler, PidSchedule_t *pxJobs, uint8_t ucJobCount, uint8_t ucBatchMax, uint32_t ulNow);
+int8_t cSchedulerNext(const Scheduler_t *pxScheduler, uint32_t ulNow);
+uint32_t ulSchedulerIdleMs(const Scheduler_t *pxScheduler, uint32_t ulNow);
+uint8_t ucSchedulerCollectBatch(const Scheduler_t *pxScheduler, int8_t cHead, uint32_t ulNow, int8_t *pcBatch);
+void vSchedulerComplete(Scheduler_t *pxScheduler, int8_t cJob, SchedResult_t xResult, uint32_t ulNow);
+void vSchedulerSetAside(Scheduler_t *pxScheduler, int8_t cJob, uint32_t ulNow);
+uint8_t ucSchedulerQuarantined(const Scheduler_t *pxScheduler);
+
+uint32_t ulSchedulerRequestedRate(const PidSchedule_t *pxJob);
+uint32_t ulSchedulerAchievedRate(const Scheduler_t *pxScheduler, const PidSchedule_t *pxJob, uint32_t ulNow);
+void vSchedulerResetWindow(Scheduler_t *pxScheduler, uint32_t ulNow);
+
+#endif
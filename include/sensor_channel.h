@@ -0,0 +1,89 @@
+#ifndef SENSOR_CHANNEL_H
+#define SENSOR_CHANNEL_H
+
+#include <stdint.h>
+#include <math.h>
+#include "obd.h"
+
+// Big endian unsigned A, AB, ... as the Mode 01 PIDs carry them:
+// value = raw * Num / Den + Offset. Every constant is known at compile
+// time, so each instance decodes with its own unrolled code
+template <uint8_t Bytes, int32_t Num, int32_t Den, int32_t Offset> struct LinearDecode
+{
+    static_assert((Bytes >= 1) && (Bytes <= 4), "1 to 4 data bytes");
+
+    static constexpr uint8_t ucBytes = Bytes;
+
+    static float fDecode(const uint8_t *pucData)
+    {
+        uint32_t ulRaw = 0;
+
+        for (register uint8_t i = 0; i < Bytes; i++)
+            ulRaw = (ulRaw << 8) | pucData[i];
+
+        return (float)ulRaw * ((float)Num / (float)Den) + (float)Offset;
+    }
+
+    // The inverse, for the native emulator
+    static void vEncode(float fValue, uint8_t *pucData)
+    {
+        float fRaw = roundf((fValue - (float)Offset) * ((float)Den / (float)Num));
+        uint32_t ulRawMax = (uint32_t)(((uint64_t)1 << (8 * Bytes)) - 1);
+        uint32_t ulRaw = (fRaw <= 0) ? 0 : ((fRaw >= (float)ulRawMax) ? ulRawMax : (uint32_t)fRaw);
+
+        for (register uint8_t i = 0; i < Bytes; i++)
+            pucData[i] = ulRaw >> (8 * (Bytes - 1 - i));
+    }
+};
+
+// Plausible values; a decoded value outside is dropped as a bad answer
+template <int32_t Min, int32_t Max> struct ValueRange
+{
+    static_assert(Min < Max, "empty range");
+
+    static constexpr float fMin = Min;
+    static constexpr float fMax = Max;
+
+    static bool bContains(float fValue)
+    {
+        return (fValue >= (float)Min) && (fValue <= (float)Max);
+    }
+};
+
+#define SENSOR_UNITS(name, text)                     \
+    struct name                                      \
+    {                                                \
+        static constexpr const char *pcUnits = text; \
+    }
+
+SENSOR_UNITS(Percent, "%");
+SENSOR_UNITS(Celsius, "C");
+SENSOR_UNITS(Kilopascal, "kPa");
+SENSOR_UNITS(Rpm, "rpm");
+SENSOR_UNITS(KilometresPerHour, "km/h");
+SENSOR_UNITS(Degrees, "deg");
+SENSOR_UNITS(GramsPerSecond, "g/s");
+SENSOR_UNITS(Seconds, "s");
+SENSOR_UNITS(Volts, "V");
+SENSOR_UNITS(Ratio, "");
+SENSOR_UNITS(LitresPerHour, "l/h");
+
+// A Mode 01 PID's decoding, range check and units in one type. xDef turns
+// it into an entry of the flash resident PID table, e.g.
+//   SensorChannel<LinearDecode<1, 1, 1, -40>, ValueRange<-40, 150>, Celsius>::xDef(0x0F, CHANNEL_IAT, "IAT")
+template <typename Decode, typename Range, typename Units> struct SensorChannel
+{
+    static bool bDecode(const uint8_t *pucData, float *pfValue)
+    {
+        *pfValue = Decode::fDecode(pucData);
+
+        return Range::bContains(*pfValue);
+    }
+
+    static constexpr ObdPidDef_t xDef(uint8_t ucPid, uint8_t ucChannel, const char *pcName)
+    {
+        return {ucPid, Decode::ucBytes, ucChannel, pcName, Units::pcUnits, Range::fMin, Range::fMax, bDecode, Decode::vEncode};
+    }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+#include "boot_profile.h"
+
+#define STARTUP_STAGE_MAX 16
+#define STARTUP_BIT(stage) ((uint32_t)1 << (stage))
+#define STARTUP_ANY_CORE 0xFF
+
+typedef struct
+{
+    const char *pcName;
+    void (*vRun)(void);
+    uint32_t ulDependsOn; // STARTUP_BIT of every stage that must have finished
+    uint8_t ucCore;       // Worker that runs it, or STARTUP_ANY_CORE
+} StartupStage_t;
+
+// Init stages as a dependency graph. One worker per core takes the next
+// stage whose dependencies are done, so independent chains (display and
+// touch, the Bluetooth stack, the flash filesystem) overlap. Stages are
+// claimed atomically; the wake-up when a stage ends is up to the caller
+typedef struct
+{
+    const StartupStage_t *pxStages;
+    uint8_t ucCount;
+    uint32_t ulClaimed;
+    uint32_t ulDone;
+    BootProfile_t *pxProfile;
+} Startup_t;
+
+void vStartupInit(Startup_t *pxStartup, const StartupStage_t *pxStages, uint8_t ucCount, BootProfile_t *pxProfile);
+int8_t i8StartupClaim(Startup_t *pxStartup, uint8_t ucCore);
+void vStartupRun(Startup_t *pxStartup, int8_t i8Stage);
+bool bStartupFinished(const Startup_t *pxStartup, uint8_t ucCore);
+uint32_t ulStartupDone(const Startup_t *pxStartup);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <float.h>
+#include "channels.h"
+#include "channel_stats.h"
+
+#define TELEMETRY_ALIGN 32
+#define TELEMETRY_NO_MAX (-FLT_MAX)
+
+typedef struct
+{
+    float fValue;
+    float fMax;
+    uint32_t ulTimestampMs;
+    bool bValid;
+    ChannelSummary_t xStats;
+} TelemetryChannel_t;
+
+// A consistent copy of every channel, as handed to readers
+typedef struct
+{
+    uint32_t ulGeneration;
+    TelemetryChannel_t xChannels[CHANNEL_COUNT];
+} TelemetrySnapshot_t;
+
+// Seqlock protected store with a single writer (the acquisition task).
+// ulSequence is odd while a write is in progress; readers retry instead of
+// locking. Other tasks ask for max resets through ulResetMask, which the
+// writer applies. xStats is the writer's history behind each channel's
+// summary; readers only ever copy the summaries
+typedef struct
+{
+    uint32_t ulSequence;
+    uint32_t ulResetMask;
+    TelemetryChannel_t xChannels[CHANNEL_COUNT];
+    uint32_t ulRetries;
+    ChannelStats_t xStats[CHANNEL_COUNT];
+} __attribute__((aligned(TELEMETRY_ALIGN))) Telemetry_t;
+
+void vTelemetryInit(Telemetry_t *pxTelemetry, const ChannelStatsConfig_t *pxStatsConfig);
+bool bTelemetryPublish(Telemetry_t *pxTelemetry, uint8_t ucChannel, float fValue, uint32_t ulNowMs);
+void vTelemetryRequestReset(Telemetry_t *pxTelemetry, uint32_t ulChannelMask);
+uint32_t ulTelemetryApplyResets(Telemetry_t *pxTelemetry);
+void vTelemetryRestoreMax(Telemetry_t *pxTelemetry, uint8_t ucChannel, float fMax);
+
+void vTelemetryRead(Telemetry_t *pxTelemetry, TelemetrySnapshot_t *pxSnapshot);
+uint32_t ulTelemetryGeneration(const Telemetry_t *pxTelemetry);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <stdint.h>
+#include "scheduler.h"
+#include "broadcast.h"
+#include "channel_stats.h"
+#include "estimator.h"
+
+// What is read from the car and how often. Shared by the firmware and the
+// native build so both run the same schedule
+extern PidSchedule_t xVehicleJobs[];
+extern const uint8_t ucVehicleJobCount;
+
+extern const BroadcastSignal_t xVehicleBroadcastSignals[];
+extern const uint8_t ucVehicleBroadcastSignalCount;
+
+extern const ChannelStatsConfig_t xVehicleChannelStats[];
+extern const EstimatorConfig_t xVehicleEstimators[];
+
+#endif
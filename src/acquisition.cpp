@@ -0,0 +1,198 @@
+#include "acquisition.h"
+
+#include "channels.h"
+
+void vAcquisitionInit(Acquisition_t *pxAcquisition, PidSchedule_t *pxJobs, uint8_t ucJobCount, uint8_t ucBatchMax,
+                      ElmLink_t *pxLink, BroadcastMonitor_t *pxMonitor, BroadcastPublish_t xPublish,
+                      AcquisitionError_t xOnError, const HalClock_t *pxClock)
+{
+    pxAcquisition->pxLink = pxLink;
+    pxAcquisition->pxMonitor = pxMonitor;
+    pxAcquisition->xPublish = xPublish;
+    pxAcquisition->xOnError = xOnError;
+    pxAcquisition->pxClock = pxClock;
+    pxAcquisition->ulSentUs = 0;
+    pxAcquisition->ulParsedUs = 0;
+    pxAcquisition->ucProfileMisses = 0;
+    pxAcquisition->bProfileDropped = false;
+
+    vElmRecoveryInit(&pxAcquisition->xRecovery, ELM_PROTOCOL_AUTO, pxClock->ulMillis());
+    vSchedulerInit(&pxAcquisition->xScheduler, pxJobs, ucJobCount, ucBatchMax, pxClock->ulMillis());
+}
+
+// Only reports and classifies; the recovery itself runs at the next steps
+static void vFailed(Acquisition_t *pxAcquisition, const char *pcJob)
+{
+    if (pxAcquisition->xOnError != NULL)
+        pxAcquisition->xOnError(pcJob, pxAcquisition->pxLink->i8Status);
+
+    vElmRecoveryFailed(&pxAcquisition->xRecovery, pxAcquisition->pxLink->i8Status, pxAcquisition->pxClock->ulMillis());
+}
+
+// Only a PID missing from an otherwise good answer counts against the PID;
+// a request that failed as a whole, NO DATA included, says nothing about it
+static SchedResult_t xResult(bool bSuccess, const ObdPidValue_t *pxValue)
+{
+    if (!bSuccess)
+        return SCHED_RESULT_LINK_FAILED;
+
+    if (!pxValue->bPresent)
+        return SCHED_RESULT_NO_ANSWER;
+
+    return pxValue->bValid ? SCHED_RESULT_OK : SCHED_RESULT_REJECTED;
+}
+
+// NO DATA under a tuned profile may be its AT ST running out before the ECU
+// answered: the request is sent again with the ELM327's own timeout. An
+// answer slower than the tuned AT ST is one the profile missed, and after
+// ACQ_PROFILE_MISSES_MAX of them the link stays on the ELM327's timeout
+static bool bRetryUntuned(Acquisition_t *pxAcquisition, const uint8_t *pucPids, ObdPidValue_t *pxValues, uint8_t ucCount)
+{
+    ElmLink_t *pxLink = pxAcquisition->pxLink;
+    ElmProfile_t xTuned = pxLink->xProfile;
+    ElmProfile_t xSafe = xTuned;
+    uint32_t ulTook = 0;
+    bool bAnswered;
+
+    xSafe.ucAdaptiveTiming = ELM_TIMING_DEFAULT;
+    xSafe.ucTimeout = ELM_TIMEOUT_DEFAULT;
+
+    bAnswered = bElmLinkApplyProfile(pxLink, &xSafe);
+    if (bAnswered)
+    {
+        uint32_t ulStart = pxAcquisition->pxClock->ulMicros();
+
+        bAnswered = bElmLinkReadPids(pxLink, pucPids, pxValues, ucCount);
+        ulTook = pxAcquisition->pxClock->ulMicros() - ulStart;
+    }
+
+    if (bAnswered && (ulTook > xTuned.ucTimeout * 4000u) && (++pxAcquisition->ucProfileMisses >= ACQ_PROFILE_MISSES_MAX))
+    {
+        pxAcquisition->bProfileDropped = true;
+        return true;
+    }
+
+    // The failure reported is the request's, not the restored profile's
+    int8_t i8Status = bAnswered ? (int8_t)ELM_STATUS_SUCCESS : (int8_t)ELM_STATUS_NO_DATA;
+
+    bElmLinkApplyProfile(pxLink, &xTuned);
+    pxLink->i8Status = i8Status;
+
+    return bAnswered;
+}
+
+// Runs the most urgent released job, batched with the PIDs that are due
+// soon, or one pending recovery action. Returns 0 after running it, or the
+// time until the next release
+uint32_t ulAcquisitionStep(Acquisition_t *pxAcquisition)
+{
+    Scheduler_t *pxScheduler = &pxAcquisition->xScheduler;
+    PidSchedule_t *pxJobs = pxScheduler->pxJobs;
+    const HalClock_t *pxClock = pxAcquisition->pxClock;
+
+    if (bElmRecoveryActive(&pxAcquisition->xRecovery))
+        return ulElmRecoveryStep(&pxAcquisition->xRecovery, pxAcquisition->pxLink);
+
+    int8_t cJob = cSchedulerNext(pxScheduler, pxClock->ulMillis());
+
+    if (cJob == SCHED_NO_JOB)
+        return ulSchedulerIdleMs(pxScheduler, pxClock->ulMillis()) + 1;
+
+    int8_t cBatch[OBD_MULTI_PID_MAX];
+    uint8_t ucBatchCount = ucSchedulerCollectBatch(pxScheduler, cJob, pxClock->ulMillis(), cBatch);
+
+    if (pxJobs[cJob].ucPid == SCHED_NON_OBD)
+    {
+        pxAcquisition->ulSentUs = pxClock->ulMicros();
+        pxAcquisition->ulParsedUs = 0;
+
+        bool bSuccess = bElmLinkMonitorBroadcast(pxAcquisition->pxLink, pxAcquisition->pxMonitor, pxAcquisition->xPublish,
+                                                 BCAST_WINDOW_MS, BCAST_STOP_SETTLE_MS);
+
+        if (bSuccess)
+            vElmRecoverySucceeded(&pxAcquisition->xRecovery);
+        else
+            vFailed(pxAcquisition, pxJobs[cJob].pcName);
+
+        // No backoff for an incomplete window, it runs again next period
+        vSchedulerComplete(pxScheduler, cJob, bSuccess ? SCHED_RESULT_OK : SCHED_RESULT_LINK_FAILED, pxClock->ulMillis());
+    }
+    else
+    {
+        uint8_t ucPids[OBD_MULTI_PID_MAX];
+        ObdPidValue_t xValues[OBD_MULTI_PID_MAX];
+
+        for (register uint8_t i = 0; i < ucBatchCount; i++)
+            ucPids[i] = pxJobs[cBatch[i]].ucPid;
+
+        pxAcquisition->ulSentUs = pxClock->ulMicros();
+        bool bSuccess = bElmLinkReadPids(pxAcquisition->pxLink, ucPids, xValues, ucBatchCount);
+        if (!bSuccess && (pxAcquisition->pxLink->i8Status == ELM_STATUS_NO_DATA) && bElmProfileTuned(&pxAcquisition->pxLink->xProfile))
+            bSuccess = bRetryUntuned(pxAcquisition, ucPids, xValues, ucBatchCount);
+        pxAcquisition->ulParsedUs = pxClock->ulMicros();
+
+        if (bSuccess)
+            vElmRecoverySucceeded(&pxAcquisition->xRecovery);
+        else
+            vFailed(pxAcquisition, pxJobs[cJob].pcName);
+
+        for (register uint8_t i = 0; i < ucBatchCount; i++)
+        {
+            SchedResult_t xOutcome = xResult(bSuccess, &xValues[i]);
+            uint8_t ucChannel = (xOutcome == SCHED_RESULT_OK) ? pxObdFindPid(xValues[i].ucPid)->ucChannel : CHANNEL_NONE;
+
+            if (ucChannel < CHANNEL_COUNT)
+                pxAcquisition->xPublish(ucChannel, xValues[i].fValue);
+
+            vSchedulerComplete(pxScheduler, cBatch[i], xOutcome, pxClock->ulMillis());
+        }
+    }
+
+    return 0;
+}
+
+// Asks the ECU which PIDs it supports and sets the others aside, so a PID
+// is quarantined for not being listed instead of for failed requests. Keeps
+// the miss counting when the ECU does not answer 01 00
+bool bAcquisitionReadSupport(Acquisition_t *pxAcquisition)
+{
+    Scheduler_t *pxScheduler = &pxAcquisition->xScheduler;
+    uint8_t ucSupported[OBD_SUPPORT_BYTES];
+
+    if (!bElmLinkReadSupport(pxAcquisition->pxLink, ucSupported))
+        return false;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+    {
+        uint8_t ucPid = pxScheduler->pxJobs[i].ucPid;
+
+        if ((ucPid != SCHED_NON_OBD) && !bObdPidSupported(ucSupported, ucPid))
+            vSchedulerSetAside(pxScheduler, i, pxAcquisition->pxClock->ulMillis());
+    }
+
+    pxScheduler->bSupportKnown = true;
+
+    return true;
+}
+
+// Times the link profiles on the first batch the scheduler would send, the
+// OBD jobs in table order. Quarantined PIDs are left out, their NO DATA
+// would fail every profile
+bool bAcquisitionCalibrate(Acquisition_t *pxAcquisition, ElmCalibrationResult_t *pxResult)
+{
+    const Scheduler_t *pxScheduler = &pxAcquisition->xScheduler;
+    uint8_t ucPids[OBD_MULTI_PID_MAX];
+    uint8_t ucCount = 0;
+
+    for (register uint8_t i = 0; (i < pxScheduler->ucJobCount) && (ucCount < pxScheduler->ucBatchMax) && (ucCount < OBD_MULTI_PID_MAX); i++)
+    {
+        const PidSchedule_t *pxJob = &pxScheduler->pxJobs[i];
+
+        if ((pxJob->ucPid != SCHED_NON_OBD) && !pxJob->bQuarantined)
+            ucPids[ucCount++] = pxJob->ucPid;
+    }
+
+    pxAcquisition->ucProfileMisses = 0;
+
+    return bElmProfileCalibrate(pxAcquisition->pxLink, ucPids, ucCount, pxResult);
+}
@@ -0,0 +1,98 @@
+#include "adapter_cache.h"
+
+#include <string.h>
+
+void vAdapterCacheInit(AdapterCache_t *pxCache, const HalKeyValue_t *pxKeyValue)
+{
+    memset(pxCache, 0, sizeof(AdapterCache_t));
+    pxCache->pxStore = pxKeyValue;
+    pxCache->xRecord.ucVersion = ADAPTER_CACHE_VERSION;
+    pxCache->xRecord.ucProtocol = ELM_PROTOCOL_AUTO;
+}
+
+// A missing or foreign record leaves discovery and the automatic search on
+bool bAdapterCacheLoad(AdapterCache_t *pxCache)
+{
+    const HalKeyValue_t *pxKeyValue = pxCache->pxStore;
+    AdapterRecord_t xRecord;
+
+    pxCache->bLoaded = pxKeyValue->bLoad(pxKeyValue->pvContext, ADAPTER_CACHE_KEY, &xRecord, sizeof(xRecord)) &&
+                       (xRecord.ucVersion == ADAPTER_CACHE_VERSION);
+
+    if (pxCache->bLoaded)
+        pxCache->xRecord = xRecord;
+
+    return pxCache->bLoaded;
+}
+
+static bool bCommit(AdapterCache_t *pxCache)
+{
+    const HalKeyValue_t *pxKeyValue = pxCache->pxStore;
+
+    pxCache->xRecord.ulWrites++;
+
+    if (pxKeyValue->bStore(pxKeyValue->pvContext, ADAPTER_CACHE_KEY, &pxCache->xRecord, sizeof(AdapterRecord_t)))
+        return true;
+
+    pxCache->ulFailures++;
+    return false;
+}
+
+bool bAdapterCacheSetAddress(AdapterCache_t *pxCache, const uint8_t *pucAddress)
+{
+    AdapterRecord_t *pxRecord = &pxCache->xRecord;
+
+    if (pxRecord->bHasAddress && (memcmp(pxRecord->ucAddress, pucAddress, ADAPTER_ADDRESS_LENGTH) == 0))
+        return true;
+
+    // Another adapter may well sit in another car, and time it differently
+    if (pxRecord->bHasAddress)
+    {
+        pxRecord->ucProtocol = ELM_PROTOCOL_AUTO;
+        pxRecord->bHasProfile = false;
+    }
+
+    memcpy(pxRecord->ucAddress, pucAddress, ADAPTER_ADDRESS_LENGTH);
+    pxRecord->bHasAddress = true;
+
+    return bCommit(pxCache);
+}
+
+bool bAdapterCacheSetProtocol(AdapterCache_t *pxCache, uint8_t ucProtocol)
+{
+    if (pxCache->xRecord.ucProtocol == ucProtocol)
+        return true;
+
+    // Another car behind the same adapter: its answer times are unknown
+    if (pxCache->xRecord.ucProtocol != ELM_PROTOCOL_AUTO)
+        pxCache->xRecord.bHasProfile = false;
+
+    pxCache->xRecord.ucProtocol = ucProtocol;
+
+    return bCommit(pxCache);
+}
+
+bool bAdapterCacheSetProfile(AdapterCache_t *pxCache, const ElmProfile_t *pxProfile)
+{
+    AdapterRecord_t *pxRecord = &pxCache->xRecord;
+
+    if (pxRecord->bHasProfile && (memcmp(&pxRecord->xProfile, pxProfile, sizeof(ElmProfile_t)) == 0))
+        return true;
+
+    pxRecord->xProfile = *pxProfile;
+    pxRecord->bHasProfile = true;
+
+    return bCommit(pxCache);
+}
+
+// The profile missed answers since it was calibrated: the next boot times
+// the link again
+bool bAdapterCacheClearProfile(AdapterCache_t *pxCache)
+{
+    if (!pxCache->xRecord.bHasProfile)
+        return true;
+
+    pxCache->xRecord.bHasProfile = false;
+
+    return bCommit(pxCache);
+}
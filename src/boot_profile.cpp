@@ -0,0 +1,52 @@
+#include "boot_profile.h"
+
+#include <string.h>
+
+void vBootProfileInit(BootProfile_t *pxProfile, const HalClock_t *pxClock)
+{
+    memset(pxProfile, 0, sizeof(BootProfile_t));
+    pxProfile->pxClock = pxClock;
+}
+
+// Returns the stage to end, BOOT_STAGE_NONE once the table is full. Stages
+// run on both cores, so the slot is taken atomically and its name is set
+// last: a slot without one is still being filled in
+int8_t i8BootProfileBegin(BootProfile_t *pxProfile, const char *pcName)
+{
+    uint8_t ucSlot = __atomic_fetch_add(&pxProfile->ucCount, 1, __ATOMIC_RELAXED);
+
+    if (ucSlot >= BOOT_STAGE_MAX)
+        return BOOT_STAGE_NONE;
+
+    BootStage_t *pxStage = &pxProfile->xStages[ucSlot];
+
+    pxStage->ulStartUs = pxProfile->pxClock->ulMicros();
+    pxStage->ulEndUs = 0;
+    __atomic_store_n(&pxStage->pcName, pcName, __ATOMIC_RELEASE);
+
+    return ucSlot;
+}
+
+void vBootProfileEnd(BootProfile_t *pxProfile, int8_t i8Stage)
+{
+    if ((i8Stage < 0) || (i8Stage >= BOOT_STAGE_MAX))
+        return;
+
+    // A stage that ends at time 0 still reads as ended
+    uint32_t ulNow = pxProfile->pxClock->ulMicros();
+
+    pxProfile->xStages[i8Stage].ulEndUs = (ulNow != 0) ? ulNow : 1;
+}
+
+// True only the first time, when the profile is complete
+bool bBootProfileFirstReading(BootProfile_t *pxProfile)
+{
+    if (pxProfile->ulFirstReadingUs != 0)
+        return false;
+
+    uint32_t ulNow = pxProfile->pxClock->ulMicros();
+
+    pxProfile->ulFirstReadingUs = (ulNow != 0) ? ulNow : 1;
+
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "broadcast.h"
+
+void vBroadcastInit(BroadcastMonitor_t *pxMonitor, const BroadcastSignal_t *pxSignals, uint8_t ucSignalCount)
+{
+    pxMonitor->pxSignals = pxSignals;
+    pxMonitor->ucSignalCount = ucSignalCount;
+    pxMonitor->ucIdCount = 0;
+    pxMonitor->ucSeenMask = 0;
+    pxMonitor->ulWindows = 0;
+    pxMonitor->ulFrames = 0;
+    pxMonitor->ulRejectedLines = 0;
+
+    for (register uint8_t i = 0; i < ucSignalCount; i++)
+    {
+        bool bKnown = false;
+
+        for (register uint8_t k = 0; k < pxMonitor->ucIdCount; k++)
+            bKnown |= (pxMonitor->ui16Ids[k] == pxSignals[i].ui16CanId);
+
+        if (!bKnown && (pxMonitor->ucIdCount < BCAST_MAX_IDS))
+            pxMonitor->ui16Ids[pxMonitor->ucIdCount++] = pxSignals[i].ui16CanId;
+    }
+}
+
+// Builds the "AT CRA" argument matching every monitored ID, with an X for
+// each hex digit that differs between them ("488", "4X8", ...)
+void vBroadcastBuildReceiveAddress(const BroadcastMonitor_t *pxMonitor, char *pcPattern)
+{
+    static const char cHex[] = "0123456789ABCDEF";
+
+    for (register uint8_t ucDigit = 0; ucDigit < 3; ucDigit++)
+    {
+        uint8_t ucShift = 8 - (4 * ucDigit);
+        uint8_t ucNibble = (pxMonitor->ui16Ids[0] >> ucShift) & 0x0F;
+        bool bSame = true;
+
+        for (register uint8_t k = 1; k < pxMonitor->ucIdCount; k++)
+            bSame &= (((pxMonitor->ui16Ids[k] >> ucShift) & 0x0F) == ucNibble);
+
+        pcPattern[ucDigit] = bSame ? cHex[ucNibble] : 'X';
+    }
+
+    pcPattern[3] = '\0';
+}
+
+bool bBroadcastNeedsHeaders(const BroadcastMonitor_t *pxMonitor)
+{
+    return pxMonitor->ucIdCount > 1;
+}
+
+void vBroadcastStartWindow(BroadcastMonitor_t *pxMonitor)
+{
+    pxMonitor->ucSeenMask = 0;
+    pxMonitor->ulWindows++;
+}
+
+// Decodes one monitored line ("[488 ]XX XX XX XX XX XX XX XX") and returns
+// true once every monitored ID was seen in the current window
+bool bBroadcastFeedLine(BroadcastMonitor_t *pxMonitor, const char *pcLine, size_t xLength, bool bHeaders, BroadcastPublish_t xPublish)
+{
+    CanFrame_t xFrame;
+    DecodeResult_t xResult = xCanParseLine(pcLine, xLength, bHeaders, &xFrame);
+
+    if (xResult != DECODE_OK)
+    {
+        pxMonitor->ulRejectedLines += (xResult != DECODE_NOT_DATA);
+        return false;
+    }
+
+    if (!bHeaders)
+        xFrame.ui16Id = pxMonitor->ui16Ids[0];
+
+    for (register uint8_t k = 0; k < pxMonitor->ucIdCount; k++)
+    {
+        if ((pxMonitor->ui16Ids[k] != xFrame.ui16Id) || (pxMonitor->ucSeenMask & (1 << k)))
+            continue;
+
+        for (register uint8_t i = 0; i < pxMonitor->ucSignalCount; i++)
+        {
+            const BroadcastSignal_t *pxSignal = &pxMonitor->pxSignals[i];
+            float fValue;
+
+            if ((pxSignal->ui16CanId == xFrame.ui16Id) && bSignalExtract(&pxSignal->xSignal, xFrame.ucData, xFrame.ucLength, &fValue))
+                xPublish(pxSignal->xSignal.ucChannel, fValue);
+        }
+
+        pxMonitor->ucSeenMask |= (1 << k);
+        pxMonitor->ulFrames++;
+    }
+
+    return pxMonitor->ucSeenMask == (1 << pxMonitor->ucIdCount) - 1;
+}
@@ -0,0 +1,238 @@
+#include "can_decoder.h"
+
+#include <string.h>
+
+const int8_t cHexLut[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,};
+
+DecodeResult_t xCanParseLine(const char *pcLine, size_t xLength, bool bHeaders, CanFrame_t *pxFrame)
+{
+    const uint8_t *pucLine = (const uint8_t *)pcLine;
+    uint8_t ucIdNibbles = bHeaders ? 3 : 0;
+    uint8_t ucNibbles = 0;
+    uint16_t ui16Id = 0;
+    int8_t cHigh = -1;
+    size_t i = 0;
+
+    pxFrame->ui16Id = CAN_NO_ID;
+    pxFrame->cIndex = CAN_NO_INDEX;
+    pxFrame->ui16MessageLength = 0;
+    pxFrame->ucLength = 0;
+
+    if ((xLength >= 2) && (pucLine[1] == ':') && (cHexLut[pucLine[0]] >= 0))
+    {
+        pxFrame->cIndex = cHexLut[pucLine[0]];
+        i = 2;
+    }
+
+    for (; i < xLength; i++)
+    {
+        if (pucLine[i] == ' ')
+            continue;
+
+        int8_t cNibble = cHexLut[pucLine[i]];
+        if (cNibble < 0)
+            return DECODE_NOT_DATA;
+
+        if (ucNibbles++ < ucIdNibbles)
+            ui16Id = (ui16Id << 4) | cNibble;
+        else if (cHigh < 0)
+            cHigh = cNibble;
+        else
+        {
+            if (pxFrame->ucLength >= CAN_FRAME_BYTES)
+                return DECODE_OVERFLOW;
+
+            pxFrame->ucData[pxFrame->ucLength++] = (cHigh << 4) | cNibble;
+            cHigh = -1;
+        }
+    }
+
+    if ((ucNibbles == 0) || (ucNibbles < ucIdNibbles))
+        return DECODE_NOT_DATA;
+
+    if (bHeaders)
+        pxFrame->ui16Id = ui16Id;
+
+    // "00A": length of the multi frame message that follows
+    if (!bHeaders && (ucNibbles == 3) && (pxFrame->cIndex == CAN_NO_INDEX))
+    {
+        pxFrame->ui16MessageLength = (pxFrame->ucData[0] << 4) | cHigh;
+        pxFrame->ucLength = 0;
+        return DECODE_OK;
+    }
+
+    if (cHigh >= 0)
+        return DECODE_BAD_LENGTH;
+
+    return DECODE_OK;
+}
+
+bool bSignalExtract(const SignalDef_t *pxSignal, const uint8_t *pucData, uint8_t ucLength, float *pfValue)
+{
+    if ((pxSignal->ucLength == 0) || (pxSignal->ucLength > 4) || (pxSignal->ucByteOffset + pxSignal->ucLength > ucLength))
+        return false;
+
+    uint32_t ulRaw = 0;
+
+    for (register uint8_t i = 0; i < pxSignal->ucLength; i++)
+        ulRaw = (ulRaw << 8) | pucData[pxSignal->ucByteOffset + i];
+
+    if (pxSignal->bSigned)
+    {
+        uint8_t ucShift = 32 - (8 * pxSignal->ucLength);
+        *pfValue = ((float)((int32_t)(ulRaw << ucShift) >> ucShift) * pxSignal->fScale) + pxSignal->fOffset;
+    }
+    else
+        *pfValue = ((float)ulRaw * pxSignal->fScale) + pxSignal->fOffset;
+
+    return true;
+}
+
+void vIsoTpStart(IsoTpMessage_t *pxMessage)
+{
+    pxMessage->ui16Id = CAN_NO_ID;
+    pxMessage->ui16Expected = 0;
+    pxMessage->ucLength = 0;
+    pxMessage->ucNextIndex = 0;
+    pxMessage->bStarted = false;
+    pxMessage->xError = DECODE_OK;
+}
+
+static DecodeResult_t xAppend(IsoTpMessage_t *pxMessage, const uint8_t *pucData, uint8_t ucLength)
+{
+    if (pxMessage->ucLength + ucLength > ISOTP_PAYLOAD_MAX)
+        return DECODE_OVERFLOW;
+
+    memcpy(&pxMessage->ucPayload[pxMessage->ucLength], pucData, ucLength);
+    pxMessage->ucLength += ucLength;
+    pxMessage->bStarted = true;
+
+    return DECODE_OK;
+}
+
+// Headers on: every line carries its PCI byte, so lengths and consecutive
+// frame sequence numbers can be checked
+static DecodeResult_t xFeedWithPci(IsoTpMessage_t *pxMessage, const CanFrame_t *pxFrame)
+{
+    if (pxFrame->ucLength == 0)
+        return DECODE_BAD_LENGTH;
+
+    // Only follow the first ECU that answered
+    if ((pxMessage->ui16Id != CAN_NO_ID) && (pxFrame->ui16Id != pxMessage->ui16Id))
+        return DECODE_OK;
+
+    uint8_t ucPci = pxFrame->ucData[0];
+
+    switch (ucPci >> 4)
+    {
+    case 0x0: // Single frame
+        if (pxMessage->bStarted)
+            return DECODE_BAD_SEQUENCE;
+        if (((ucPci & 0x0F) == 0) || ((ucPci & 0x0F) > pxFrame->ucLength - 1))
+            return DECODE_BAD_LENGTH;
+
+        pxMessage->ui16Id = pxFrame->ui16Id;
+        pxMessage->ui16Expected = ucPci & 0x0F;
+        return xAppend(pxMessage, &pxFrame->ucData[1], pxMessage->ui16Expected);
+
+    case 0x1: // First frame
+        if (pxMessage->bStarted || (pxFrame->ucLength < 2))
+            return DECODE_BAD_SEQUENCE;
+
+        pxMessage->ui16Id = pxFrame->ui16Id;
+        pxMessage->ui16Expected = ((ucPci & 0x0F) << 8) | pxFrame->ucData[1];
+        pxMessage->ucNextIndex = 1;
+        return xAppend(pxMessage, &pxFrame->ucData[2], pxFrame->ucLength - 2);
+
+    case 0x2: // Consecutive frame
+        if (!pxMessage->bStarted || ((ucPci & 0x0F) != pxMessage->ucNextIndex))
+            return DECODE_BAD_SEQUENCE;
+
+        pxMessage->ucNextIndex = (pxMessage->ucNextIndex + 1) & 0x0F;
+        return xAppend(pxMessage, &pxFrame->ucData[1], pxFrame->ucLength - 1);
+
+    default: // Flow control and reserved frames carry no payload
+        return DECODE_OK;
+    }
+}
+
+// Headers off: the ELM already removed the PCI bytes, multi frame answers
+// come as a length line followed by "N:" indexed lines
+static DecodeResult_t xFeedFormatted(IsoTpMessage_t *pxMessage, const CanFrame_t *pxFrame)
+{
+    if (pxFrame->ui16MessageLength > 0)
+    {
+        if (pxMessage->bStarted)
+            return DECODE_BAD_SEQUENCE;
+
+        pxMessage->ui16Expected = pxFrame->ui16MessageLength;
+        return DECODE_OK;
+    }
+
+    if (pxFrame->cIndex == CAN_NO_INDEX)
+    {
+        if (pxMessage->ui16Expected > 0)
+            return DECODE_BAD_SEQUENCE;
+        if (pxMessage->bStarted)
+            return DECODE_OK; // A second ECU, keep the first answer
+
+        return xAppend(pxMessage, pxFrame->ucData, pxFrame->ucLength);
+    }
+
+    if ((pxMessage->ui16Expected == 0) || (pxFrame->cIndex != pxMessage->ucNextIndex))
+        return DECODE_BAD_SEQUENCE;
+
+    pxMessage->ucNextIndex = (pxMessage->ucNextIndex + 1) & 0x0F;
+    return xAppend(pxMessage, pxFrame->ucData, pxFrame->ucLength);
+}
+
+DecodeResult_t xIsoTpFeedLine(IsoTpMessage_t *pxMessage, const char *pcLine, size_t xLength, bool bHeaders)
+{
+    CanFrame_t xFrame;
+    DecodeResult_t xResult = xCanParseLine(pcLine, xLength, bHeaders, &xFrame);
+
+    if (xResult == DECODE_NOT_DATA)
+        return xResult;
+
+    if (xResult == DECODE_OK)
+        xResult = bHeaders ? xFeedWithPci(pxMessage, &xFrame) : xFeedFormatted(pxMessage, &xFrame);
+
+    if ((xResult != DECODE_OK) && (pxMessage->xError == DECODE_OK))
+        pxMessage->xError = xResult;
+
+    return xResult;
+}
+
+// Complete once every announced byte arrived; trailing CAN padding of the
+// last frame is then outside ucLength
+bool bIsoTpComplete(const IsoTpMessage_t *pxMessage)
+{
+    if (!pxMessage->bStarted || (pxMessage->xError != DECODE_OK))
+        return false;
+
+    return (pxMessage->ui16Expected == 0) || (pxMessage->ucLength >= pxMessage->ui16Expected);
+}
+
+uint8_t ucIsoTpPayloadLength(const IsoTpMessage_t *pxMessage)
+{
+    if ((pxMessage->ui16Expected > 0) && (pxMessage->ui16Expected < pxMessage->ucLength))
+        return pxMessage->ui16Expected;
+
+    return pxMessage->ucLength;
+}
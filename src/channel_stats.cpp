@@ -0,0 +1,115 @@
+#include "channel_stats.h"
+
+#include <string.h>
+
+static void vDequeClear(StatsDeque_t *pxDeque)
+{
+    pxDeque->ucFront = 0;
+    pxDeque->ucCount = 0;
+}
+
+static StatsEntry_t *pxDequeAt(StatsDeque_t *pxDeque, uint8_t ucIndex)
+{
+    return &pxDeque->xEntries[(pxDeque->ucFront + ucIndex) % STATS_WINDOW_SAMPLES];
+}
+
+static void vDequePopFront(StatsDeque_t *pxDeque)
+{
+    pxDeque->ucFront = (pxDeque->ucFront + 1) % STATS_WINDOW_SAMPLES;
+    pxDeque->ucCount--;
+}
+
+// bMax keeps decreasing values, so the front is the largest; otherwise
+// increasing ones
+static float fDequePush(StatsDeque_t *pxDeque, float fValue, uint32_t ulNowMs, uint32_t ulWindowMs, bool bMax)
+{
+    while ((pxDeque->ucCount > 0) && ((ulNowMs - pxDequeAt(pxDeque, 0)->ulTimeMs) >= ulWindowMs))
+        vDequePopFront(pxDeque);
+
+    while (pxDeque->ucCount > 0)
+    {
+        float fBack = pxDequeAt(pxDeque, pxDeque->ucCount - 1)->fValue;
+
+        if (bMax ? (fBack > fValue) : (fBack < fValue))
+            break;
+
+        pxDeque->ucCount--;
+    }
+
+    if (pxDeque->ucCount == STATS_WINDOW_SAMPLES)
+        vDequePopFront(pxDeque);
+
+    StatsEntry_t *pxEntry = pxDequeAt(pxDeque, pxDeque->ucCount++);
+
+    pxEntry->fValue = fValue;
+    pxEntry->ulTimeMs = ulNowMs;
+
+    return pxDequeAt(pxDeque, 0)->fValue;
+}
+
+void vChannelStatsInit(ChannelStats_t *pxStats, const ChannelStatsConfig_t *pxConfig)
+{
+    memset(pxStats, 0, sizeof(ChannelStats_t));
+    pxStats->pxConfig = pxConfig;
+}
+
+// Back to no samples, e.g. with the max reset from the touch pad
+void vChannelStatsReset(ChannelStats_t *pxStats)
+{
+    vDequeClear(&pxStats->xMin);
+    vDequeClear(&pxStats->xMax);
+    pxStats->bStarted = false;
+    pxStats->ulAboveMs = 0;
+}
+
+// The held peak after ulHoldMs falls linearly, and a sample at or above that
+// takes its place
+static float fDecayedPeak(const ChannelStats_t *pxStats, uint32_t ulNowMs)
+{
+    const ChannelStatsConfig_t *pxConfig = pxStats->pxConfig;
+    uint32_t ulAge = ulNowMs - pxStats->ulHeldMs;
+
+    if (ulAge <= pxConfig->ulHoldMs)
+        return pxStats->fHeld;
+
+    return pxStats->fHeld - pxConfig->fDecayPerS * (float)(ulAge - pxConfig->ulHoldMs) / 1000.0f;
+}
+
+void vChannelStatsAdd(ChannelStats_t *pxStats, float fValue, uint32_t ulNowMs, ChannelSummary_t *pxSummary)
+{
+    const ChannelStatsConfig_t *pxConfig = pxStats->pxConfig;
+    float fPeak = fValue;
+
+    if (!pxStats->bStarted)
+        pxStats->fAverage = fValue;
+    else
+    {
+        uint32_t ulElapsed = ulNowMs - pxStats->ulLastMs;
+        float fAlpha = (float)ulElapsed / (float)(pxConfig->ulAverageMs + ulElapsed);
+
+        pxStats->fAverage += fAlpha * (fValue - pxStats->fAverage);
+
+        // The previous sample stood for the time until this one
+        if (pxStats->fLast > pxConfig->fThreshold)
+            pxStats->ulAboveMs += ulElapsed;
+
+        fPeak = fDecayedPeak(pxStats, ulNowMs);
+    }
+
+    if (!pxStats->bStarted || (fValue >= fPeak))
+    {
+        pxStats->fHeld = fValue;
+        pxStats->ulHeldMs = ulNowMs;
+        fPeak = fValue;
+    }
+
+    pxStats->fLast = fValue;
+    pxStats->ulLastMs = ulNowMs;
+    pxStats->bStarted = true;
+
+    pxSummary->fMin = fDequePush(&pxStats->xMin, fValue, ulNowMs, pxConfig->ulWindowMs, false);
+    pxSummary->fMax = fDequePush(&pxStats->xMax, fValue, ulNowMs, pxConfig->ulWindowMs, true);
+    pxSummary->fAverage = pxStats->fAverage;
+    pxSummary->fPeak = fPeak;
+    pxSummary->ulAboveMs = pxStats->ulAboveMs;
+}
@@ -0,0 +1,8 @@
+#include "channels.h"
+
+static const char *const pcChannelNames[CHANNEL_COUNT] = {"Boost", "IAT", "Oil", "Coolant", "Timing", "HPFP"};
+
+const char *pcChannelName(uint8_t ucChannel)
+{
+    return (ucChannel < CHANNEL_COUNT) ? pcChannelNames[ucChannel] : "?";
+}
@@ -0,0 +1,395 @@
+#include "display.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLYPH_CACHE_SLOTS_MAX 16
+
+// Columns of the classic 5x7 font (LSB is the top row) for the characters
+// numeric fields use: the same glyphs LCDWIKI_GUI prints
+static const uint8_t ucGlyphs[][5] = {
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
+    {0x72, 0x49, 0x49, 0x49, 0x46}, // 2
+    {0x21, 0x41, 0x49, 0x4D, 0x33}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x31}, // 6
+    {0x41, 0x21, 0x11, 0x09, 0x07}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+    {0x46, 0x49, 0x49, 0x29, 0x1E}, // 9
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // .
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // space and anything else
+};
+
+// A pre-rendered RGB565 character cell
+typedef struct
+{
+    char c;
+    uint16_t ui16Colour;
+    uint32_t ulLastUse;
+    uint16_t *pui16Pixels;
+} GlyphSlot_t;
+
+// Cached cells per text size (1 to 5). Size 4 is not used by any field. The
+// big boost digits get enough slots for a whole digit set in one colour,
+// about 50 KB in total
+static const uint8_t ucSlotsPerSize[GLYPH_SIZE_MAX] = {16, 16, 16, 0, 12};
+
+static GlyphSlot_t xGlyphCache[GLYPH_SIZE_MAX][GLYPH_CACHE_SLOTS_MAX];
+static uint8_t ucCacheSlots[GLYPH_SIZE_MAX];
+static uint32_t ulCacheClock = 0;
+
+static const HalSurface_t *pxDisplay = NULL;
+static uint32_t (*pxClock)(void) = NULL;
+static DisplayStats_t xStats;
+
+static const uint8_t *pucGlyph(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return ucGlyphs[c - '0'];
+    if (c == '.')
+        return ucGlyphs[10];
+    if (c == '-')
+        return ucGlyphs[11];
+
+    return ucGlyphs[12];
+}
+
+static void vRenderGlyph(uint16_t *pui16Pixels, char c, uint8_t ucSize, uint16_t ui16Colour)
+{
+    const uint8_t *pucColumns = pucGlyph(c);
+    int16_t i16Width = GLYPH_COLUMNS * ucSize;
+
+    for (register uint8_t ucRow = 0; ucRow < GLYPH_ROWS; ucRow++)
+    {
+        uint16_t *pui16Line = &pui16Pixels[ucRow * ucSize * i16Width];
+
+        for (register uint8_t ucColumn = 0; ucColumn < GLYPH_COLUMNS; ucColumn++)
+        {
+            bool bSet = (ucColumn < 5) && (pucColumns[ucColumn] & (1 << ucRow));
+
+            for (register uint8_t k = 0; k < ucSize; k++)
+                pui16Line[(ucColumn * ucSize) + k] = bSet ? ui16Colour : DISPLAY_BACK_COLOUR;
+        }
+
+        for (register uint8_t k = 1; k < ucSize; k++)
+            memcpy(&pui16Line[k * i16Width], pui16Line, i16Width * sizeof(uint16_t));
+    }
+}
+
+// Finds the cell in the cache, rendering it over the least recently used
+// slot on a miss. NULL when this size has no cache
+static const uint16_t *pui16CachedGlyph(char c, uint8_t ucSize, uint16_t ui16Colour)
+{
+    GlyphSlot_t *pxSlots = xGlyphCache[ucSize - 1];
+    GlyphSlot_t *pxVictim = NULL;
+
+    for (register uint8_t i = 0; i < ucCacheSlots[ucSize - 1]; i++)
+    {
+        if ((pxSlots[i].c == c) && (pxSlots[i].ui16Colour == ui16Colour))
+        {
+            pxSlots[i].ulLastUse = ++ulCacheClock;
+            xStats.ulCacheHits++;
+            return pxSlots[i].pui16Pixels;
+        }
+
+        if ((pxVictim == NULL) || (pxSlots[i].ulLastUse < pxVictim->ulLastUse))
+            pxVictim = &pxSlots[i];
+    }
+
+    if (pxVictim == NULL)
+        return NULL;
+
+    vRenderGlyph(pxVictim->pui16Pixels, c, ucSize, ui16Colour);
+    pxVictim->c = c;
+    pxVictim->ui16Colour = ui16Colour;
+    pxVictim->ulLastUse = ++ulCacheClock;
+    xStats.ulCacheMisses++;
+
+    return pxVictim->pui16Pixels;
+}
+
+// One character cell in a single address window. Cached cells go out in one
+// burst; uncached sizes expand each font row once and push it ucSize times
+static void vDrawGlyph(int16_t i16X, int16_t i16Y, char c, uint8_t ucSize, uint16_t ui16Colour)
+{
+    int16_t i16Width = GLYPH_COLUMNS * ucSize;
+    int16_t i16Height = GLYPH_ROWS * ucSize;
+    const uint16_t *pui16Cached = pui16CachedGlyph(c, ucSize, ui16Colour);
+
+    pxDisplay->vSetWindow(pxDisplay->pvContext, i16X, i16Y, i16X + i16Width - 1, i16Y + i16Height - 1);
+
+    if (pui16Cached != NULL)
+        pxDisplay->vPushPixels(pxDisplay->pvContext, pui16Cached, i16Width * i16Height, true);
+    else
+    {
+        uint16_t ui16Row[GLYPH_COLUMNS * GLYPH_SIZE_MAX];
+        const uint8_t *pucColumns = pucGlyph(c);
+
+        for (register uint8_t ucRow = 0; ucRow < GLYPH_ROWS; ucRow++)
+        {
+            for (register uint8_t ucColumn = 0; ucColumn < GLYPH_COLUMNS; ucColumn++)
+            {
+                bool bSet = (ucColumn < 5) && (pucColumns[ucColumn] & (1 << ucRow));
+
+                for (register uint8_t k = 0; k < ucSize; k++)
+                    ui16Row[(ucColumn * ucSize) + k] = bSet ? ui16Colour : DISPLAY_BACK_COLOUR;
+            }
+
+            for (register uint8_t k = 0; k < ucSize; k++)
+                pxDisplay->vPushPixels(pxDisplay->pvContext, ui16Row, i16Width, (ucRow == 0) && (k == 0));
+        }
+    }
+
+    xStats.ulBytesPushed += i16Width * i16Height * sizeof(uint16_t);
+    xStats.ulGlyphsDrawn++;
+}
+
+// Allocates the glyph cache once; sizes whose slots cannot be allocated fall
+// back to drawing row by row
+void vDisplayInit(const HalSurface_t *pxSurface, uint32_t (*pxMicros)(void))
+{
+    pxDisplay = pxSurface;
+    pxClock = pxMicros;
+    memset(&xStats, 0, sizeof(xStats));
+
+    for (register uint8_t ucSize = 1; ucSize <= GLYPH_SIZE_MAX; ucSize++)
+    {
+        size_t xBytes = GLYPH_COLUMNS * GLYPH_ROWS * ucSize * ucSize * sizeof(uint16_t);
+        uint8_t ucSlots = 0;
+
+        while (ucSlots < ucSlotsPerSize[ucSize - 1])
+        {
+            GlyphSlot_t *pxSlot = &xGlyphCache[ucSize - 1][ucSlots];
+
+            pxSlot->pui16Pixels = (uint16_t *)malloc(xBytes);
+            if (pxSlot->pui16Pixels == NULL)
+                break;
+
+            pxSlot->c = '\0';
+            pxSlot->ulLastUse = 0;
+            ucSlots++;
+        }
+
+        ucCacheSlots[ucSize - 1] = ucSlots;
+    }
+}
+
+static void vRecordRenderTime(uint32_t ulMicros)
+{
+    uint8_t ucBucket = 0;
+    uint32_t ulLimit = RENDER_HISTOGRAM_FIRST_US;
+
+    while ((ucBucket < RENDER_HISTOGRAM_BUCKETS - 1) && (ulMicros >= ulLimit))
+    {
+        ucBucket++;
+        ulLimit *= 2;
+    }
+
+    xStats.ulRenderHistogram[ucBucket]++;
+}
+
+// i16X may be DISPLAY_CENTER, resolved once for the full field width
+void vFieldInit(DisplayField_t *pxField, int16_t i16X, int16_t i16Y, uint8_t ucSize, uint8_t ucWidth)
+{
+    if (ucWidth > FIELD_WIDTH_MAX)
+        ucWidth = FIELD_WIDTH_MAX;
+    if (ucSize > GLYPH_SIZE_MAX)
+        ucSize = GLYPH_SIZE_MAX;
+
+    if (i16X == DISPLAY_CENTER)
+        i16X = (DISPLAY_WIDTH - (ucWidth * GLYPH_COLUMNS * ucSize)) / 2;
+
+    pxField->i16X = i16X;
+    pxField->i16Y = i16Y;
+    pxField->ucSize = ucSize;
+    pxField->ucWidth = ucWidth;
+    pxField->cText[0] = '\0';
+    pxField->bDrawn = false;
+}
+
+// The next draw repaints every character, e.g. after a full screen clear
+void vFieldInvalidate(DisplayField_t *pxField)
+{
+    pxField->bDrawn = false;
+}
+
+// Right aligns pcText in the field and repaints only the cells whose
+// character changed, or all of them when the colour changed
+void vFieldDrawText(DisplayField_t *pxField, const char *pcText, uint16_t ui16Colour)
+{
+    char cText[FIELD_WIDTH_MAX + 1];
+    size_t xLength = strlen(pcText);
+
+    if (xLength > pxField->ucWidth)
+        xLength = pxField->ucWidth;
+
+    memset(cText, ' ', pxField->ucWidth);
+    memcpy(&cText[pxField->ucWidth - xLength], pcText, xLength);
+    cText[pxField->ucWidth] = '\0';
+
+    bool bFull = !pxField->bDrawn || (pxField->ui16Colour != ui16Colour);
+
+    if (!bFull && (strcmp(cText, pxField->cText) == 0))
+    {
+        xStats.ulFieldsSkipped++;
+        return;
+    }
+
+    uint32_t ulStart = pxClock();
+
+    for (register uint8_t i = 0; i < pxField->ucWidth; i++)
+    {
+        if (!bFull && (cText[i] == pxField->cText[i]))
+        {
+            xStats.ulGlyphsSkipped++;
+            continue;
+        }
+
+        vDrawGlyph(pxField->i16X + (i * GLYPH_COLUMNS * pxField->ucSize), pxField->i16Y, cText[i], pxField->ucSize, ui16Colour);
+    }
+
+    vRecordRenderTime(pxClock() - ulStart);
+
+    memcpy(pxField->cText, cText, sizeof(cText));
+    pxField->ui16Colour = ui16Colour;
+    pxField->bDrawn = true;
+}
+
+void vFieldDrawInt(DisplayField_t *pxField, int32_t i32Value, uint16_t ui16Colour)
+{
+    char cText[12];
+
+    snprintf(cText, sizeof(cText), "%ld", (long)i32Value);
+    vFieldDrawText(pxField, cText, ui16Colour);
+}
+
+void vFieldDrawFloat(DisplayField_t *pxField, float fValue, uint8_t ucDecimals, uint16_t ui16Colour)
+{
+    char cText[16];
+
+    snprintf(cText, sizeof(cText), "%.*f", ucDecimals, fValue);
+    vFieldDrawText(pxField, cText, ui16Colour);
+}
+
+void vBarInit(DisplayBar_t *pxBar, int16_t i16X, int16_t i16Y, uint8_t ucWidth, uint8_t ucHeight, float fMin, float fMax,
+              uint16_t (*pxColour)(int16_t), uint16_t ui16MarkerColour)
+{
+    if (ucWidth > BAR_WIDTH_MAX)
+        ucWidth = BAR_WIDTH_MAX;
+    if (ucHeight > BAR_HEIGHT_MAX)
+        ucHeight = BAR_HEIGHT_MAX;
+
+    pxBar->i16X = i16X;
+    pxBar->i16Y = i16Y;
+    pxBar->ucWidth = ucWidth;
+    pxBar->ucHeight = ucHeight;
+    pxBar->fMin = fMin;
+    pxBar->fMax = fMax;
+    pxBar->ui16MarkerColour = ui16MarkerColour;
+    pxBar->ucLevel = 0;
+    pxBar->i16Marker = -1;
+    pxBar->bDrawn = false;
+
+    // Resolved once, drawing only looks rows up
+    for (register uint8_t i = 0; i < ucHeight; i++)
+        pxBar->ui16RowColour[i] = pxColour((int16_t)(fMin + ((float)i + 0.5f) * (fMax - fMin) / ucHeight));
+}
+
+// The next draw repaints the whole bar
+void vBarInvalidate(DisplayBar_t *pxBar)
+{
+    pxBar->bDrawn = false;
+}
+
+static uint8_t ucBarLevel(const DisplayBar_t *pxBar, float fValue)
+{
+    if (!(fValue > pxBar->fMin))
+        return 0;
+    if (fValue >= pxBar->fMax)
+        return pxBar->ucHeight;
+
+    return (uint8_t)((fValue - pxBar->fMin) * pxBar->ucHeight / (pxBar->fMax - pxBar->fMin) + 0.5f);
+}
+
+// Rows ucFrom up to ucTo (exclusive, counted from the bottom) in one address
+// window, as they are in the bar's current state
+static void vBarPaint(const DisplayBar_t *pxBar, uint8_t ucFrom, uint8_t ucTo)
+{
+    uint16_t ui16Row[BAR_WIDTH_MAX];
+    int16_t i16Bottom = pxBar->i16Y + pxBar->ucHeight - 1;
+
+    pxDisplay->vSetWindow(pxDisplay->pvContext, pxBar->i16X, i16Bottom - (ucTo - 1), pxBar->i16X + pxBar->ucWidth - 1, i16Bottom - ucFrom);
+
+    for (register uint8_t ucRow = ucTo; ucRow-- > ucFrom;)
+    {
+        uint16_t ui16Colour = DISPLAY_BACK_COLOUR;
+
+        if (ucRow == pxBar->i16Marker)
+            ui16Colour = pxBar->ui16MarkerColour;
+        else if (ucRow < pxBar->ucLevel)
+            ui16Colour = pxBar->ui16RowColour[ucRow];
+
+        for (register uint8_t i = 0; i < pxBar->ucWidth; i++)
+            ui16Row[i] = ui16Colour;
+
+        pxDisplay->vPushPixels(pxDisplay->pvContext, ui16Row, pxBar->ucWidth, ucRow == ucTo - 1);
+    }
+
+    xStats.ulBytesPushed += (ucTo - ucFrom) * pxBar->ucWidth * sizeof(uint16_t);
+}
+
+// Fills the bar up to fValue and moves the one row marker to fMarker (at or
+// below fMin for none). Only the rows between the old and the new level and
+// the old and the new marker row are pushed
+void vBarDraw(DisplayBar_t *pxBar, float fValue, float fMarker)
+{
+    uint8_t ucOldLevel = pxBar->ucLevel;
+    int16_t i16OldMarker = pxBar->i16Marker;
+    uint8_t ucMarkerLevel = ucBarLevel(pxBar, fMarker);
+
+    pxBar->ucLevel = ucBarLevel(pxBar, fValue);
+    pxBar->i16Marker = (int16_t)ucMarkerLevel - 1;
+
+    if (pxBar->bDrawn && (pxBar->ucLevel == ucOldLevel) && (pxBar->i16Marker == i16OldMarker))
+    {
+        xStats.ulFieldsSkipped++;
+        return;
+    }
+
+    uint32_t ulStart = pxClock();
+
+    if (!pxBar->bDrawn)
+        vBarPaint(pxBar, 0, pxBar->ucHeight);
+    else
+    {
+        uint8_t ucLow = (pxBar->ucLevel < ucOldLevel) ? pxBar->ucLevel : ucOldLevel;
+        uint8_t ucHigh = (pxBar->ucLevel < ucOldLevel) ? ucOldLevel : pxBar->ucLevel;
+
+        if (ucLow != ucHigh)
+            vBarPaint(pxBar, ucLow, ucHigh);
+
+        // Each marker row on its own, unless the span above covered it
+        if ((i16OldMarker >= 0) && (i16OldMarker != pxBar->i16Marker) && ((i16OldMarker < ucLow) || (i16OldMarker >= ucHigh)))
+            vBarPaint(pxBar, i16OldMarker, i16OldMarker + 1);
+        if ((pxBar->i16Marker >= 0) && (pxBar->i16Marker != i16OldMarker) && ((pxBar->i16Marker < ucLow) || (pxBar->i16Marker >= ucHigh)))
+            vBarPaint(pxBar, pxBar->i16Marker, pxBar->i16Marker + 1);
+    }
+
+    vRecordRenderTime(pxClock() - ulStart);
+
+    pxBar->bDrawn = true;
+}
+
+// Returns the counters since the previous call
+DisplayStats_t xDisplayTakeStats(void)
+{
+    DisplayStats_t xTaken = xStats;
+
+    memset(&xStats, 0, sizeof(xStats));
+
+    return xTaken;
+}
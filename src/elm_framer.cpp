@@ -0,0 +1,136 @@
+#include "elm_framer.h"
+
+#include <string.h>
+
+#define RING_MASK (ELM_RING_SIZE - 1)
+
+void vElmRingInit(ElmRing_t *pxRing)
+{
+    pxRing->ulHead = 0;
+    pxRing->ulTail = 0;
+    pxRing->ulDropped = 0;
+}
+
+// Producer side. Bytes that do not fit are dropped and counted
+size_t xElmRingWrite(ElmRing_t *pxRing, const uint8_t *pucData, size_t xLength)
+{
+    uint32_t ulHead = pxRing->ulHead;
+    uint32_t ulTail = __atomic_load_n(&pxRing->ulTail, __ATOMIC_ACQUIRE);
+    size_t xFree = ELM_RING_SIZE - (ulHead - ulTail);
+
+    if (xLength > xFree)
+    {
+        pxRing->ulDropped += xLength - xFree;
+        xLength = xFree;
+    }
+
+    size_t xFirst = ELM_RING_SIZE - (ulHead & RING_MASK);
+    if (xFirst > xLength)
+        xFirst = xLength;
+
+    memcpy(&pxRing->cData[ulHead & RING_MASK], pucData, xFirst);
+    memcpy(&pxRing->cData[0], pucData + xFirst, xLength - xFirst);
+
+    __atomic_store_n(&pxRing->ulHead, ulHead + xLength, __ATOMIC_RELEASE);
+
+    return xLength;
+}
+
+void vElmFramerInit(ElmFramer_t *pxFramer, ElmRing_t *pxRing)
+{
+    pxFramer->pxRing = pxRing;
+    pxFramer->ulLineStart = pxRing->ulTail;
+    pxFramer->ulScan = pxRing->ulTail;
+    pxFramer->ulLines = 0;
+    pxFramer->ulWrappedLines = 0;
+    pxFramer->ulTruncatedLines = 0;
+}
+
+// Drops everything received so far, e.g. stale bytes before a new request
+void vElmFramerDiscard(ElmFramer_t *pxFramer)
+{
+    uint32_t ulHead = __atomic_load_n(&pxFramer->pxRing->ulHead, __ATOMIC_ACQUIRE);
+
+    pxFramer->ulLineStart = ulHead;
+    pxFramer->ulScan = ulHead;
+    __atomic_store_n(&pxFramer->pxRing->ulTail, ulHead, __ATOMIC_RELEASE);
+}
+
+// Splits the stream on CR/LF and on the '>' prompt. Only bytes not seen by a
+// previous call are scanned, and a line is handed out in place unless it
+// wraps around the end of the ring
+ElmFrameEvent_t xElmFramerNext(ElmFramer_t *pxFramer, ElmLine_t *pxLine)
+{
+    ElmRing_t *pxRing = pxFramer->pxRing;
+    uint32_t ulHead = __atomic_load_n(&pxRing->ulHead, __ATOMIC_ACQUIRE);
+
+    // The previous view is no longer in use, release its bytes to the producer
+    __atomic_store_n(&pxRing->ulTail, pxFramer->ulLineStart, __ATOMIC_RELEASE);
+
+    while (pxFramer->ulScan != ulHead)
+    {
+        char cReceived = pxRing->cData[pxFramer->ulScan & RING_MASK];
+        uint32_t ulEnd = pxFramer->ulScan++;
+
+        if ((cReceived != '\r') && (cReceived != '\n') && (cReceived != '>'))
+            continue;
+
+        uint32_t ulStart = pxFramer->ulLineStart;
+        uint32_t ulLength = ulEnd - ulStart;
+
+        pxFramer->ulLineStart = pxFramer->ulScan;
+
+        if (cReceived == '>')
+            return ELM_FRAME_PROMPT;
+
+        if (ulLength == 0)
+            continue;
+
+        if (ulLength > ELM_LINE_MAX)
+        {
+            pxFramer->ulTruncatedLines++;
+            ulLength = ELM_LINE_MAX;
+        }
+
+        uint32_t ulOffset = ulStart & RING_MASK;
+
+        if (ulOffset + ulLength <= ELM_RING_SIZE)
+            pxLine->pcData = &pxRing->cData[ulOffset];
+        else
+        {
+            uint32_t ulFirst = ELM_RING_SIZE - ulOffset;
+
+            memcpy(pxFramer->cScratch, &pxRing->cData[ulOffset], ulFirst);
+            memcpy(pxFramer->cScratch + ulFirst, &pxRing->cData[0], ulLength - ulFirst);
+            pxLine->pcData = pxFramer->cScratch;
+            pxFramer->ulWrappedLines++;
+        }
+
+        pxLine->ui16Length = ulLength;
+        pxFramer->ulLines++;
+
+        return ELM_FRAME_LINE;
+    }
+
+    return ELM_FRAME_NONE;
+}
+
+bool bElmLineEquals(const ElmLine_t *pxLine, const char *pcText)
+{
+    size_t xLength = strlen(pcText);
+
+    return (pxLine->ui16Length == xLength) && (memcmp(pxLine->pcData, pcText, xLength) == 0);
+}
+
+bool bElmLineContains(const ElmLine_t *pxLine, const char *pcText)
+{
+    size_t xLength = strlen(pcText);
+
+    for (size_t i = 0; i + xLength <= pxLine->ui16Length; i++)
+    {
+        if (memcmp(&pxLine->pcData[i], pcText, xLength) == 0)
+            return true;
+    }
+
+    return false;
+}
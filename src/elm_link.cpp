@@ -0,0 +1,427 @@
+#include "elm_link.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Build with -DELM_LINK_TRACE to print the traffic in the replay format the
+// native emulator reads (--replay)
+#ifdef ELM_LINK_TRACE
+#define ELM_TRACE(...) printf(__VA_ARGS__)
+#else
+#define ELM_TRACE(...)
+#endif
+
+void vElmLinkInit(ElmLink_t *pxLink, const HalTransport_t *pxTransport, const HalClock_t *pxClock)
+{
+    pxLink->pxTransport = pxTransport;
+    pxLink->pxClock = pxClock;
+    pxLink->bHeaders = false;
+    pxLink->xProfile.ucAdaptiveTiming = ELM_TIMING_DEFAULT;
+    pxLink->xProfile.ucTimeout = ELM_TIMEOUT_DEFAULT;
+    pxLink->xProfile.bResponseCount = false;
+    pxLink->i8Status = ELM_STATUS_SUCCESS;
+
+    vElmRingInit(&pxLink->xRing);
+    vElmFramerInit(&pxLink->xFramer, &pxLink->xRing);
+}
+
+// Producer side, e.g. the Bluetooth stack task. Only copies; the transport
+// wakes the link owner
+void vElmLinkReceive(ElmLink_t *pxLink, const uint8_t *pucData, size_t xLength)
+{
+    xElmRingWrite(&pxLink->xRing, pucData, xLength);
+}
+
+// Commands end with CR only. A trailing LF would count as a key press and
+// stop a monitor command right after it started
+void vElmLinkSend(ElmLink_t *pxLink, const char *pcCommand)
+{
+    const HalTransport_t *pxTransport = pxLink->pxTransport;
+
+    ELM_TRACE("> %s\n", pcCommand);
+    pxTransport->xWrite(pxTransport->pvContext, pcCommand, strlen(pcCommand));
+    pxTransport->xWrite(pxTransport->pvContext, "\r", 1);
+}
+
+void vElmLinkFlush(ElmLink_t *pxLink)
+{
+    vElmFramerDiscard(&pxLink->xFramer);
+}
+
+// Next line or prompt from the ELM327, waiting until ulStart + ulTimeoutMs
+ElmFrameEvent_t xElmLinkReadFrame(ElmLink_t *pxLink, ElmLine_t *pxLine, uint32_t ulStart, uint32_t ulTimeoutMs)
+{
+    const HalTransport_t *pxTransport = pxLink->pxTransport;
+
+    for (;;)
+    {
+        ElmFrameEvent_t xEvent = xElmFramerNext(&pxLink->xFramer, pxLine);
+
+        if (xEvent == ELM_FRAME_LINE)
+        {
+            ELM_TRACE("< %.*s\n", (int)pxLine->ui16Length, pxLine->pcData);
+        }
+        if (xEvent != ELM_FRAME_NONE)
+            return xEvent;
+
+        uint32_t ulElapsed = pxLink->pxClock->ulMillis() - ulStart;
+        if (ulElapsed >= ulTimeoutMs)
+            return ELM_FRAME_NONE;
+
+        pxTransport->vWaitForData(pxTransport->pvContext, ulTimeoutMs - ulElapsed);
+    }
+}
+
+bool bElmLinkWaitForPrompt(ElmLink_t *pxLink, uint32_t ulTimeoutMs)
+{
+    ElmLine_t xLine;
+    uint32_t ulStart = pxLink->pxClock->ulMillis();
+    ElmFrameEvent_t xEvent;
+
+    do
+        xEvent = xElmLinkReadFrame(pxLink, &xLine, ulStart, ulTimeoutMs);
+    while (xEvent == ELM_FRAME_LINE);
+
+    return xEvent == ELM_FRAME_PROMPT;
+}
+
+bool bElmLinkWaitForOK(ElmLink_t *pxLink)
+{
+    ElmLine_t xLine;
+    uint32_t ulStart = pxLink->pxClock->ulMillis();
+    ElmFrameEvent_t xEvent;
+    bool bOK = false;
+
+    while ((xEvent = xElmLinkReadFrame(pxLink, &xLine, ulStart, ELM_RESPONSE_TIMEOUT_MS)) == ELM_FRAME_LINE)
+        bOK |= bElmLineEquals(&xLine, "OK");
+
+    pxLink->i8Status = (xEvent == ELM_FRAME_PROMPT) ? ELM_STATUS_SUCCESS : ELM_STATUS_TIMEOUT;
+
+    return bOK;
+}
+
+bool bElmLinkCommand(ElmLink_t *pxLink, const char *pcCommand)
+{
+    vElmLinkSend(pxLink, pcCommand);
+
+    return bElmLinkWaitForOK(pxLink);
+}
+
+// Some clones drop the spaces of the messages too after AT S0
+int8_t i8ElmLineStatus(const ElmLine_t *pxLine)
+{
+    if (bElmLineContains(pxLine, "NO DATA") || bElmLineContains(pxLine, "NODATA"))
+        return ELM_STATUS_NO_DATA;
+    if (bElmLineContains(pxLine, "STOPPED"))
+        return ELM_STATUS_STOPPED;
+    if (bElmLineContains(pxLine, "UNABLE TO CONNECT"))
+        return ELM_STATUS_UNABLE_TO_CONNECT;
+    if (bElmLineContains(pxLine, "BUFFER FULL"))
+        return ELM_STATUS_BUFFER_OVERFLOW;
+
+    return ELM_STATUS_SUCCESS;
+}
+
+const char *pcElmStatusName(int8_t i8Status)
+{
+    switch (i8Status)
+    {
+    case ELM_STATUS_SUCCESS:
+        return "ELM_SUCCESS";
+    case ELM_STATUS_NO_RESPONSE:
+        return "ELM_NO_RESPONSE";
+    case ELM_STATUS_BUFFER_OVERFLOW:
+        return "ELM_BUFFER_OVERFLOW";
+    case ELM_STATUS_UNABLE_TO_CONNECT:
+        return "ELM_UNABLE_TO_CONNECT";
+    case ELM_STATUS_NO_DATA:
+        return "ELM_NO_DATA";
+    case ELM_STATUS_STOPPED:
+        return "ELM_STOPPED";
+    case ELM_STATUS_TIMEOUT:
+        return "ELM_TIMEOUT";
+    }
+
+    return "ELM_UNKNOWN";
+}
+
+// Sends a Mode 01 request and feeds the lines up to the prompt to pxResponse.
+// False, with the status, when the ELM327 reported an error or timed out
+static bool bElmLinkExchange(ElmLink_t *pxLink, const char *pcRequest, ObdResponse_t *pxResponse)
+{
+    ElmLine_t xLine;
+    ElmFrameEvent_t xEvent;
+    int8_t i8Status = ELM_STATUS_SUCCESS;
+
+    vObdResponseStart(pxResponse, pcRequest, pxLink->bHeaders);
+
+    vElmLinkFlush(pxLink);
+
+    vElmLinkSend(pxLink, pcRequest);
+    uint32_t ulStart = pxLink->pxClock->ulMillis();
+
+    while ((xEvent = xElmLinkReadFrame(pxLink, &xLine, ulStart, ELM_RESPONSE_TIMEOUT_MS)) == ELM_FRAME_LINE)
+    {
+        int8_t i8LineResult = i8ElmLineStatus(&xLine);
+
+        if (i8LineResult == ELM_STATUS_SUCCESS)
+            vObdResponseFeedLine(pxResponse, xLine.pcData, xLine.ui16Length);
+        else
+            i8Status = i8LineResult;
+    }
+
+    pxLink->i8Status = (xEvent == ELM_FRAME_PROMPT) ? i8Status : (int8_t)ELM_STATUS_TIMEOUT;
+
+    return pxLink->i8Status == ELM_STATUS_SUCCESS;
+}
+
+// One Mode 01 request for up to OBD_MULTI_PID_MAX PIDs. True when the answer
+// carried at least one of them; the others are not present in pxValues
+bool bElmLinkReadPids(ElmLink_t *pxLink, const uint8_t *pucPids, ObdPidValue_t *pxValues, uint8_t ucCount)
+{
+    char cRequest[OBD_REQUEST_MAX];
+    ObdResponse_t xResponse;
+
+    for (register uint8_t i = 0; i < ucCount; i++)
+    {
+        pxValues[i].ucPid = pucPids[i];
+        pxValues[i].bPresent = false;
+        pxValues[i].bValid = false;
+    }
+
+    size_t xLength = xObdBuildMultiPidRequest(cRequest, sizeof(cRequest), pucPids, ucCount);
+
+    // The ELM327 returns as soon as that many frames arrived, instead of
+    // waiting out its timeout for ECUs that might still answer
+    uint8_t ucFrames = pxLink->xProfile.bResponseCount ? ucObdExpectedFrames(pucPids, ucCount) : 0;
+
+    if ((xLength > 0) && (ucFrames > 0) && (ucFrames <= 0x0F))
+        snprintf(&cRequest[xLength], sizeof(cRequest) - xLength, "%X", ucFrames);
+
+    if (!bElmLinkExchange(pxLink, cRequest, &xResponse))
+        return false;
+
+    // An answer without any of them is as good as NO DATA
+    if (ucObdResponseDecode(&xResponse, pxValues, ucCount) == 0)
+    {
+        pxLink->i8Status = ELM_STATUS_NO_DATA;
+        return false;
+    }
+
+    return true;
+}
+
+// The supported PIDs bitmap (OBD_SUPPORT_BYTES), from 01 00 on for as long
+// as each range reports the next one. False when not even 01 00 was answered
+bool bElmLinkReadSupport(ElmLink_t *pxLink, uint8_t *pucSupported)
+{
+    char cRequest[OBD_REQUEST_MAX];
+    ObdResponse_t xResponse;
+    uint16_t ui16Base = 0x00;
+
+    memset(pucSupported, 0, OBD_SUPPORT_BYTES);
+
+    do
+    {
+        // One frame from the first ECU is enough
+        snprintf(cRequest, sizeof(cRequest), pxLink->xProfile.bResponseCount ? "01%02X1" : "01%02X", ui16Base);
+
+        if (!bElmLinkExchange(pxLink, cRequest, &xResponse) || !bObdResponseSupport(&xResponse, ui16Base, pucSupported))
+            break;
+
+        ui16Base += 0x20;
+    } while ((ui16Base <= 0xE0) && bObdPidSupported(pucSupported, ui16Base));
+
+    return ui16Base > 0x00;
+}
+
+// Short passive window on the monitor's broadcast frames. It ends as soon as
+// every monitored ID was seen once, or after ulWindowMs
+bool bElmLinkMonitorBroadcast(ElmLink_t *pxLink, BroadcastMonitor_t *pxMonitor, BroadcastPublish_t xPublish,
+                              uint32_t ulWindowMs, uint32_t ulSettleMs)
+{
+    char cPattern[4];
+    char cCommand[ELM_COMMAND_MAX];
+    ElmLine_t xLine;
+    bool bHeaders = bBroadcastNeedsHeaders(pxMonitor);
+    bool bComplete = false;
+
+    vBroadcastBuildReceiveAddress(pxMonitor, cPattern);
+    vBroadcastStartWindow(pxMonitor);
+
+    bElmLinkCommand(pxLink, "AT CAF 0"); // CAN Auto Formatting Off for non standard OBD
+
+    snprintf(cCommand, sizeof(cCommand), "AT CRA %s", cPattern); // Only receive the broadcast IDs
+    bElmLinkCommand(pxLink, cCommand);
+
+    if (bHeaders)
+        bElmLinkCommand(pxLink, "AT H1"); // IDs are needed to tell the frames apart
+
+    vElmLinkSend(pxLink, "AT MA"); // Monitor all
+    uint32_t ulStart = pxLink->pxClock->ulMillis();
+
+    while (!bComplete && ((pxLink->pxClock->ulMillis() - ulStart) < ulWindowMs))
+    {
+        if (xElmLinkReadFrame(pxLink, &xLine, ulStart, ulWindowMs) == ELM_FRAME_LINE)
+            bComplete = bBroadcastFeedLine(pxMonitor, xLine.pcData, xLine.ui16Length, bHeaders, xPublish);
+    }
+
+    vElmLinkSend(pxLink, "AT"); // Stop
+    bElmLinkWaitForPrompt(pxLink, ELM_RESPONSE_TIMEOUT_MS);
+    bElmLinkWaitForPrompt(pxLink, ulSettleMs); // "?" for the rest of the stop command, if any
+
+    if (bHeaders)
+        bElmLinkCommand(pxLink, "AT H0");
+
+    bElmLinkCommand(pxLink, "AT CRA");   // Back to the OBD receive address
+    bElmLinkCommand(pxLink, "AT CAF 1"); // Required for OBD standard PIDs
+
+    if (!bComplete)
+        pxLink->i8Status = ELM_STATUS_NO_DATA;
+
+    return bComplete;
+}
+
+// Stops whatever the ELM327 is doing and waits for its prompt, so the next
+// request is not read against the rest of an earlier answer
+bool bElmLinkResync(ElmLink_t *pxLink)
+{
+    vElmLinkFlush(pxLink);
+    bElmLinkCommand(pxLink, "AT"); // Stop
+
+    return pxLink->i8Status == ELM_STATUS_SUCCESS;
+}
+
+// Closes the protocol, so the next request opens it again, and puts back the
+// OBD settings a broadcast window changes. The protocol choice is kept
+bool bElmLinkReopen(ElmLink_t *pxLink)
+{
+    vElmLinkFlush(pxLink);
+    bElmLinkCommand(pxLink, "AT PC"); // Protocol Close
+    bElmLinkCommand(pxLink, "AT H0");
+    bElmLinkCommand(pxLink, "AT CRA");
+    bElmLinkCommand(pxLink, "AT CAF 1");
+
+    pxLink->bHeaders = false;
+
+    return pxLink->i8Status == ELM_STATUS_SUCCESS;
+}
+
+// Non-blocking: true once the prompt arrived, e.g. after an AT Z sent with
+// vElmLinkSend
+bool bElmLinkPollPrompt(ElmLink_t *pxLink)
+{
+    ElmLine_t xLine;
+    ElmFrameEvent_t xEvent;
+
+    while ((xEvent = xElmLinkReadFrame(pxLink, &xLine, pxLink->pxClock->ulMillis(), 0)) == ELM_FRAME_LINE)
+        ;
+
+    return xEvent == ELM_FRAME_PROMPT;
+}
+
+// Resets the ELM327 and configures it. The reset is paced by its prompt
+// rather than a fixed delay
+bool bElmLinkStart(ElmLink_t *pxLink, uint8_t ucProtocol)
+{
+    vElmLinkFlush(pxLink);
+    vElmLinkSend(pxLink, "AT Z"); // Reset All
+
+    pxLink->bHeaders = false;
+
+    if (!bElmLinkWaitForPrompt(pxLink, ELM_RESET_TIMEOUT_MS))
+    {
+        pxLink->i8Status = ELM_STATUS_NO_RESPONSE;
+        return false;
+    }
+
+    return bElmLinkConfigure(pxLink, ucProtocol);
+}
+
+// Everything after AT Z: no echo, spaces or linefeeds, so an answer is only
+// its hex digits and CRs, then the protocol and the link's profile. A known
+// protocol is tried first and still falls back to the automatic search, so a
+// cached value from another car costs one failed attempt instead of a wrong
+// setting
+bool bElmLinkConfigure(ElmLink_t *pxLink, uint8_t ucProtocol)
+{
+    bool bOK = true;
+
+    vElmLinkFlush(pxLink);
+    bOK &= bElmLinkCommand(pxLink, "AT E0"); // Echo off
+    bOK &= bElmLinkCommand(pxLink, "AT S0"); // Spaces off
+    bOK &= bElmLinkCommand(pxLink, "AT L0"); // Linefeeds off
+    bOK &= bElmLinkCommand(pxLink, "AT H0"); // Headers off, the broadcast window turns them on when needed
+
+    pxLink->bHeaders = false;
+
+    bOK &= bElmLinkSelectProtocol(pxLink, ucProtocol);
+    bOK &= bElmLinkApplyProfile(pxLink, &pxLink->xProfile);
+
+    return bOK;
+}
+
+bool bElmLinkApplyProfile(ElmLink_t *pxLink, const ElmProfile_t *pxProfile)
+{
+    char cCommand[ELM_COMMAND_MAX];
+    bool bOK;
+
+    snprintf(cCommand, sizeof(cCommand), "AT AT%u", pxProfile->ucAdaptiveTiming);
+    bOK = bElmLinkCommand(pxLink, cCommand);
+
+    snprintf(cCommand, sizeof(cCommand), "AT ST %02X", pxProfile->ucTimeout);
+    bOK &= bElmLinkCommand(pxLink, cCommand);
+
+    pxLink->xProfile = *pxProfile;
+
+    return bOK;
+}
+
+bool bElmLinkSelectProtocol(ElmLink_t *pxLink, uint8_t ucProtocol)
+{
+    char cCommand[ELM_COMMAND_MAX];
+
+    if (ucProtocol == ELM_PROTOCOL_AUTO)
+        snprintf(cCommand, sizeof(cCommand), "AT SP 0");
+    else
+        snprintf(cCommand, sizeof(cCommand), "AT SP A%X", ucProtocol);
+
+    return bElmLinkCommand(pxLink, cCommand);
+}
+
+// The protocol the ELM327 settled on ("A6" while it is still the automatic
+// choice, "6" when it was set), or -1 before it found one
+int8_t i8ElmLinkProtocol(ElmLink_t *pxLink)
+{
+    ElmLine_t xLine;
+    ElmFrameEvent_t xEvent;
+    int8_t i8Protocol = -1;
+
+    vElmLinkFlush(pxLink);
+    vElmLinkSend(pxLink, "AT DPN"); // Describe Protocol by Number
+    uint32_t ulStart = pxLink->pxClock->ulMillis();
+
+    while ((xEvent = xElmLinkReadFrame(pxLink, &xLine, ulStart, ELM_RESPONSE_TIMEOUT_MS)) == ELM_FRAME_LINE)
+    {
+        const char *pcData = xLine.pcData;
+        uint16_t ui16Length = xLine.ui16Length;
+
+        if ((ui16Length == 2) && (pcData[0] == 'A'))
+        {
+            pcData++;
+            ui16Length--;
+        }
+
+        if (ui16Length != 1)
+            continue; // Echo
+
+        if ((pcData[0] >= '1') && (pcData[0] <= '9'))
+            i8Protocol = pcData[0] - '0';
+        else if ((pcData[0] >= 'A') && (pcData[0] <= 'C'))
+            i8Protocol = pcData[0] - 'A' + 10;
+    }
+
+    pxLink->i8Status = (xEvent == ELM_FRAME_PROMPT) ? ELM_STATUS_SUCCESS : ELM_STATUS_TIMEOUT;
+
+    return i8Protocol;
+}
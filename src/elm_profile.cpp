@@ -0,0 +1,141 @@
+#include "elm_profile.h"
+
+#include <string.h>
+
+static const ElmProfile_t xFixedCandidates[] = {
+    // Adaptive timing, AT ST, response count
+    {1, ELM_TIMEOUT_DEFAULT, false}, // The ELM327's own settings
+    {2, ELM_TIMEOUT_DEFAULT, false},
+    {2, ELM_TIMEOUT_DEFAULT, true},
+};
+
+#define ELM_FIXED_CANDIDATES (sizeof(xFixedCandidates) / sizeof(xFixedCandidates[0]))
+
+static void vMeasure(ElmLink_t *pxLink, const uint8_t *pucPids, uint8_t ucCount, ElmCalibration_t *pxCandidate)
+{
+    ObdPidValue_t xValues[OBD_MULTI_PID_MAX];
+    uint64_t ullTotalUs = 0;
+
+    pxCandidate->bMeasured = true;
+
+    if (!bElmLinkApplyProfile(pxLink, &pxCandidate->xProfile))
+    {
+        pxCandidate->ucFailures = ELM_CALIBRATION_SAMPLES;
+        return;
+    }
+
+    // Not measured: adaptive timing needs one answer to learn from, and the
+    // first request after AT Z may still search the protocol
+    bElmLinkReadPids(pxLink, pucPids, xValues, ucCount);
+
+    for (register uint8_t i = 0; i < ELM_CALIBRATION_SAMPLES; i++)
+    {
+        uint32_t ulStart = pxLink->pxClock->ulMicros();
+        bool bOK = bElmLinkReadPids(pxLink, pucPids, xValues, ucCount);
+        uint32_t ulTook = pxLink->pxClock->ulMicros() - ulStart;
+
+        if (!bOK)
+        {
+            pxCandidate->ucFailures++;
+            bElmLinkResync(pxLink);
+            continue;
+        }
+
+        ullTotalUs += ulTook;
+        if (ulTook > pxCandidate->ulWorstUs)
+            pxCandidate->ulWorstUs = ulTook;
+    }
+
+    if (pxCandidate->ucFailures < ELM_CALIBRATION_SAMPLES)
+        pxCandidate->ulMeanUs = ullTotalUs / (ELM_CALIBRATION_SAMPLES - pxCandidate->ucFailures);
+}
+
+static uint8_t ucTunedTimeout(uint32_t ulWorstUs, uint16_t ui16MarginPercent)
+{
+    uint32_t ulTimeout = ((uint64_t)ulWorstUs * ui16MarginPercent / 100 + 3999) / 4000;
+
+    if (ulTimeout < ELM_TIMEOUT_MIN)
+        ulTimeout = ELM_TIMEOUT_MIN;
+    if (ulTimeout > 0xFF)
+        ulTimeout = 0xFF;
+
+    return ulTimeout;
+}
+
+// Shorter than the ELM327's own timeout, or without adaptive timing to
+// stretch it: an ECU slower than during the calibration gets NO DATA
+bool bElmProfileTuned(const ElmProfile_t *pxProfile)
+{
+    return (pxProfile->ucAdaptiveTiming == 0) || (pxProfile->ucTimeout < ELM_TIMEOUT_DEFAULT);
+}
+
+static ElmCalibration_t *pxAddCandidate(ElmCalibrationResult_t *pxResult, const ElmProfile_t *pxProfile)
+{
+    ElmCalibration_t *pxCandidate = &pxResult->xCandidates[pxResult->ucCount++];
+
+    memset(pxCandidate, 0, sizeof(ElmCalibration_t));
+    pxCandidate->xProfile = *pxProfile;
+
+    return pxCandidate;
+}
+
+// Times the same Mode 01 batch under each candidate profile and keeps the
+// fastest one that answered every request. The tuned AT ST comes from the
+// slowest answer seen with the response count on, where the round trip is
+// the ECU's answer time rather than the ELM327's timeout. Adaptive timing is
+// only turned off with a wider AT ST and for a clear gain, a few samples
+// say little about the ECU's slowest answer. The link is left on the kept
+// profile, or on the one it had when none was stable
+bool bElmProfileCalibrate(ElmLink_t *pxLink, const uint8_t *pucPids, uint8_t ucCount, ElmCalibrationResult_t *pxResult)
+{
+    ElmProfile_t xPrevious = pxLink->xProfile;
+    int8_t i8Fixed = -1;
+
+    pxResult->ucCount = 0;
+    pxResult->i8Chosen = -1;
+
+    if ((ucCount == 0) || (ucCount > OBD_MULTI_PID_MAX))
+        return false;
+
+    for (register uint8_t i = 0; i < ELM_FIXED_CANDIDATES; i++)
+        vMeasure(pxLink, pucPids, ucCount, pxAddCandidate(pxResult, &xFixedCandidates[i]));
+
+    const ElmCalibration_t *pxCounted = &pxResult->xCandidates[ELM_FIXED_CANDIDATES - 1];
+
+    if (pxCounted->ucFailures == 0)
+    {
+        ElmProfile_t xTuned;
+
+        xTuned.ucAdaptiveTiming = 2;
+        xTuned.ucTimeout = ucTunedTimeout(pxCounted->ulWorstUs, ELM_TIMEOUT_MARGIN_PERCENT);
+        xTuned.bResponseCount = true;
+        vMeasure(pxLink, pucPids, ucCount, pxAddCandidate(pxResult, &xTuned));
+
+        // Adaptive timing off: the tuned timeout alone bounds a missing frame
+        xTuned.ucAdaptiveTiming = 0;
+        xTuned.ucTimeout = ucTunedTimeout(pxCounted->ulWorstUs, ELM_TIMEOUT_FIXED_MARGIN_PERCENT);
+        i8Fixed = pxResult->ucCount;
+        vMeasure(pxLink, pucPids, ucCount, pxAddCandidate(pxResult, &xTuned));
+    }
+
+    for (register uint8_t i = 0; i < pxResult->ucCount; i++)
+    {
+        const ElmCalibration_t *pxCandidate = &pxResult->xCandidates[i];
+
+        if ((pxCandidate->ucFailures > 0) || (i == i8Fixed))
+            continue;
+
+        if ((pxResult->i8Chosen < 0) || (pxCandidate->ulMeanUs < pxResult->xCandidates[pxResult->i8Chosen].ulMeanUs))
+            pxResult->i8Chosen = i;
+    }
+
+    if ((i8Fixed >= 0) && (pxResult->xCandidates[i8Fixed].ucFailures == 0) &&
+        ((pxResult->i8Chosen < 0) ||
+         ((uint64_t)pxResult->xCandidates[i8Fixed].ulMeanUs * 100 <
+          (uint64_t)pxResult->xCandidates[pxResult->i8Chosen].ulMeanUs * (100 - ELM_FIXED_GAIN_PERCENT))))
+        pxResult->i8Chosen = i8Fixed;
+
+    bElmLinkApplyProfile(pxLink, (pxResult->i8Chosen >= 0) ? &pxResult->xCandidates[pxResult->i8Chosen].xProfile : &xPrevious);
+
+    return pxResult->i8Chosen >= 0;
+}
@@ -0,0 +1,151 @@
+#include "elm_recovery.h"
+
+#include <string.h>
+
+void vElmRecoveryInit(ElmRecovery_t *pxRecovery, uint8_t ucProtocol, uint32_t ulNowMs)
+{
+    memset(pxRecovery, 0, sizeof(ElmRecovery_t));
+    pxRecovery->ucProtocol = ucProtocol;
+    pxRecovery->i8Pending = ELM_RECOVERY_NONE;
+    pxRecovery->ulResetBackoffMs = ELM_RECOVERY_RESET_BACKOFF_MS;
+    pxRecovery->ulNextResetMs = ulNowMs;
+}
+
+// NO DATA is the ECU's answer, the link is fine and the scheduler backs the
+// PID off. A lost prompt, STOPPED or a full buffer escalate with each failure
+// in a row; UNABLE TO CONNECT needs at least the protocol reopened
+void vElmRecoveryFailed(ElmRecovery_t *pxRecovery, int8_t i8Status, uint32_t ulNowMs)
+{
+    int8_t i8Tier;
+
+    if (i8Status == ELM_STATUS_NO_DATA)
+    {
+        pxRecovery->ulCount[ELM_RECOVERY_RETRY]++;
+        return;
+    }
+
+    if (pxRecovery->ucLinkFailures < UINT8_MAX)
+        pxRecovery->ucLinkFailures++;
+
+    // The first failure is only retried, each one after it goes a tier further
+    i8Tier = (pxRecovery->ucLinkFailures <= ELM_RECOVERY_RESET) ? (int8_t)(pxRecovery->ucLinkFailures - 1) : (int8_t)ELM_RECOVERY_RESET;
+
+    if ((i8Status == ELM_STATUS_UNABLE_TO_CONNECT) && (i8Tier < ELM_RECOVERY_PROTOCOL))
+        i8Tier = ELM_RECOVERY_PROTOCOL;
+
+    if ((i8Tier == ELM_RECOVERY_RESET) && ((int32_t)(ulNowMs - pxRecovery->ulNextResetMs) < 0))
+        i8Tier = ELM_RECOVERY_PROTOCOL;
+
+    if (i8Tier > pxRecovery->i8Pending)
+        pxRecovery->i8Pending = i8Tier;
+}
+
+void vElmRecoverySucceeded(ElmRecovery_t *pxRecovery)
+{
+    pxRecovery->ucLinkFailures = 0;
+    pxRecovery->ulResetBackoffMs = ELM_RECOVERY_RESET_BACKOFF_MS;
+}
+
+bool bElmRecoveryActive(const ElmRecovery_t *pxRecovery)
+{
+    return pxRecovery->bResetting || (pxRecovery->i8Pending != ELM_RECOVERY_NONE);
+}
+
+static void vSendReset(ElmRecovery_t *pxRecovery, ElmLink_t *pxLink)
+{
+    uint32_t ulNow = pxLink->pxClock->ulMillis();
+
+    vElmLinkFlush(pxLink);
+    vElmLinkSend(pxLink, "AT Z"); // Reset All
+    pxLink->bHeaders = false;
+
+    pxRecovery->bResetting = true;
+    pxRecovery->ulResetSentMs = ulNow;
+    pxRecovery->ulNextResetMs = ulNow + pxRecovery->ulResetBackoffMs;
+
+    if (pxRecovery->ulResetBackoffMs < ELM_RECOVERY_RESET_BACKOFF_MAX_MS)
+        pxRecovery->ulResetBackoffMs <<= 1;
+}
+
+// Polls a reset in progress; the reset tier's link time runs from AT Z to
+// the link being configured again
+static uint32_t ulPollReset(ElmRecovery_t *pxRecovery, ElmLink_t *pxLink)
+{
+    uint32_t ulElapsed = pxLink->pxClock->ulMillis() - pxRecovery->ulResetSentMs;
+
+    if (!bElmLinkPollPrompt(pxLink))
+    {
+        if (ulElapsed < ELM_RESET_TIMEOUT_MS)
+            return ELM_RECOVERY_POLL_MS;
+
+        // Another reset once the backoff allows, the protocol tier until then
+        pxRecovery->ulResetTimeouts++;
+        pxRecovery->bResetting = false;
+        pxRecovery->ulLinkUs[ELM_RECOVERY_RESET] += ulElapsed * 1000;
+        pxRecovery->i8Pending = ELM_RECOVERY_PROTOCOL;
+        return 0;
+    }
+
+    uint32_t ulStart = pxLink->pxClock->ulMicros();
+
+    bElmLinkConfigure(pxLink, pxRecovery->ucProtocol); // AT Z dropped the profile too
+
+    pxRecovery->bResetting = false;
+    pxRecovery->ulLinkUs[ELM_RECOVERY_RESET] += ulElapsed * 1000 + (pxLink->pxClock->ulMicros() - ulStart);
+
+    return 0;
+}
+
+// One recovery action. Returns 0 when the link may carry a request at the
+// next step, otherwise how long to wait before polling again
+uint32_t ulElmRecoveryStep(ElmRecovery_t *pxRecovery, ElmLink_t *pxLink)
+{
+    if (pxRecovery->bResetting)
+        return ulPollReset(pxRecovery, pxLink);
+
+    int8_t i8Tier = pxRecovery->i8Pending;
+    int8_t i8Status = pxLink->i8Status; // The error that caused it, for the caller's counters
+    uint32_t ulStart = pxLink->pxClock->ulMicros();
+
+    if (i8Tier == ELM_RECOVERY_NONE)
+        return 0;
+
+    pxRecovery->i8Pending = ELM_RECOVERY_NONE;
+    pxRecovery->ulCount[i8Tier]++;
+
+    switch (i8Tier)
+    {
+    case ELM_RECOVERY_RESYNC:
+        bElmLinkResync(pxLink);
+        break;
+    case ELM_RECOVERY_PROTOCOL:
+        bElmLinkReopen(pxLink);
+        break;
+    case ELM_RECOVERY_RESET:
+        vSendReset(pxRecovery, pxLink);
+        pxLink->i8Status = i8Status;
+        return ELM_RECOVERY_POLL_MS;
+    }
+
+    pxRecovery->ulLinkUs[i8Tier] += pxLink->pxClock->ulMicros() - ulStart;
+    pxLink->i8Status = i8Status;
+
+    return 0;
+}
+
+const char *pcElmRecoveryTierName(uint8_t ucTier)
+{
+    switch (ucTier)
+    {
+    case ELM_RECOVERY_RETRY:
+        return "retry";
+    case ELM_RECOVERY_RESYNC:
+        return "resync";
+    case ELM_RECOVERY_PROTOCOL:
+        return "protocol";
+    case ELM_RECOVERY_RESET:
+        return "reset";
+    }
+
+    return "unknown";
+}
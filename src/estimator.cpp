@@ -0,0 +1,152 @@
+#include "estimator.h"
+
+#define ESTIMATOR_GAP_HORIZONS 4 // A sample this many horizons after the last starts over, e.g. after a link failure
+
+void vEstimatorInit(Estimator_t *pxEstimator, const EstimatorConfig_t *pxConfig)
+{
+    pxEstimator->pxConfig = pxConfig;
+    pxEstimator->fValue = 0;
+    pxEstimator->fRate = 0;
+    pxEstimator->ulSampleMs = 0;
+    pxEstimator->ulIntervalMs = pxConfig->ulHorizonMs;
+    pxEstimator->fLastSample = 0;
+    pxEstimator->fLow = 0;
+    pxEstimator->fHigh = 0;
+    pxEstimator->bStarted = false;
+}
+
+// The span of this and the previous sample, widened by the margin and cut to
+// the valid range
+static void vSetBounds(Estimator_t *pxEstimator, float fPrevious, float fMeasured)
+{
+    const EstimatorConfig_t *pxConfig = pxEstimator->pxConfig;
+    float fLow = ((fPrevious < fMeasured) ? fPrevious : fMeasured) - pxConfig->fMargin;
+    float fHigh = ((fPrevious > fMeasured) ? fPrevious : fMeasured) + pxConfig->fMargin;
+
+    pxEstimator->fLow = (fLow > pxConfig->fMin) ? fLow : pxConfig->fMin;
+    pxEstimator->fHigh = (fHigh < pxConfig->fMax) ? fHigh : pxConfig->fMax;
+    pxEstimator->fLastSample = fMeasured;
+}
+
+static uint32_t ulHorizon(const Estimator_t *pxEstimator)
+{
+    uint32_t ulHorizonMs = pxEstimator->ulIntervalMs + pxEstimator->ulIntervalMs / 2;
+
+    return (ulHorizonMs < pxEstimator->pxConfig->ulHorizonMs) ? ulHorizonMs : pxEstimator->pxConfig->ulHorizonMs;
+}
+
+// Unbounded, for the filter's own prediction
+static float fExtrapolate(const Estimator_t *pxEstimator, uint32_t ulNowMs)
+{
+    uint32_t ulHorizonMs = ulHorizon(pxEstimator);
+    uint32_t ulAge = ulNowMs - pxEstimator->ulSampleMs;
+
+    if ((int32_t)ulAge < 0)
+        ulAge = 0;
+    if (ulAge > ulHorizonMs)
+        ulAge = ulHorizonMs;
+
+    return pxEstimator->fValue + pxEstimator->fRate * (float)ulAge;
+}
+
+// Predicts the sample from the last value and rate, then corrects both by
+// their share of the error
+void vEstimatorUpdate(Estimator_t *pxEstimator, float fMeasured, uint32_t ulSampleMs)
+{
+    const EstimatorConfig_t *pxConfig = pxEstimator->pxConfig;
+    uint32_t ulElapsed = ulSampleMs - pxEstimator->ulSampleMs;
+
+    if (!pxEstimator->bStarted || (pxConfig->ulHorizonMs == 0) || (ulElapsed == 0) ||
+        (ulElapsed > pxConfig->ulHorizonMs * ESTIMATOR_GAP_HORIZONS))
+    {
+        pxEstimator->fValue = fMeasured;
+        pxEstimator->fRate = 0;
+        pxEstimator->ulSampleMs = ulSampleMs;
+        pxEstimator->bStarted = true;
+        vSetBounds(pxEstimator, fMeasured, fMeasured);
+        return;
+    }
+
+    float fPredicted = fExtrapolate(pxEstimator, ulSampleMs);
+    float fError = fMeasured - fPredicted;
+    float fMaxRate = pxConfig->fMaxRatePerS / 1000.0f;
+
+    pxEstimator->fValue = fPredicted + pxConfig->fAlpha * fError;
+    pxEstimator->fRate += pxConfig->fBeta * fError / (float)ulElapsed;
+
+    if (pxEstimator->fRate > fMaxRate)
+        pxEstimator->fRate = fMaxRate;
+    else if (pxEstimator->fRate < -fMaxRate)
+        pxEstimator->fRate = -fMaxRate;
+
+    pxEstimator->ulSampleMs = ulSampleMs;
+    pxEstimator->ulIntervalMs = ulElapsed;
+    vSetBounds(pxEstimator, pxEstimator->fLastSample, fMeasured);
+}
+
+float fEstimatorAt(const Estimator_t *pxEstimator, uint32_t ulNowMs)
+{
+    float fEstimate = fExtrapolate(pxEstimator, ulNowMs);
+
+    if (fEstimate < pxEstimator->fLow)
+        return pxEstimator->fLow;
+    if (fEstimate > pxEstimator->fHigh)
+        return pxEstimator->fHigh;
+
+    return fEstimate;
+}
+
+// False once the estimate holds still, so the renderer can go back to
+// waiting for samples
+bool bEstimatorMoving(const Estimator_t *pxEstimator, uint32_t ulNowMs)
+{
+    return pxEstimator->bStarted && (pxEstimator->fRate != 0) &&
+           ((int32_t)(ulNowMs - pxEstimator->ulSampleMs) < (int32_t)ulHorizon(pxEstimator));
+}
+
+// pxConfigs has one entry per channel
+void vEstimatorBankInit(EstimatorBank_t *pxBank, const EstimatorConfig_t *pxConfigs)
+{
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        vEstimatorInit(&pxBank->xEstimators[i], &pxConfigs[i]);
+        pxBank->ulLastSampleMs[i] = 0;
+        pxBank->fLastSample[i] = 0;
+    }
+}
+
+// Feeds the samples that are new in the snapshot and replaces the values of
+// the estimated channels with their estimate at ulNowMs. The max values stay
+// as sampled. Returns the channels whose estimate is still moving, to be
+// drawn again ESTIMATOR_FRAME_MS later
+uint32_t ulEstimatorBankApply(EstimatorBank_t *pxBank, TelemetrySnapshot_t *pxSnapshot, uint32_t ulNowMs)
+{
+    uint32_t ulMoving = 0;
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        TelemetryChannel_t *pxChannel = &pxSnapshot->xChannels[i];
+        Estimator_t *pxEstimator = &pxBank->xEstimators[i];
+
+        if (!pxChannel->bValid || (pxEstimator->pxConfig->ulHorizonMs == 0))
+            continue;
+
+        if (!pxEstimator->bStarted || (pxChannel->ulTimestampMs != pxBank->ulLastSampleMs[i]) ||
+            (pxChannel->fValue != pxBank->fLastSample[i]))
+        {
+            vEstimatorUpdate(pxEstimator, pxChannel->fValue, pxChannel->ulTimestampMs);
+            pxBank->ulLastSampleMs[i] = pxChannel->ulTimestampMs;
+            pxBank->fLastSample[i] = pxChannel->fValue;
+        }
+
+        pxChannel->fValue = fEstimatorAt(pxEstimator, ulNowMs);
+
+        if ((pxChannel->fMax != TELEMETRY_NO_MAX) && (pxChannel->fValue > pxChannel->fMax))
+            pxChannel->fValue = pxChannel->fMax;
+
+        if (bEstimatorMoving(pxEstimator, ulNowMs))
+            ulMoving |= (uint32_t)1 << i;
+    }
+
+    return ulMoving;
+}
@@ -0,0 +1,116 @@
+#include "gauges.h"
+
+#include "display.h"
+
+// Per widget of the active layout, by its index
+typedef union
+{
+    DisplayField_t xField;
+    DisplayBar_t xBar;
+} WidgetState_t;
+
+static const Layout_t *pxLayout = &xLayouts[LAYOUT_STREET];
+static WidgetState_t xStates[LAYOUT_WIDGETS_MAX];
+
+void vGaugesInit(const HalSurface_t *pxSurface, const HalClock_t *pxClock)
+{
+    vDisplayInit(pxSurface, pxClock->ulMicros);
+    vGaugesSetLayout(LAYOUT_STREET);
+}
+
+// Callers clear the screen and draw the new layout's labels and lines
+// (vHomeScreen), with the display lock held
+void vGaugesSetLayout(uint8_t ucLayout)
+{
+    if (ucLayout >= LAYOUT_COUNT)
+        return;
+
+    pxLayout = &xLayouts[ucLayout];
+
+    for (register uint8_t i = 0; (i < pxLayout->ucCount) && (i < LAYOUT_WIDGETS_MAX); i++)
+    {
+        const LayoutWidget_t *pxWidget = &pxLayout->pxWidgets[i];
+
+        if ((pxWidget->ucKind == WIDGET_VALUE) || (pxWidget->ucKind == WIDGET_MAX))
+            vFieldInit(&xStates[i].xField, pxWidget->i16X, pxWidget->i16Y, pxWidget->i16Height, pxWidget->i16Width);
+        else if (pxWidget->ucKind == WIDGET_BAR)
+            vBarInit(&xStates[i].xBar, pxWidget->i16X, pxWidget->i16Y, pxWidget->i16Width, pxWidget->i16Height,
+                     pxWidget->pxFormat->i32Zero, pxWidget->pxFormat->i32ValidMax, pxWidget->pxColour, pxWidget->ui16Colour);
+    }
+}
+
+const Layout_t *pxGaugesLayout(void)
+{
+    return pxLayout;
+}
+
+// After the screen was cleared
+void vGaugesInvalidate(void)
+{
+    for (register uint8_t i = 0; (i < pxLayout->ucCount) && (i < LAYOUT_WIDGETS_MAX); i++)
+    {
+        uint8_t ucKind = pxLayout->pxWidgets[i].ucKind;
+
+        if ((ucKind == WIDGET_VALUE) || (ucKind == WIDGET_MAX))
+            vFieldInvalidate(&xStates[i].xField);
+        else if (ucKind == WIDGET_BAR)
+            vBarInvalidate(&xStates[i].xBar);
+    }
+}
+
+// False when the value is outside the format's range
+static bool bFormatText(const WidgetFormat_t *pxFormat, float fValue, DisplayField_t *pxField, uint16_t (*pxColour)(int16_t))
+{
+    // Compared as a float first: NaN and TELEMETRY_NO_MAX fail here
+    if (!((fValue > pxFormat->i32ValidMin - 1) && (fValue < pxFormat->i32ValidMax + 1)))
+        return false;
+
+    int32_t i32Value = fValue; // Whole units, as the OBD encodings carry them
+
+    int32_t i32Shown = i32Value - pxFormat->i32Zero;
+    uint16_t ui16Colour = pxColour(i32Value);
+
+    if (pxFormat->bClampZero && (i32Shown < 0))
+        i32Shown = 0;
+
+    if (pxFormat->ucDecimals == 0)
+        vFieldDrawInt(pxField, i32Shown / pxFormat->i32Divisor, ui16Colour);
+    else
+        vFieldDrawFloat(pxField, (float)i32Shown / pxFormat->i32Divisor, pxFormat->ucDecimals, ui16Colour);
+
+    return true;
+}
+
+// Walks the active layout and redraws the widgets of the channels in
+// ulChannelMask from one snapshot
+void vGaugesRender(const TelemetrySnapshot_t *pxSnapshot, uint32_t ulChannelMask)
+{
+    for (register uint8_t i = 0; (i < pxLayout->ucCount) && (i < LAYOUT_WIDGETS_MAX); i++)
+    {
+        const LayoutWidget_t *pxWidget = &pxLayout->pxWidgets[i];
+
+        if ((pxWidget->ucKind > WIDGET_BAR) || !(ulChannelMask & GAUGES_CHANNEL_BIT(pxWidget->ucChannel)))
+            continue;
+
+        const TelemetryChannel_t *pxChannel = &pxSnapshot->xChannels[pxWidget->ucChannel];
+
+        if (!pxChannel->bValid)
+            continue;
+
+        switch (pxWidget->ucKind)
+        {
+        case WIDGET_VALUE:
+            bFormatText(pxWidget->pxFormat, pxChannel->fValue, &xStates[i].xField, pxWidget->pxColour);
+            break;
+        case WIDGET_MAX:
+            // TELEMETRY_NO_MAX until the first sample after a reset
+            if (!bFormatText(pxWidget->pxFormat, pxChannel->fMax, &xStates[i].xField, pxWidget->pxColour))
+                vFieldDrawText(&xStates[i].xField, "", WHITE);
+            break;
+        case WIDGET_BAR:
+            if ((pxChannel->fValue >= pxWidget->pxFormat->i32ValidMin) && (pxChannel->fValue <= pxWidget->pxFormat->i32ValidMax))
+                vBarDraw(&xStates[i].xBar, pxChannel->fValue, pxChannel->xStats.fPeak);
+            break;
+        }
+    }
+}
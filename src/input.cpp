@@ -0,0 +1,28 @@
+#include "input.h"
+
+void vInputInit(InputButton_t *pxButton, const HalInput_t *pxInput)
+{
+    pxButton->pxInput = pxInput;
+    pxButton->ui16HeldTicks = 0;
+}
+
+// Counts hold ticks while pressed. A release, or holding on past the reset
+// time, ends the press
+InputEvent_t xInputPoll(InputButton_t *pxButton)
+{
+    const HalInput_t *pxInput = pxButton->pxInput;
+
+    if (pxInput->bIsPressed(pxInput->pvContext) && (pxButton->ui16HeldTicks <= INPUT_RESET_TICKS))
+    {
+        pxButton->ui16HeldTicks++;
+        return INPUT_EVENT_HELD;
+    }
+
+    if (pxButton->ui16HeldTicks == 0)
+        return INPUT_EVENT_NONE;
+
+    bool bReset = pxButton->ui16HeldTicks >= INPUT_RESET_TICKS;
+    pxButton->ui16HeldTicks = 0;
+
+    return bReset ? INPUT_EVENT_RESET : INPUT_EVENT_NONE;
+}
@@ -0,0 +1,140 @@
+#include "layout.h"
+
+#include <string.h>
+#include "colour_bands.h"
+#include "display.h"
+#include "gauges.h"
+
+// Colour bands, resolved at compile time
+typedef ColourBands<WHITE, ColourBand<230, YELLOW>, ColourBand<240, ORANGE>, ColourBand<250, RED>> BoostColour_t;
+typedef ColourBands<WHITE, ColourBand<40, YELLOW>, ColourBand<50, ORANGE>, ColourBand<60, RED>> IATColour_t;
+typedef ColourBands<CYAN, ColourBand<70, WHITE>, ColourBand<90, YELLOW>, ColourBand<100, ORANGE>, ColourBand<110, RED>> OilColour_t;
+typedef ColourBands<CYAN, ColourBand<70, WHITE>, ColourBand<95, YELLOW>, ColourBand<100, ORANGE>, ColourBand<105, RED>> CoolantColour_t;
+typedef ColourBands<WHITE> PlainColour_t;
+
+static_assert((BoostColour_t::ui16Of(229) == WHITE) && (BoostColour_t::ui16Of(230) == YELLOW) &&
+                  (BoostColour_t::ui16Of(249) == ORANGE) && (BoostColour_t::ui16Of(250) == RED),
+              "boost bands");
+static_assert((OilColour_t::ui16Of(-40) == CYAN) && (OilColour_t::ui16Of(70) == WHITE) && (OilColour_t::ui16Of(109) == ORANGE),
+              "oil bands");
+
+// Valid range, zero, divisor, decimals, clamp to zero
+static constexpr WidgetFormat_t xBoostFormat = {1, 254, 100, 100, 2, true}; // kPa absolute as bar of boost
+static constexpr WidgetFormat_t xBoostMaxFormat = {BOOST_RESET_VALUE + 1, 254, 100, 100, 2, true};
+static constexpr WidgetFormat_t xTemperatureFormat = {TEMP_MIN_VALUE, TEMP_MAX_VALUE, 0, 1, 0, false};
+static constexpr WidgetFormat_t xTimingFormat = {-63, 63, 0, 1, 0, false};
+static constexpr WidgetFormat_t xHPFPFormat = {100, 25499, 0, 100, 0, false}; // kPa as bar
+
+#define VALUE(channel, x, y, characters, size, format, colour) \
+    {WIDGET_VALUE, channel, x, y, characters, size, &format, colour::ui16Of, 0, NULL}
+#define MAX(channel, x, y, characters, size, format, colour) \
+    {WIDGET_MAX, channel, x, y, characters, size, &format, colour::ui16Of, 0, NULL}
+#define BAR(channel, x, y, width, height, format, colour, marker) \
+    {WIDGET_BAR, channel, x, y, width, height, &format, colour::ui16Of, marker, NULL}
+#define LABEL(text, x, y, size, colour) {WIDGET_LABEL, 0, x, y, 0, size, NULL, NULL, colour, text}
+#define LINE(x1, y1, x2, y2) {WIDGET_LINE, 0, x1, y1, (x2) - (x1), (y2) - (y1), NULL, NULL, WHITE, NULL}
+#define FRAME(x1, y1, x2, y2) {WIDGET_FRAME, 0, x1, y1, (x2) - (x1), (y2) - (y1), NULL, NULL, WHITE, NULL}
+
+// Boost on top, temperatures in the middle, timing and fuel pressure below
+static constexpr LayoutWidget_t xStreetWidgets[] = {
+    VALUE(CHANNEL_BOOST, DISPLAY_CENTER, 3, 4, 5, xBoostFormat, BoostColour_t),
+    MAX(CHANNEL_BOOST, 103, 43, 4, 1, xBoostMaxFormat, BoostColour_t),
+    BAR(CHANNEL_BOOST, 1, 1, 3, 51, xBoostFormat, BoostColour_t, MAGENTA),
+    VALUE(CHANNEL_IAT, 7, 59, 3, 3, xTemperatureFormat, IATColour_t),
+    MAX(CHANNEL_IAT, 45, 84, 3, 1, xTemperatureFormat, IATColour_t),
+    VALUE(CHANNEL_OIL, 72, 59, 3, 3, xTemperatureFormat, OilColour_t),
+    MAX(CHANNEL_OIL, 109, 84, 3, 1, xTemperatureFormat, OilColour_t),
+    VALUE(CHANNEL_COOLANT, 5, 100, 3, 2, xTemperatureFormat, CoolantColour_t),
+    MAX(CHANNEL_COOLANT, 23, 120, 3, 1, xTemperatureFormat, CoolantColour_t),
+    VALUE(CHANNEL_TIMING, 48, 100, 3, 2, xTimingFormat, PlainColour_t),
+    VALUE(CHANNEL_HPFP, 90, 100, 3, 2, xHPFPFormat, PlainColour_t),
+    LABEL("BOOST!", DISPLAY_CENTER, 43, 1, MAGENTA),
+    LABEL("IAT", 3, 84, 1, WHITE),
+    LABEL("Oil T", 69, 84, 1, WHITE),
+    LABEL("ECT", 3, 120, 1, WHITE),
+    LABEL("HPFP", 97, 120, 1, WHITE),
+    LABEL("Timing", DISPLAY_CENTER, 120, 1, WHITE),
+    FRAME(0, 0, 129, 129),
+    LINE(0, 52, 129, 52),
+    LINE(0, 94, 129, 94),
+    LINE(65, 52, 65, 94),
+    LINE(43, 94, 43, 129),
+    LINE(86, 94, 86, 129),
+};
+
+// Boost, intake air and timing only, the lower two large
+static constexpr LayoutWidget_t xTrackWidgets[] = {
+    VALUE(CHANNEL_BOOST, DISPLAY_CENTER, 3, 4, 5, xBoostFormat, BoostColour_t),
+    MAX(CHANNEL_BOOST, 103, 43, 4, 1, xBoostMaxFormat, BoostColour_t),
+    BAR(CHANNEL_BOOST, 1, 1, 3, 51, xBoostFormat, BoostColour_t, MAGENTA),
+    VALUE(CHANNEL_IAT, 7, 72, 3, 3, xTemperatureFormat, IATColour_t),
+    MAX(CHANNEL_IAT, 15, 108, 3, 2, xTemperatureFormat, IATColour_t),
+    VALUE(CHANNEL_TIMING, 72, 72, 3, 3, xTimingFormat, PlainColour_t),
+    LABEL("BOOST!", DISPLAY_CENTER, 43, 1, MAGENTA),
+    LABEL("IAT", 3, 58, 1, WHITE),
+    LABEL("Timing", 69, 58, 1, WHITE),
+    FRAME(0, 0, 129, 129),
+    LINE(0, 52, 129, 52),
+    LINE(65, 52, 65, 129),
+};
+
+// Every channel on its own row, with the max where one is kept
+static constexpr LayoutWidget_t xDiagnosticsWidgets[] = {
+    VALUE(CHANNEL_BOOST, 42, 3, 4, 2, xBoostFormat, BoostColour_t),
+    MAX(CHANNEL_BOOST, 100, 11, 4, 1, xBoostMaxFormat, BoostColour_t),
+    VALUE(CHANNEL_IAT, 42, 24, 4, 2, xTemperatureFormat, IATColour_t),
+    MAX(CHANNEL_IAT, 100, 32, 4, 1, xTemperatureFormat, IATColour_t),
+    VALUE(CHANNEL_OIL, 42, 45, 4, 2, xTemperatureFormat, OilColour_t),
+    MAX(CHANNEL_OIL, 100, 53, 4, 1, xTemperatureFormat, OilColour_t),
+    VALUE(CHANNEL_COOLANT, 42, 66, 4, 2, xTemperatureFormat, CoolantColour_t),
+    MAX(CHANNEL_COOLANT, 100, 74, 4, 1, xTemperatureFormat, CoolantColour_t),
+    VALUE(CHANNEL_TIMING, 42, 87, 4, 2, xTimingFormat, PlainColour_t),
+    VALUE(CHANNEL_HPFP, 42, 108, 4, 2, xHPFPFormat, PlainColour_t),
+    LABEL("Boost", 3, 7, 1, MAGENTA),
+    LABEL("IAT", 3, 28, 1, WHITE),
+    LABEL("Oil T", 3, 49, 1, WHITE),
+    LABEL("ECT", 3, 70, 1, WHITE),
+    LABEL("Timing", 3, 91, 1, WHITE),
+    LABEL("HPFP", 3, 112, 1, WHITE),
+    FRAME(0, 0, 129, 129),
+};
+
+#define LAYOUT(name, widgets) {name, widgets, sizeof(widgets) / sizeof(widgets[0])}
+
+// Indexed by LayoutId_t
+constexpr Layout_t xLayouts[LAYOUT_COUNT] = {
+    LAYOUT("street", xStreetWidgets),
+    LAYOUT("track", xTrackWidgets),
+    LAYOUT("diagnostics", xDiagnosticsWidgets),
+};
+
+static_assert((sizeof(xStreetWidgets) <= sizeof(LayoutWidget_t) * LAYOUT_WIDGETS_MAX) &&
+                  (sizeof(xTrackWidgets) <= sizeof(LayoutWidget_t) * LAYOUT_WIDGETS_MAX) &&
+                  (sizeof(xDiagnosticsWidgets) <= sizeof(LayoutWidget_t) * LAYOUT_WIDGETS_MAX),
+              "a layout has more than LAYOUT_WIDGETS_MAX widgets");
+
+// -1 when there is no layout of that name
+int8_t i8LayoutFind(const char *pcName)
+{
+    for (register uint8_t i = 0; i < LAYOUT_COUNT; i++)
+    {
+        if (strcmp(xLayouts[i].pcName, pcName) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+// The first widget of that kind for the channel, NULL when the layout has none
+const LayoutWidget_t *pxLayoutWidget(const Layout_t *pxLayout, uint8_t ucKind, uint8_t ucChannel)
+{
+    for (register uint8_t i = 0; i < pxLayout->ucCount; i++)
+    {
+        const LayoutWidget_t *pxWidget = &pxLayout->pxWidgets[i];
+
+        if ((pxWidget->ucKind == ucKind) && (pxWidget->ucChannel == ucChannel))
+            return pxWidget;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,247 @@
+#include "logger.h"
+
+#include <math.h>
+#include <string.h>
+
+void vLoggerInit(Logger_t *pxLogger, const HalStorage_t *pxStorage)
+{
+    memset(pxLogger, 0, sizeof(Logger_t));
+    pxLogger->pxStorage = pxStorage;
+}
+
+static uint8_t ucPutVarint(uint8_t *pucOut, uint32_t ulValue)
+{
+    uint8_t ucLength = 0;
+
+    while (ulValue >= 0x80)
+    {
+        pucOut[ucLength++] = (uint8_t)(ulValue | 0x80);
+        ulValue >>= 7;
+    }
+    pucOut[ucLength++] = (uint8_t)ulValue;
+
+    return ucLength;
+}
+
+static bool bGetVarint(const uint8_t *pucData, size_t xEnd, size_t *pxOffset, uint32_t *pulValue)
+{
+    uint32_t ulValue = 0;
+
+    for (register uint8_t ucShift = 0; (ucShift < 35) && (*pxOffset < xEnd); ucShift += 7)
+    {
+        uint8_t ucByte = pucData[(*pxOffset)++];
+
+        ulValue |= (uint32_t)(ucByte & 0x7F) << ucShift;
+        if ((ucByte & 0x80) == 0)
+        {
+            *pulValue = ulValue;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void vPutLe(uint8_t *pucOut, uint32_t ulValue, uint8_t ucBytes)
+{
+    for (register uint8_t i = 0; i < ucBytes; i++)
+        pucOut[i] = (uint8_t)(ulValue >> (8 * i));
+}
+
+static uint32_t ulGetLe(const uint8_t *pucData, uint8_t ucBytes)
+{
+    uint32_t ulValue = 0;
+
+    for (register uint8_t i = 0; i < ucBytes; i++)
+        ulValue |= (uint32_t)pucData[i] << (8 * i);
+
+    return ulValue;
+}
+
+// Producer side. Fills in the length and pads the block before the writer
+// can see it
+bool bLoggerSeal(Logger_t *pxLogger)
+{
+    if (pxLogger->ui16Used == 0)
+        return false;
+
+    uint8_t *pucBlock = pxLogger->ucBlocks[pxLogger->ulSealed % LOGGER_BLOCK_COUNT];
+
+    vPutLe(&pucBlock[4], pxLogger->ui16Used, 2);
+    memset(&pucBlock[pxLogger->ui16Used], 0xFF, LOGGER_BLOCK_SIZE - pxLogger->ui16Used);
+    pxLogger->ui16Used = 0;
+    __atomic_store_n(&pxLogger->ulSealed, pxLogger->ulSealed + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// Producer side, never blocks. Returns true when a block was sealed, so the
+// caller can wake the writer
+bool bLoggerAppend(Logger_t *pxLogger, uint8_t ucChannel, float fValue, uint32_t ulNowMs)
+{
+    bool bSealed = false;
+
+    if (ucChannel >= CHANNEL_COUNT)
+        return false;
+
+    if (pxLogger->ui16Used > 0)
+    {
+        if ((ulNowMs - pxLogger->ulBlockStartMs >= LOGGER_BLOCK_MAX_AGE_MS) ||
+            (pxLogger->ui16Used + LOGGER_RECORD_MAX > LOGGER_BLOCK_SIZE))
+            bSealed = bLoggerSeal(pxLogger);
+    }
+
+    if (pxLogger->ui16Used == 0)
+    {
+        if (pxLogger->ulSealed - __atomic_load_n(&pxLogger->ulWritten, __ATOMIC_ACQUIRE) >= LOGGER_BLOCK_COUNT)
+        {
+            pxLogger->ulDropped++;
+            return bSealed;
+        }
+
+        vPutLe(pxLogger->ucBlocks[pxLogger->ulSealed % LOGGER_BLOCK_COUNT], ulNowMs, 4);
+        pxLogger->ui16Used = LOGGER_BLOCK_HEADER_SIZE;
+        pxLogger->ulBlockStartMs = ulNowMs;
+        pxLogger->ulLastMs = ulNowMs;
+        memset(pxLogger->i32Last, 0, sizeof(pxLogger->i32Last));
+    }
+
+    uint8_t *pucRecord = &pxLogger->ucBlocks[pxLogger->ulSealed % LOGGER_BLOCK_COUNT][pxLogger->ui16Used];
+    int32_t i32Value = (int32_t)lroundf(fValue * LOGGER_SCALE);
+    int32_t i32Delta = i32Value - pxLogger->i32Last[ucChannel];
+    uint8_t ucLength = 0;
+
+    pucRecord[ucLength++] = ucChannel;
+    ucLength += ucPutVarint(&pucRecord[ucLength], ulNowMs - pxLogger->ulLastMs);
+    ucLength += ucPutVarint(&pucRecord[ucLength], ((uint32_t)i32Delta << 1) ^ (uint32_t)(i32Delta >> 31));
+
+    pxLogger->ui16Used += ucLength;
+    pxLogger->ulLastMs = ulNowMs;
+    pxLogger->i32Last[ucChannel] = i32Value;
+    pxLogger->ulSamples++;
+
+    return bSealed;
+}
+
+// Consumer side: stores the sealed blocks, returns how many. A block the
+// storage refuses is counted and skipped so the ring keeps moving
+uint32_t ulLoggerFlush(Logger_t *pxLogger)
+{
+    const HalStorage_t *pxStorage = pxLogger->pxStorage;
+    uint32_t ulSealed = __atomic_load_n(&pxLogger->ulSealed, __ATOMIC_ACQUIRE);
+    uint32_t ulCount = 0;
+
+    if (!pxLogger->bFileHeaderWritten)
+    {
+        uint8_t ucHeader[LOGGER_FILE_HEADER_SIZE];
+
+        memcpy(ucHeader, LOGGER_MAGIC, 4);
+        ucHeader[4] = LOGGER_VERSION;
+        ucHeader[5] = CHANNEL_COUNT;
+        vPutLe(&ucHeader[6], LOGGER_BLOCK_SIZE, 2);
+
+        if (pxStorage->xAppend(pxStorage->pvContext, ucHeader, sizeof(ucHeader)) != sizeof(ucHeader))
+        {
+            pxLogger->ulWriteErrors++;
+            return 0;
+        }
+        pxLogger->bFileHeaderWritten = true;
+    }
+
+    for (uint32_t ulBlock = pxLogger->ulWritten; ulBlock != ulSealed; ulBlock++)
+    {
+        const uint8_t *pucBlock = pxLogger->ucBlocks[ulBlock % LOGGER_BLOCK_COUNT];
+
+        if (pxStorage->xAppend(pxStorage->pvContext, pucBlock, LOGGER_BLOCK_SIZE) == LOGGER_BLOCK_SIZE)
+            ulCount++;
+        else
+            pxLogger->ulWriteErrors++;
+
+        __atomic_store_n(&pxLogger->ulWritten, ulBlock + 1, __ATOMIC_RELEASE);
+    }
+
+    return ulCount;
+}
+
+bool bLogReaderOpen(LogReader_t *pxReader, const HalStorage_t *pxStorage)
+{
+    uint8_t ucHeader[LOGGER_FILE_HEADER_SIZE];
+
+    memset(pxReader, 0, sizeof(LogReader_t));
+    pxReader->pxStorage = pxStorage;
+
+    if ((pxStorage->xRead(pxStorage->pvContext, ucHeader, sizeof(ucHeader)) != sizeof(ucHeader)) ||
+        (memcmp(ucHeader, LOGGER_MAGIC, 4) != 0) || (ucHeader[4] != LOGGER_VERSION))
+        return false;
+
+    pxReader->ucChannelCount = ucHeader[5];
+    pxReader->ui16BlockSize = ulGetLe(&ucHeader[6], 2);
+
+    return (pxReader->ui16BlockSize > LOGGER_BLOCK_HEADER_SIZE) && (pxReader->ui16BlockSize <= LOGGER_BLOCK_SIZE);
+}
+
+// Loads the next block with a sane header, skipping damaged ones
+static bool bNextBlock(LogReader_t *pxReader)
+{
+    const HalStorage_t *pxStorage = pxReader->pxStorage;
+
+    for (;;)
+    {
+        if (pxStorage->xRead(pxStorage->pvContext, pxReader->ucBlock, pxReader->ui16BlockSize) != pxReader->ui16BlockSize)
+            return false;
+
+        uint16_t ui16Used = ulGetLe(&pxReader->ucBlock[4], 2);
+
+        if ((ui16Used < LOGGER_BLOCK_HEADER_SIZE) || (ui16Used > pxReader->ui16BlockSize))
+        {
+            pxReader->ulBadBlocks++;
+            continue;
+        }
+
+        pxReader->ulBlocks++;
+        pxReader->ui16Offset = LOGGER_BLOCK_HEADER_SIZE;
+        pxReader->ui16End = ui16Used;
+        pxReader->ulTimestampMs = ulGetLe(pxReader->ucBlock, 4);
+        memset(pxReader->i32Last, 0, sizeof(pxReader->i32Last));
+
+        return true;
+    }
+}
+
+bool bLogReaderNext(LogReader_t *pxReader, LogSample_t *pxSample)
+{
+    const uint8_t *pucBlock = pxReader->ucBlock;
+
+    for (;;)
+    {
+        if (pxReader->ui16Offset >= pxReader->ui16End)
+        {
+            if (!bNextBlock(pxReader))
+                return false;
+            continue;
+        }
+
+        size_t xOffset = pxReader->ui16Offset;
+        uint8_t ucChannel = pucBlock[xOffset++];
+        uint32_t ulDeltaMs;
+        uint32_t ulZigzag;
+
+        if (!bGetVarint(pucBlock, pxReader->ui16End, &xOffset, &ulDeltaMs) ||
+            !bGetVarint(pucBlock, pxReader->ui16End, &xOffset, &ulZigzag))
+        {
+            pxReader->ulBadBlocks++;
+            pxReader->ui16Offset = pxReader->ui16End;
+            continue;
+        }
+
+        pxReader->ui16Offset = xOffset;
+        pxReader->ulTimestampMs += ulDeltaMs;
+        pxReader->i32Last[ucChannel] += (int32_t)((ulZigzag >> 1) ^ (~(ulZigzag & 1) + 1));
+
+        pxSample->ulTimestampMs = pxReader->ulTimestampMs;
+        pxSample->ucChannel = ucChannel;
+        pxSample->fValue = (float)pxReader->i32Last[ucChannel] / LOGGER_SCALE;
+
+        return true;
+    }
+}
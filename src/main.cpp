@@ -1,42 +1,96 @@
 #include <Arduino.h>
-#include <ELMduino.h>
 #include <BluetoothSerial.h>
 #include "esp_types.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "driver/touch_pad.h"
 #include "driver/periph_ctrl.h"
+#include "esp_timer.h"
 #include "esp_bt_main.h"
 #include "esp_gap_bt_api.h"
+#include "esp_spp_api.h"
 #include "nvs_flash.h"
 #include <LCDWIKI_GUI.h>
 #include <SSD1283A.h>
-
-#define BLACK 0x0000
-#define CYAN 0x07FF
-#define WHITE 0xFFFF
-#define YELLOW 0xFFE0
-#define ORANGE 0xF900
-#define RED 0xF800
-#define MAGENTA 0xF81F
-
-#define CORE_0 1 // Core 0 does not work?
-#define CORE_1 1
+#include <LittleFS.h>
+#include "hal.h"
+#include "obd.h"
+#include "broadcast.h"
+#include "channels.h"
+#include "elm_link.h"
+#include "acquisition.h"
+#include "vehicle.h"
+#include "display.h"
+#include "gauges.h"
+#include "input.h"
+#include "telemetry.h"
+#include "report.h"
+#include "metrics.h"
+#include "logger.h"
+#include "playback.h"
+#include "max_store.h"
+#include "adapter_cache.h"
+#include "boot_profile.h"
+#include "startup.h"
+
+#define CORE_0 0 // Acquisition, next to the Bluetooth controller
+#define CORE_1 1 // Rendering and touch
+#define STARTUP_WORKER_PRIORITY 3
 
 #define PAIR_MAX_DEVICES 3
+#define ADAPTER_NAME "OBDII"
+#define ADAPTER_CACHED_ATTEMPTS 2     // Connections to the cached address before falling back to discovery
+#define ADAPTER_DISCOVERY_ATTEMPTS 3  // Discovery connections before the adapter is reported missing
+#define ADAPTER_RETRY_BACKOFF_MS 2000 // First wait before trying the adapter again, doubled after each miss
+#define ADAPTER_RETRY_BACKOFF_MAX_MS 30000
+#define ELM_START_ATTEMPTS 3 // AT Z and configuration before the ELM327 is reported not answering
 
 #define TOUCH_PAD_NO_CHANGE (-1)
 #define TOUCH_THRESH_NO_USE (0)
 #define TOUCH_FILTER_MODE_EN (1)
 #define TOUCHPAD_FILTER_TOUCH_PERIOD (10)
 
-#define BOOST_RESET_VALUE 99
-#define TEMP_RESET_VALUE -39
+#define OBD_MULTI_PID // Due PIDs share one Mode 01 request
+#define SCHED_REPORT_PERIOD_MS 10000
+
+#define DATA_LOGGER // Records every sample to LittleFS, decoded by tools/log_decode.cpp
+#define LOG_PATH_FORMAT "/s%03u.bin"
+#define LOG_SESSIONS_MAX 1000 // Session indices wrap around here
+#define LOG_SESSIONS_KEPT_MAX (LOG_SESSIONS_MAX / 2) // So a gap always separates the newest index from the oldest
+#define LOG_RESERVE_BYTES (256 * 1024)                // Free space for one 30 minute session
+#define PLAYBACK_FAST_PERCENT 1000
+#define PLAYBACK_FRAME_TIMEOUT_MS 100
+
+#define RENDER_BIT(channel) ((EventBits_t)1 << (channel))
+#define RENDER_ALL_BITS (RENDER_BIT(CHANNEL_COUNT) - 1)
+#define RENDER_DONE_BIT RENDER_BIT(CHANNEL_COUNT) // Set after every frame, for the playback benchmark
+
+#define KEPT_MAX_BITS (RENDER_BIT(CHANNEL_BOOST) | RENDER_BIT(CHANNEL_IAT) | RENDER_BIT(CHANNEL_OIL) | RENDER_BIT(CHANNEL_COOLANT))
+#define NVS_NAMESPACE "cpd"
+#define SHUTDOWN_LOCK_MS 500 // Wait for the max store before a restart
+
+#define CONSOLE_BAUD 115200
+#define CONSOLE_STATS_KEY 's' // Dumps the counters, latencies and stack watermarks
+#define CONSOLE_CLEAR_KEY 'c' // Clears the latency histograms and error counts
+#define CONSOLE_PLAY_KEY 'p'  // Replays the previous session log at the recorded pace
+#define CONSOLE_FAST_KEY 'f'  // The same at PLAYBACK_FAST_PERCENT
+#define CONSOLE_BENCH_KEY 'b' // The same as fast as the renderer keeps up, then prints its throughput
+#define CONSOLE_STOP_KEY 'x'  // Ends a playback and goes back to the car
+#define CONSOLE_CALIBRATE_KEY 'k' // Times the ELM327 link profiles again and keeps the fastest
+#define CONSOLE_LAYOUT_KEY 'l'    // Switches to the next screen layout
+#define CONSOLE_STATS_BIT 0x01
+#define CONSOLE_CLEAR_BIT 0x02
+#define CONSOLE_PLAY_BIT 0x04
+#define CONSOLE_FAST_BIT 0x08
+#define CONSOLE_BENCH_BIT 0x10
+#define CONSOLE_STOP_BIT 0x20
+#define CONSOLE_CALIBRATE_BIT 0x40
+#define CONSOLE_LAYOUT_BIT 0x80
 
 #define DEBUG
-//#define DEBUG_WATERMARK
 
 #ifdef DEBUG
 #define DEBUG_PRINTS(x) printf(x);
@@ -47,131 +101,157 @@
 #endif
 
 BluetoothSerial SerialBT;
-ELM327 myELM327;
 SSD1283A_GUI tft(/*CS*/ 5, /*CD*/ 33, /*RST*/ 32, /*LED*/ 25);
 
-static QueueHandle_t xQueueBoost;
-static QueueHandle_t xQueueIAT;
-static QueueHandle_t xQueueOil;
-static QueueHandle_t xQueueCoolant;
-static QueueHandle_t xQueueTimingAdvance;
-static QueueHandle_t xQueueHPFPPressure;
-
-static QueueHandle_t xQueueBoostMaxValue;
-static QueueHandle_t xQueueIATMaxValue;
-static QueueHandle_t xQueueOilMaxValue;
-static QueueHandle_t xQueueCoolantMaxValue;
+static BroadcastMonitor_t xBroadcastMonitor;
+static ElmLink_t xElmLink;
+static Acquisition_t xAcquisition;
+static InputButton_t xTouchButton;
+
+static Telemetry_t xTelemetry;
+static EventGroupHandle_t xRenderEvents; // One bit per channel with a changed value or max
+static Metrics_t xMetrics;
+static MaxStore_t xMaxStore; // Max values kept across ignition cycles, changed under xLinkLock
+static nvs_handle_t xNvsHandle;
+static AdapterCache_t xAdapterCache;
+static BootProfile_t xBootProfile;
+static bool bBootReported = false;
+static uint8_t volatile ucAdapterAddress[ADAPTER_ADDRESS_LENGTH]; // Of the open SPP connection
+static bool volatile bAdapterAddressKnown = false;
+static uint32_t ulConsoleRequests = 0; // CONSOLE_*_BIT, served by the acquisition task
+
+static TaskHandle_t xSchedulerTask = NULL;
+static TaskHandle_t xRenderTask = NULL;
+static TaskHandle_t xTouchTask = NULL;
+
+#ifdef DATA_LOGGER
+static Logger_t xLogger;
+static fs::File xLogFile;
+static TaskHandle_t xLogWriterTask = NULL;
+static uint16_t ui16LogSession = 0;
+static int16_t i16PreviousSession = -1; // The newest log before this power cycle's, -1 when there is none
+
+static Playback_t xPlayback;
+static fs::File xPlaybackFile;
+static bool bPlaying = false;
+static uint32_t ulPlaybackResets = 0; // Asked for by the driver while playing, applied to the store after
+static uint32_t ulPlaybackFramesStart;
+static uint32_t ulPlaybackFieldsStart;
+#endif
 
-static SemaphoreHandle_t xSemaphore;
+static uint32_t ulRenderFrames = 0;
 
-void vWaitForOK(void)
+// A mutex plus the time spent waiting for it, so contention on each shared
+// resource can be measured
+typedef struct
 {
-    char cPayload[64];
+    SemaphoreHandle_t xMutex;
+    uint64_t ullWaitUs;
+    uint32_t ulTakes;
+} ResourceLock_t;
 
-    for (register uint8_t i = 0; (i <= sizeof(cPayload) - 1); i++)
-        cPayload[i] = '\0';
+static ResourceLock_t xLinkLock;    // Bluetooth SPP / ELM327, and xMaxStore
+static ResourceLock_t xDisplayLock; // SSD1283A SPI
 
-    if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-    {
-        if (SerialBT.available())
-            SerialBT.readBytes(cPayload, sizeof(cPayload) - 1);
+static TaskHandle_t volatile xLinkOwnerTask = NULL;
 
-        if (strstr(cPayload, "OK\r\r>") != NULL)
-        {
-            DEBUG_PRINTS("\nOK");
-            return;
-        }
-        else
-        {
-            DEBUG_PRINTS("\nNOT OK");
-            vTaskDelay(50 / portTICK_PERIOD_MS);
-        }
+BaseType_t xLockTake(ResourceLock_t *pxLock, TickType_t xTicksToWait)
+{
+    int64_t i64Start = esp_timer_get_time();
+    BaseType_t xTaken = xSemaphoreTake(pxLock->xMutex, xTicksToWait);
 
-        xSemaphoreGive(xSemaphore);
+    if (xTaken == pdTRUE)
+    {
+        pxLock->ullWaitUs += esp_timer_get_time() - i64Start;
+        pxLock->ulTakes++;
     }
+
+    return xTaken;
+}
+
+void vLockGive(ResourceLock_t *pxLock)
+{
+    xSemaphoreGive(pxLock->xMutex);
 }
 
-UBaseType_t uxCheckHighWaterMark(void)
+bool bLockCreate(ResourceLock_t *pxLock)
 {
-    UBaseType_t uxHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
+    pxLock->xMutex = xSemaphoreCreateMutex();
+    pxLock->ullWaitUs = 0;
+    pxLock->ulTakes = 0;
 
-    return uxHighWaterMark;
+    return pxLock->xMutex != NULL;
 }
 
-BaseType_t isPressed(void)
+uint32_t ulMillis(void)
 {
-    uint16_t ui16TouchValueFiltered = 0;
+    return millis();
+}
 
-    touch_pad_read_filtered((touch_pad_t)0, &ui16TouchValueFiltered);
-    BaseType_t bReturn = ui16TouchValueFiltered < 600 ? pdTRUE : pdFALSE;
+uint32_t ulMicros(void)
+{
+    return micros();
+}
+
+static const HalClock_t xClock = {ulMillis, ulMicros};
 
-    return bReturn;
+// Runs in the Bluetooth stack task, so it only copies and wakes the link owner
+void vOnBluetoothData(const uint8_t *pucData, size_t xLength)
+{
+    vElmLinkReceive(&xElmLink, pucData, xLength);
+
+    if (xLinkOwnerTask != NULL)
+        xTaskNotifyGive(xLinkOwnerTask);
 }
 
-void vBoostColor(uint8_t ucBoost)
+// The SPP open event is the only place the address of an adapter found by
+// name shows up. It may arrive after connect() returned
+void vOnBluetoothEvent(esp_spp_cb_event_t xEvent, esp_spp_cb_param_t *pxParam)
 {
-    tft.Set_Text_Back_colour(BLACK);
-    tft.Set_Text_Size(5);
+    if (xEvent != ESP_SPP_OPEN_EVT)
+        return;
 
-    if (ucBoost <= 229)
-        tft.Set_Text_colour(WHITE);
-    else if ((ucBoost >= 230) && (ucBoost <= 239))
-        tft.Set_Text_colour(YELLOW);
-    else if ((ucBoost >= 240) && (ucBoost <= 249))
-        tft.Set_Text_colour(ORANGE);
-    else if (ucBoost >= 250)
-        tft.Set_Text_colour(RED);
+    for (register uint8_t i = 0; i < ADAPTER_ADDRESS_LENGTH; i++)
+        ucAdapterAddress[i] = pxParam->open.rem_bda[i];
+    bAdapterAddressKnown = true;
 }
 
-void vIATColor(int8_t cIAT)
+size_t xBluetoothWrite(void *pvContext, const char *pcData, size_t xLength)
 {
-    tft.Set_Text_Back_colour(BLACK);
-    tft.Set_Text_Size(3);
+    return SerialBT.write((const uint8_t *)pcData, xLength);
+}
 
-    if (cIAT <= 39)
-        tft.Set_Text_colour(WHITE);
-    else if ((cIAT >= 40) && (cIAT <= 49))
-        tft.Set_Text_colour(YELLOW);
-    else if ((cIAT >= 50) && (cIAT <= 59))
-        tft.Set_Text_colour(ORANGE);
-    else if (cIAT >= 60)
-        tft.Set_Text_colour(RED);
+// Called by the owner of xLinkLock, which vOnBluetoothData notifies
+void vBluetoothWaitForData(void *pvContext, uint32_t ulTimeoutMs)
+{
+    ulTaskNotifyTake(pdTRUE, (ulTimeoutMs / portTICK_PERIOD_MS) + 1);
 }
 
-void vOilTempColor(int8_t cOilTemperature)
+static const HalTransport_t xBluetoothTransport = {NULL, xBluetoothWrite, vBluetoothWaitForData};
+
+void vTftSetWindow(void *pvContext, int16_t i16X1, int16_t i16Y1, int16_t i16X2, int16_t i16Y2)
 {
-    tft.Set_Text_Back_colour(BLACK);
-    tft.Set_Text_Size(3);
+    tft.Set_Addr_Window(i16X1, i16Y1, i16X2, i16Y2);
+}
 
-    if (cOilTemperature <= 69)
-        tft.Set_Text_colour(CYAN);
-    else if ((cOilTemperature >= 70) && (cOilTemperature <= 89))
-        tft.Set_Text_colour(WHITE);
-    else if ((cOilTemperature >= 90) && (cOilTemperature <= 99))
-        tft.Set_Text_colour(YELLOW);
-    else if ((cOilTemperature >= 100) && (cOilTemperature <= 109))
-        tft.Set_Text_colour(ORANGE);
-    else if (cOilTemperature >= 110)
-        tft.Set_Text_colour(RED);
+void vTftPushPixels(void *pvContext, const uint16_t *pui16Pixels, uint32_t ulCount, bool bFirst)
+{
+    tft.Push_Any_Color((uint16_t *)pui16Pixels, ulCount, bFirst, 0);
 }
 
-void vCoolantTempColor(int8_t cCoolantTemperature)
+static const HalSurface_t xTftSurface = {NULL, vTftSetWindow, vTftPushPixels};
+
+bool bTouchPadPressed(void *pvContext)
 {
-    tft.Set_Text_Back_colour(BLACK);
-    tft.Set_Text_Size(2);
+    uint16_t ui16TouchValueFiltered = 0;
+
+    touch_pad_read_filtered((touch_pad_t)0, &ui16TouchValueFiltered);
 
-    if (cCoolantTemperature <= 69)
-        tft.Set_Text_colour(CYAN);
-    else if ((cCoolantTemperature >= 70) && (cCoolantTemperature <= 94))
-        tft.Set_Text_colour(WHITE);
-    else if ((cCoolantTemperature >= 95) && (cCoolantTemperature <= 99))
-        tft.Set_Text_colour(YELLOW);
-    else if ((cCoolantTemperature >= 100) && (cCoolantTemperature <= 104))
-        tft.Set_Text_colour(ORANGE);
-    else if (cCoolantTemperature >= 105)
-        tft.Set_Text_colour(RED);
+    return ui16TouchValueFiltered < 600;
 }
 
+static const HalInput_t xTouchPad = {NULL, bTouchPadPressed};
+
 bool bInitBluetooth(void)
 {
     if (!btStart())
@@ -197,8 +277,6 @@ bool bInitBluetooth(void)
 void vSetupDisplay(void)
 {
     tft.init();
-
-    tft.fillScreen(BLACK);
     tft.Set_Text_Mode(0);
 
     for (register uint8_t rotation = 0; rotation < 4; rotation++)
@@ -206,7 +284,6 @@ void vSetupDisplay(void)
         // Rotate the screen to guarantee a full empty screen
         tft.setRotation(rotation);
         tft.fillScreen(BLACK);
-        vTaskDelay(1 / portTICK_PERIOD_MS);
     }
 
     tft.setRotation(3);
@@ -220,7 +297,6 @@ void vUnpairDevices(void)
     int32_t i32Count = esp_bt_gap_get_bond_device_num();
 
     tft.Print_String("\tLooking for paired\n devices...", LEFT, 0);
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
 
     if (i32Count > 0)
     {
@@ -242,14 +318,15 @@ void vUnpairDevices(void)
             if (i32Count >= PAIR_MAX_DEVICES)
             {
                 tft.Print_String("\n\tMaximum reached", LEFT, tft.Get_Text_Y_Cousur());
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-
-                tft.Print_String("\n\tUnpairing all...", LEFT, tft.Get_Text_Y_Cousur());
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
+                tft.Print_String("\n\tUnpairing old...", LEFT, tft.Get_Text_Y_Cousur());
 
+                // The cached adapter keeps its bond, the next boot connects to it directly
                 for (register uint8_t i = 0; i < i32Count; i++)
-                    esp_bt_gap_remove_bond_device(ui8PairedDeviceBtAddr[i]);
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
+                {
+                    if (!xAdapterCache.xRecord.bHasAddress ||
+                        (memcmp(ui8PairedDeviceBtAddr[i], xAdapterCache.xRecord.ucAddress, ADAPTER_ADDRESS_LENGTH) != 0))
+                        esp_bt_gap_remove_bond_device(ui8PairedDeviceBtAddr[i]);
+                }
 
                 tft.Print_String("\n\tOK", LEFT, tft.Get_Text_Y_Cousur());
             }
@@ -257,29 +334,70 @@ void vUnpairDevices(void)
     }
     else
         tft.Print_String("\n\tNo devices paired", LEFT, tft.Get_Text_Y_Cousur());
+}
 
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+// Straight to the cached address; the name based discovery only when there
+// is none or it does not answer
+// Waits out a retry backoff, returns the next one
+static uint32_t ulAdapterBackoff(uint32_t ulBackoffMs)
+{
+    vTaskDelay(ulBackoffMs / portTICK_PERIOD_MS);
+
+    return (ulBackoffMs < ADAPTER_RETRY_BACKOFF_MAX_MS / 2) ? (ulBackoffMs << 1) : ADAPTER_RETRY_BACKOFF_MAX_MS;
 }
 
-void vSetupELM(void)
+void vConnectAdapter(void)
 {
-    tft.Print_String("\n\tSearching for OBDII", LEFT, tft.Get_Text_Y_Cousur());
+    int8_t i8Stage;
 
     SerialBT.begin("ESP32", true);
+    SerialBT.register_callback(vOnBluetoothEvent);
+    SerialBT.onData(vOnBluetoothData); // Responses go through xElmLink from the first byte
 
-    while (!SerialBT.connect("OBDII"))
-        ;
-    vTaskDelay(1500 / portTICK_PERIOD_MS);
+    if (xAdapterCache.xRecord.bHasAddress)
+    {
+        tft.Print_String("\n\tConnecting to OBDII", LEFT, tft.Get_Text_Y_Cousur());
+        i8Stage = i8BootProfileBegin(&xBootProfile, "bt cached");
 
-    while (!myELM327.begin(SerialBT, '0'))
-        ;
-    tft.Print_String("\n\tConnected to OBDII", LEFT, tft.Get_Text_Y_Cousur());
-    vTaskDelay(1500 / portTICK_PERIOD_MS);
+        for (register uint8_t i = 0; i < ADAPTER_CACHED_ATTEMPTS; i++)
+        {
+            if (SerialBT.connect(xAdapterCache.xRecord.ucAddress))
+            {
+                vBootProfileEnd(&xBootProfile, i8Stage);
+                return;
+            }
+        }
+
+        vBootProfileEnd(&xBootProfile, i8Stage);
+    }
 
-    SerialBT.println("AT Z"); // Reset All
-    vTaskDelay(50 / portTICK_PERIOD_MS);
+    tft.Print_String("\n\tSearching for OBDII", LEFT, tft.Get_Text_Y_Cousur());
+    i8Stage = i8BootProfileBegin(&xBootProfile, "bt discovery");
+
+    // The adapter may be unplugged or the car off; keep searching, less often
+    for (uint32_t ulBackoffMs = ADAPTER_RETRY_BACKOFF_MS;;)
+    {
+        for (register uint8_t i = 0; i < ADAPTER_DISCOVERY_ATTEMPTS; i++)
+        {
+            if (SerialBT.connect(ADAPTER_NAME))
+            {
+                vBootProfileEnd(&xBootProfile, i8Stage);
+                return;
+            }
+        }
+
+        vBootProfileEnd(&xBootProfile, i8Stage);
+
+        if (ulBackoffMs == ADAPTER_RETRY_BACKOFF_MS) // Once, the boot screen does not scroll
+            tft.Print_String("\n\tOBDII not found", LEFT, tft.Get_Text_Y_Cousur());
+        DEBUG_PRINTSS("OBDII not found, searching again in %u ms\n", (unsigned)ulBackoffMs);
+
+        ulBackoffMs = ulAdapterBackoff(ulBackoffMs);
+        i8Stage = i8BootProfileBegin(&xBootProfile, "bt retry");
+    }
 }
 
+
 void vSetupTouchPad(void)
 {
     touch_pad_init();
@@ -291,575 +409,669 @@ void vSetupTouchPad(void)
     touch_pad_filter_start(TOUCHPAD_FILTER_TOUCH_PERIOD);
 }
 
-void vHomeScreen(void)
+#ifdef DATA_LOGGER
+size_t xLogFileAppend(void *pvContext, const uint8_t *pucData, size_t xLength)
 {
-    tft.fillScreen(BLACK);
-    tft.Set_Text_Size(1);
-
-    tft.Set_Text_colour(MAGENTA);
-    tft.Print_String("BOOST!", CENTER, 43);
+    return xLogFile.write(pucData, xLength);
+}
 
-    tft.Set_Text_colour(WHITE);
-    tft.Print_String("IAT", 3, 84);
-    tft.Print_String("Oil T", 69, 84);
-    tft.Print_String("ECT", 3, 120);
-    tft.Print_String("HPFP", 97, 120);
-    tft.Print_String("Timing", CENTER, 120);
+static const HalStorage_t xLogStorage = {NULL, xLogFileAppend, NULL};
 
-    tft.Set_Draw_color(WHITE);
-    tft.Draw_Rectangle(0, 0, 129, 129); // Outer Line
-    tft.Draw_Line(0, 52, 129, 52);      // Horizontal line 1
-    tft.Draw_Line(0, 94, 129, 94);      // Horizontal line 2
-    tft.Draw_Line(65, 52, 65, 94);      // Vertical line 1
-    tft.Draw_Line(43, 94, 43, 129);     // Vertical line 2
-    tft.Draw_Line(86, 94, 86, 129);     // Vertical line 3
+size_t xPlaybackFileRead(void *pvContext, uint8_t *pucData, size_t xLength)
+{
+    return xPlaybackFile.read(pucData, xLength);
 }
 
-void vError(void)
+static const HalStorage_t xPlaybackStorage = {NULL, NULL, xPlaybackFileRead};
+
+// Session index of a log file name, -1 for any other file
+static int16_t i16LogSessionOf(const char *pcName)
 {
-#ifdef DEBUG
-    int8_t i8Status = myELM327.status;
-
-    if (i8Status == ELM_NO_RESPONSE)
-        printf("ERROR: ELM_NO_RESPONSE\n");
-    else if (i8Status == ELM_BUFFER_OVERFLOW)
-        printf("ERROR: ELM_BUFFER_OVERFLOW\n");
-    else if (i8Status == ELM_UNABLE_TO_CONNECT)
-        printf("ERROR: ELM_UNABLE_TO_CONNECT\n");
-    else if (i8Status == ELM_NO_DATA)
-        printf("ERROR: ELM_NO_DATA\n");
-    else if (i8Status == ELM_STOPPED)
-        printf("ERROR: ELM_STOPPED\n");
-    else if (i8Status == ELM_TIMEOUT)
-        printf("ERROR: ELM_TIMEOUT\n");
-#endif
+    if (*pcName == '/') // Older cores give the full path
+        pcName++;
 
-    SerialBT.println("AT"); // Stop
-    vWaitForOK();
+    if ((strlen(pcName) != 8) || (pcName[0] != 's') || (strspn(&pcName[1], "0123456789") != 3) || (strcmp(&pcName[4], ".bin") != 0))
+        return -1;
 
-    SerialBT.println("AT Z"); // Reset All
-    vWaitForOK();
+    return atoi(&pcName[1]);
 }
 
-void vGetBoost(void *pvParameters)
+static void vLogRemove(uint16_t ui16Session)
 {
-    static uint8_t ucBoost = 0;
-    static uint8_t ucBoostMaxValue = 0;
+    char cPath[16];
 
-    for (;;)
-    {
-        xQueuePeek(xQueueBoostMaxValue, &ucBoostMaxValue, portMAX_DELAY);
+    snprintf(cPath, sizeof(cPath), LOG_PATH_FORMAT, ui16Session);
+    LittleFS.remove(cPath);
+    DEBUG_PRINTSS("Removed %s\n", cPath);
+}
 
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            ucBoost = myELM327.manifoldPressure();
+// One file per power cycle. The indices wrap, so the sessions kept are the
+// run of indices before the widest gap: the newest ends it, the oldest
+// starts it. The oldest are removed until LOG_RESERVE_BYTES are free, the
+// newest always stays for playback
+bool bSetupLogger(void)
+{
+    uint8_t ucUsed[(LOG_SESSIONS_MAX + 7) / 8] = {0};
+    uint16_t ui16Count = 0;
+    uint16_t ui16Oldest = 0;
+    uint16_t ui16Newest = LOG_SESSIONS_MAX - 1;
+    char cPath[16];
 
-            if (myELM327.status == ELM_SUCCESS)
-            {
-                xQueueOverwrite(xQueueBoost, &ucBoost);
+    vLoggerInit(&xLogger, &xLogStorage);
 
-                if (ucBoost > ucBoostMaxValue)
-                {
-                    ucBoostMaxValue = ucBoost;
-                    xQueueOverwrite(xQueueBoostMaxValue, &ucBoostMaxValue);
-                }
-            }
-            else
-            {
-                DEBUG_PRINTS("Boost ");
-                vError();
-            }
+    if (!LittleFS.begin(true))
+    {
+        DEBUG_PRINTS("Failed to mount LittleFS\n");
+        return false;
+    }
 
-            xSemaphoreGive(xSemaphore);
-        }
+    fs::File xRoot = LittleFS.open("/");
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Get Boost: %d\n", uxHighWaterMark);
-#endif
+    for (fs::File xFile = xRoot.openNextFile(); xFile; xFile = xRoot.openNextFile())
+    {
+        int16_t i16Session = i16LogSessionOf(xFile.name());
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
+        if (i16Session >= 0)
+        {
+            ucUsed[i16Session / 8] |= 1 << (i16Session % 8);
+            ui16Count++;
+            ui16Oldest = i16Session;
+        }
     }
-}
-
-void vGetIAT(void *pvParameters)
-{
-    static int8_t cIAT = 0;
-    static int8_t cIATMaxValue = -127;
+    xRoot.close();
 
-    for (;;)
+    // Walk once around from a used index, the last used one closes the last gap
+    if (ui16Count > 0)
     {
-        xQueuePeek(xQueueIATMaxValue, &cIATMaxValue, portMAX_DELAY);
+        uint16_t ui16Start = ui16Oldest;
+        int16_t i16WidestGap = -1;
+        uint16_t ui16Gap = 0;
 
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
+        for (register uint16_t i = 1; i <= LOG_SESSIONS_MAX; i++)
         {
-            cIAT = myELM327.intakeAirTemp();
+            uint16_t ui16Index = (ui16Start + i) % LOG_SESSIONS_MAX;
 
-            if (myELM327.status == ELM_SUCCESS)
+            if (!(ucUsed[ui16Index / 8] & (1 << (ui16Index % 8))))
             {
-                xQueueOverwrite(xQueueIAT, &cIAT);
-
-                if (cIAT > cIATMaxValue)
-                {
-                    cIATMaxValue = cIAT;
-                    xQueueOverwrite(xQueueIATMaxValue, &cIATMaxValue);
-                }
+                ui16Gap++;
+                continue;
             }
-            else
+
+            if ((int16_t)ui16Gap > i16WidestGap)
             {
-                DEBUG_PRINTS("IAT ");
-                vError();
+                i16WidestGap = ui16Gap;
+                ui16Oldest = ui16Index;
+                ui16Newest = (ui16Index + LOG_SESSIONS_MAX - ui16Gap - 1) % LOG_SESSIONS_MAX;
             }
-
-            xSemaphoreGive(xSemaphore);
+            ui16Gap = 0;
         }
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Get IAT: %d\n", uxHighWaterMark);
-#endif
+        while ((ui16Oldest != ui16Newest) &&
+               ((ui16Count > LOG_SESSIONS_KEPT_MAX) || (LittleFS.totalBytes() - LittleFS.usedBytes() < LOG_RESERVE_BYTES)))
+        {
+            vLogRemove(ui16Oldest);
+            ucUsed[ui16Oldest / 8] &= ~(1 << (ui16Oldest % 8));
+            ui16Count--;
+
+            do
+                ui16Oldest = (ui16Oldest + 1) % LOG_SESSIONS_MAX;
+            while (!(ucUsed[ui16Oldest / 8] & (1 << (ui16Oldest % 8))));
+        }
 
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        i16PreviousSession = ui16Newest;
     }
+
+    ui16LogSession = (ui16Newest + 1) % LOG_SESSIONS_MAX;
+    snprintf(cPath, sizeof(cPath), LOG_PATH_FORMAT, ui16LogSession);
+    xLogFile = LittleFS.open(cPath, "w");
+    DEBUG_PRINTSS("Logging to %s\n", cPath);
+
+    return (bool)xLogFile;
 }
+#endif
 
-void vGetOilAndCoolantTemp(void *pvParameters)
+// Clears the screen and draws the labels and lines of the active layout;
+// the values follow with the next render
+void vHomeScreen(void)
 {
-    int8_t cOilTemp = 0;
-    int8_t cCoolant = 0;
-    static int8_t cOilTemperatureMaxValue = -127;
-    static int8_t cCoolantTemperatureMaxValue = -127;
+    const Layout_t *pxLayout = pxGaugesLayout();
 
-    for (;;)
+    tft.fillScreen(BLACK);
+
+    for (register uint8_t i = 0; i < pxLayout->ucCount; i++)
     {
-        xQueuePeek(xQueueOilMaxValue, &cOilTemperatureMaxValue, portMAX_DELAY);
-        xQueuePeek(xQueueCoolantMaxValue, &cCoolantTemperatureMaxValue, portMAX_DELAY);
+        const LayoutWidget_t *pxWidget = &pxLayout->pxWidgets[i];
 
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
+        switch (pxWidget->ucKind)
         {
-            char cPayload[64];
+        case WIDGET_LABEL:
+            tft.Set_Text_Size(pxWidget->i16Height);
+            tft.Set_Text_colour(pxWidget->ui16Colour);
+            tft.Print_String(pxWidget->pcText, pxWidget->i16X, pxWidget->i16Y);
+            break;
+        case WIDGET_LINE:
+            tft.Set_Draw_color(pxWidget->ui16Colour);
+            tft.Draw_Line(pxWidget->i16X, pxWidget->i16Y, pxWidget->i16X + pxWidget->i16Width, pxWidget->i16Y + pxWidget->i16Height);
+            break;
+        case WIDGET_FRAME:
+            tft.Set_Draw_color(pxWidget->ui16Colour);
+            tft.Draw_Rectangle(pxWidget->i16X, pxWidget->i16Y, pxWidget->i16X + pxWidget->i16Width, pxWidget->i16Y + pxWidget->i16Height);
+            break;
+        }
+    }
 
-            for (register uint8_t i = 0; (i <= sizeof(cPayload) - 1); i++)
-                cPayload[i] = '\0';
+    vGaugesInvalidate();
+}
 
-            SerialBT.println("AT CAF 0"); // CAN Auto Formatting Off for non standard OBD
-            vWaitForOK();
+// Console: the next layout, under the display lock the renderer draws with
+void vNextLayout(void)
+{
+    uint8_t ucLayout = (pxGaugesLayout() - xLayouts + 1) % LAYOUT_COUNT;
 
-            SerialBT.println("AT CF 488"); // CAN Filter 488
-            vWaitForOK();
+    xLockTake(&xDisplayLock, portMAX_DELAY);
+    vGaugesSetLayout(ucLayout);
+    vHomeScreen();
+    vLockGive(&xDisplayLock);
 
-            SerialBT.println("AT MR 04"); // Read header 4xx and gives time to receive
-            vTaskDelay(10 / portTICK_PERIOD_MS);
+    xEventGroupSetBits(xRenderEvents, RENDER_ALL_BITS);
+    DEBUG_PRINTSS("Layout %s\n", xLayouts[ucLayout].pcName);
+}
 
-            if (SerialBT.available())
-                SerialBT.readBytes(cPayload, sizeof(cPayload) - 1);
+bool bNvsLoad(void *pvContext, const char *pcKey, void *pvData, size_t xLength)
+{
+    size_t xStored = xLength;
 
-            SerialBT.println("AT"); // Stop
-            vWaitForOK();
+    return (nvs_get_blob(xNvsHandle, pcKey, pvData, &xStored) == ESP_OK) && (xStored == xLength);
+}
 
-            SerialBT.println("AT CAF 1"); // Required for OBD standard PIDs
-            vWaitForOK();
+bool bNvsStore(void *pvContext, const char *pcKey, const void *pvData, size_t xLength)
+{
+    return (nvs_set_blob(xNvsHandle, pcKey, pvData, xLength) == ESP_OK) && (nvs_commit(xNvsHandle) == ESP_OK);
+}
 
-            SerialBT.println("AT CF 7E8"); // CAN Filter 7E8 (OBD standard, 7E0 to 7E8)
-            vWaitForOK();
+static const HalKeyValue_t xNvs = {NULL, bNvsLoad, bNvsStore};
 
-            if ((myELM327.status == ELM_SUCCESS) && strstr(cPayload, "AT CAF 0") && strstr(cPayload, "AT CF 488") && strstr(cPayload, "AT MR 04"))
-            {
-                for (register uint8_t i = 0; i <= 3; i++)
-                {
-                    uint8_t k = 38;
-
-                    if (i == 1)
-                        k = 39;
-                    else if (i == 2)
-                        k = 53;
-                    else if (i == 3)
-                        k = 54;
-
-                    if (cPayload[k] >= '0' && cPayload[k] <= '9')
-                        cPayload[k] -= 48;
-                    else if (cPayload[k] >= 'A' && cPayload[k] <= 'F')
-                        cPayload[k] -= 55;
-                }
+// Writer side of the telemetry store: in setup() or the acquisition task
+void vRestoreMaxValues(void)
+{
+    float fMax;
 
-                uint8_t ucTempOilTemp = (cPayload[53] << 4) | cPayload[54];
-                cOilTemp = ucTempOilTemp - 40;
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        vTelemetryRestoreMax(&xTelemetry, i, bMaxStoreGet(&xMaxStore, i, &fMax) ? fMax : TELEMETRY_NO_MAX);
 
-                uint8_t ucTempCoolant = (cPayload[38] << 4) | cPayload[39];
-                cCoolant = ucTempCoolant - 40;
+    if (xRenderEvents != NULL)
+        xEventGroupSetBits(xRenderEvents, RENDER_ALL_BITS);
+}
 
-                xQueueOverwrite(xQueueOil, &cOilTemp);
-                xQueueOverwrite(xQueueCoolant, &cCoolant);
+// Only on esp_restart(); panics and brown-outs rely on the commit interval.
+// Runs in the restarting task, so it waits for the scheduler to let go of
+// the max store, and gives up rather than block the restart
+void vMaxStoreShutdown(void)
+{
+    if (xLockTake(&xLinkLock, SHUTDOWN_LOCK_MS / portTICK_PERIOD_MS) != pdTRUE)
+        return;
 
-                if (cOilTemp > cOilTemperatureMaxValue)
-                {
-                    cOilTemperatureMaxValue = cOilTemp;
-                    xQueueOverwrite(xQueueOilMaxValue, &cOilTemperatureMaxValue);
-                }
+    if (xMaxStore.bDirty)
+        bMaxStoreCommit(&xMaxStore, millis());
 
-                if (cCoolant > cCoolantTemperatureMaxValue)
-                {
-                    cCoolantTemperatureMaxValue = cCoolant;
-                    xQueueOverwrite(xQueueCoolantMaxValue, &cCoolantTemperatureMaxValue);
-                }
-            }
-            else
-            {
-                DEBUG_PRINTS("Oil Temp and Coolant ");
-                vError();
-            }
+    vLockGive(&xLinkLock);
+}
 
-            xSemaphoreGive(xSemaphore);
-        }
+void vError(const char *pcJob, int8_t i8Status)
+{
+    vMetricsError(&xMetrics, i8Status);
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Get Oil and Coolant Temp: %d\n", uxHighWaterMark);
+#ifdef DEBUG
+    printf("%s ERROR: %s\n", pcJob, pcElmStatusName(i8Status));
 #endif
-
-        vTaskDelay(15000 / portTICK_PERIOD_MS);
-    }
 }
 
-void vGetTimingAdvance(void *pvParameters)
+void vPublishChannel(uint8_t ucChannel, float fValue)
 {
-    static int8_t cTimingAdvance = 0;
+    if (ucChannel == CHANNEL_BOOST)
+        bBootProfileFirstReading(&xBootProfile);
 
-    for (;;)
-    {
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            cTimingAdvance = myELM327.timingAdvance();
+    bool bChanged = bTelemetryPublish(&xTelemetry, ucChannel, fValue, millis());
 
-            if (myELM327.status == ELM_SUCCESS)
-                xQueueOverwrite(xQueueTimingAdvance, &cTimingAdvance);
-            else
-            {
-                DEBUG_PRINTS("Timing ");
-                vError();
-            }
+    vMaxStoreUpdate(&xMaxStore, ucChannel, xTelemetry.xChannels[ucChannel].fMax, millis());
 
-            xSemaphoreGive(xSemaphore);
-        }
+#ifdef DATA_LOGGER
+    if (bLoggerAppend(&xLogger, ucChannel, fValue, millis()) && (xLogWriterTask != NULL))
+        xTaskNotifyGive(xLogWriterTask);
+#endif
+
+    vMetricsPublished(&xMetrics, ucChannel, xAcquisition.ulSentUs, xAcquisition.ulParsedUs, micros(), bChanged);
+
+    if (bChanged)
+        xEventGroupSetBits(xRenderEvents, RENDER_BIT(ucChannel));
+}
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Get Timing Advance: %d\n", uxHighWaterMark);
+void vReportSchedule(void)
+{
+#ifdef DEBUG
+    xLockTake(&xDisplayLock, portMAX_DELAY);
+    DisplayStats_t xDisplayStats = xDisplayTakeStats();
+    vLockGive(&xDisplayLock);
+
+    vReportPrint(&xAcquisition, &xDisplayStats, &xTelemetry, millis());
+    vReportPrintMetrics(&xMetrics, millis());
+    printf("Lock wait link %llu ms over %u takes, display %llu ms over %u takes\n",
+           xLinkLock.ullWaitUs / 1000, xLinkLock.ulTakes, xDisplayLock.ullWaitUs / 1000, xDisplayLock.ulTakes);
 #endif
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
-    }
+    vSchedulerResetWindow(&xAcquisition.xScheduler, millis());
+    vMetricsResetWindow(&xMetrics, millis());
 }
 
-void vGetHPFPPressure(void *pvParameters)
+// The on-demand dump is printed whatever DEBUG says and leaves the rate
+// windows running
+void vConsoleDump(void)
 {
-    static uint16_t ui16HPFPPressure = 0;
+    TelemetrySnapshot_t xSnapshot;
+
+    xLockTake(&xDisplayLock, portMAX_DELAY);
+    DisplayStats_t xDisplayStats = xDisplayTakeStats();
+    vLockGive(&xDisplayLock);
+
+    printf("--- %u ms\n", (unsigned)millis());
+    vReportPrint(&xAcquisition, &xDisplayStats, &xTelemetry, millis());
+    vReportPrintMetrics(&xMetrics, millis());
+    vTelemetryRead(&xTelemetry, &xSnapshot);
+    vReportPrintStats(&xSnapshot);
+    printf("Lock wait link %llu ms over %u takes, display %llu ms over %u takes\n",
+           xLinkLock.ullWaitUs / 1000, xLinkLock.ulTakes, xDisplayLock.ullWaitUs / 1000, xDisplayLock.ulTakes);
+    printf("Free stack words: scheduler %u, render %u, touch %u, heap %u bytes\n",
+           (unsigned)uxTaskGetStackHighWaterMark(xSchedulerTask), (unsigned)uxTaskGetStackHighWaterMark(xRenderTask),
+           (unsigned)uxTaskGetStackHighWaterMark(xTouchTask), (unsigned)esp_get_free_heap_size());
+    vReportPrintBoot(&xBootProfile);
+    printf("ELM profile AT%u ST %02X%s%s\n", xElmLink.xProfile.ucAdaptiveTiming, xElmLink.xProfile.ucTimeout,
+           xElmLink.xProfile.bResponseCount ? ", response count" : "", xAdapterCache.xRecord.bHasProfile ? ", cached" : "");
+    printf("Max store %u writes this session, %u lifetime over %u sessions, %u updates coalesced, %u failed\n",
+           (unsigned)xMaxStore.ulCommits, (unsigned)xMaxStore.xRecord.ulWrites, (unsigned)xMaxStore.xRecord.ulSessions,
+           (unsigned)xMaxStore.ulUpdates, (unsigned)xMaxStore.ulFailures);
+#ifdef DATA_LOGGER
+    printf("Logger %u samples, %u blocks written, %u dropped, %u write errors, %u of %u bytes used\n",
+           (unsigned)xLogger.ulSamples, (unsigned)xLogger.ulWritten, (unsigned)xLogger.ulDropped,
+           (unsigned)xLogger.ulWriteErrors, (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+#endif
+}
 
-    for (;;)
+// Runs in the touch task, the acquisition task serves the request between
+// two exchanges so the dump never races the scheduler state
+void vConsolePoll(void)
+{
+    while (Serial.available() > 0)
     {
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
+        uint32_t ulRequest = 0;
+
+        switch (Serial.read())
         {
-            ui16HPFPPressure = myELM327.fuelRailGuagePressure();
+        case CONSOLE_STATS_KEY:
+            ulRequest = CONSOLE_STATS_BIT;
+            break;
+        case CONSOLE_CLEAR_KEY:
+            ulRequest = CONSOLE_CLEAR_BIT;
+            break;
+        case CONSOLE_PLAY_KEY:
+            ulRequest = CONSOLE_PLAY_BIT;
+            break;
+        case CONSOLE_FAST_KEY:
+            ulRequest = CONSOLE_FAST_BIT;
+            break;
+        case CONSOLE_BENCH_KEY:
+            ulRequest = CONSOLE_BENCH_BIT;
+            break;
+        case CONSOLE_STOP_KEY:
+            ulRequest = CONSOLE_STOP_BIT;
+            break;
+        case CONSOLE_CALIBRATE_KEY:
+            ulRequest = CONSOLE_CALIBRATE_BIT;
+            break;
+        case CONSOLE_LAYOUT_KEY:
+            ulRequest = CONSOLE_LAYOUT_BIT;
+            break;
+        }
 
-            if (myELM327.status == ELM_SUCCESS)
-                xQueueOverwrite(xQueueHPFPPressure, &ui16HPFPPressure);
-            else
-            {
-                DEBUG_PRINTS("HPFP ");
-                vError();
-            }
+        __atomic_fetch_or(&ulConsoleRequests, ulRequest, __ATOMIC_RELEASE);
+    }
+}
 
-            xSemaphoreGive(xSemaphore);
-        }
+#ifdef DATA_LOGGER
+// Same store and render events as the acquisition, but not logged again
+void vPlaybackPublish(uint8_t ucChannel, float fValue)
+{
+    if (bTelemetryPublish(&xTelemetry, ucChannel, fValue, millis()))
+        xEventGroupSetBits(xRenderEvents, RENDER_BIT(ucChannel));
+}
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Get HPFP: %d\n", uxHighWaterMark);
-#endif
+uint32_t ulFieldsDrawn(const DisplayStats_t *pxStats)
+{
+    uint32_t ulFields = 0;
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
-    }
+    for (register uint8_t i = 0; i < RENDER_HISTOGRAM_BUCKETS; i++)
+        ulFields += pxStats->ulRenderHistogram[i];
+
+    return ulFields;
 }
 
-void vPrintBoost(void *pvParameters)
+void vPlaybackStop(void)
 {
-    static uint8_t ucReceivedBoost = 99;
-    static uint8_t ucReceivedBoostMaxValue = 99;
+    if (!bPlaying)
+        return;
 
-    for (;;)
+    if (xPlayback.ui16SpeedPercent == PLAYBACK_UNTHROTTLED)
     {
-        xQueuePeek(xQueueBoost, &ucReceivedBoost, portMAX_DELAY);
-        xQueuePeek(xQueueBoostMaxValue, &ucReceivedBoostMaxValue, portMAX_DELAY);
+        xLockTake(&xDisplayLock, portMAX_DELAY);
+        DisplayStats_t xDisplayStats = xDisplayTakeStats();
+        vLockGive(&xDisplayLock);
+
+        uint32_t ulMs = millis() - xPlayback.ulStartMs;
+        uint32_t ulFrames = ulRenderFrames - ulPlaybackFramesStart;
+        uint32_t ulFields = ulFieldsDrawn(&xDisplayStats);
+
+        if (ulMs > 0)
+            printf("Playback %u samples in %u ms: %u frames/s, %u field updates/s, %u B/s pushed\n",
+                   (unsigned)xPlayback.ulSamples, (unsigned)ulMs, (unsigned)(ulFrames * 1000 / ulMs),
+                   (unsigned)((uint64_t)ulFields * 1000 / ulMs), (unsigned)((uint64_t)xDisplayStats.ulBytesPushed * 1000 / ulMs));
+    }
+    else
+        printf("Playback stopped after %u samples\n", (unsigned)xPlayback.ulSamples);
 
-        float fReceivedBoost = ((float)ucReceivedBoost / 100) - 1;
-        float fReceivedBoostMaxValue = ((float)ucReceivedBoostMaxValue / 100) - 1;
+    xPlaybackFile.close();
+    bPlaying = false;
 
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            if ((ucReceivedBoost >= 1) && (ucReceivedBoost <= 254))
-            {
-                if ((ucReceivedBoost >= 1) && (ucReceivedBoost <= 100))
-                    fReceivedBoost = 0;
+    xLockTake(&xLinkLock, portMAX_DELAY);
+    vMaxStoreClear(&xMaxStore, ulPlaybackResets, millis());
+    vLockGive(&xLinkLock);
 
-                vBoostColor(ucReceivedBoost);
-                tft.Print_Number_Float(fReceivedBoost, 2, CENTER, 3, '.', 4, ' ');
+    // The maxima of the log are not the car's
+    vRestoreMaxValues();
+}
 
-                vBoostColor(ucReceivedBoostMaxValue);
-                tft.Set_Text_Size(1);
-                if (ucReceivedBoostMaxValue > BOOST_RESET_VALUE)
-                    tft.Print_Number_Float(fReceivedBoostMaxValue, 2, 103, 43, '.', 4, ' ');
-                else
-                    tft.Print_String("   ", 103, 43);
+// The previous power cycle's log, the current one is still being written
+void vPlaybackStart(uint16_t ui16SpeedPercent)
+{
+    char cPath[16];
 
-                DEBUG_PRINTSS("Boost: %.2f\n", fReceivedBoost);
-            }
+    vPlaybackStop();
 
-            xSemaphoreGive(xSemaphore);
-        }
+    if (i16PreviousSession < 0)
+        return;
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Print Boost: %d\n", uxHighWaterMark);
-#endif
+    snprintf(cPath, sizeof(cPath), LOG_PATH_FORMAT, i16PreviousSession);
+    xPlaybackFile = LittleFS.open(cPath, "r");
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
+    if (!xPlaybackFile || !bPlaybackOpen(&xPlayback, &xPlaybackStorage, ui16SpeedPercent, millis()))
+    {
+        DEBUG_PRINTSS("Cannot play %s\n", cPath);
+        xPlaybackFile.close();
+        return;
     }
+
+    // Benchmark counters start from here
+    xLockTake(&xDisplayLock, portMAX_DELAY);
+    xDisplayTakeStats();
+    vLockGive(&xDisplayLock);
+    ulPlaybackFramesStart = ulRenderFrames;
+
+    DEBUG_PRINTSS("Playing %s\n", cPath);
+    // Applied here, in the writer task, so every reset while playing is the driver's
+    vTelemetryRequestReset(&xTelemetry, RENDER_ALL_BITS);
+    xEventGroupSetBits(xRenderEvents, ulTelemetryApplyResets(&xTelemetry));
+    ulPlaybackResets = 0;
+    bPlaying = true;
 }
 
-void vPrintIAT(void *pvParameters)
+// One playback step in place of an acquisition step. Unthrottled, it waits
+// for the frame it caused so the log runs at the speed of the renderer
+void vPlaybackServe(void)
 {
-    static int8_t cReceivedIAT = 0;
-    static int8_t cReceivedIATMaxValue = 0;
+    if (xPlayback.ui16SpeedPercent == PLAYBACK_UNTHROTTLED)
+        xEventGroupClearBits(xRenderEvents, RENDER_DONE_BIT);
 
-    for (;;)
-    {
-        xQueuePeek(xQueueIAT, &cReceivedIAT, portMAX_DELAY);
-        xQueuePeek(xQueueIATMaxValue, &cReceivedIATMaxValue, portMAX_DELAY);
+    uint32_t ulWait = ulPlaybackStep(&xPlayback, vPlaybackPublish, millis());
 
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            if ((cReceivedIAT >= -39) && (cReceivedIAT <= 126))
-            {
-                vIATColor(cReceivedIAT);
-                tft.Print_Number_Int(cReceivedIAT, 7, 59, 4, ' ', 10);
-
-                vIATColor(cReceivedIATMaxValue);
-                tft.Set_Text_Size(1);
-                if (cReceivedIATMaxValue > TEMP_RESET_VALUE)
-                    tft.Print_Number_Int(cReceivedIATMaxValue, 45, 84, 4, ' ', 10);
-                else
-                    tft.Print_String("   ", 45, 84);
+    if (ulWait == PLAYBACK_END)
+        vPlaybackStop();
+    else if (ulWait > 0)
+        vTaskDelay(ulWait / portTICK_PERIOD_MS);
+    else if ((xPlayback.ui16SpeedPercent == PLAYBACK_UNTHROTTLED) && (xEventGroupGetBits(xRenderEvents) & RENDER_ALL_BITS))
+        xEventGroupWaitBits(xRenderEvents, RENDER_DONE_BIT, pdTRUE, pdFALSE, PLAYBACK_FRAME_TIMEOUT_MS / portTICK_PERIOD_MS);
+}
+#endif
 
-                DEBUG_PRINTSS("IAT: %d\n", cReceivedIAT);
-            }
+// Kept in NVS, so the next boots skip the calibration
+void vCalibrateLink(void)
+{
+    ElmCalibrationResult_t xCalibration;
 
-            xSemaphoreGive(xSemaphore);
-        }
+    xLockTake(&xLinkLock, portMAX_DELAY);
+    if (bAcquisitionCalibrate(&xAcquisition, &xCalibration))
+        bAdapterCacheSetProfile(&xAdapterCache, &xElmLink.xProfile);
+    vLockGive(&xLinkLock);
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Print IAT: %d\n", uxHighWaterMark);
+#ifdef DEBUG
+    vReportPrintCalibration(&xCalibration);
 #endif
+}
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
-    }
+void vConsoleServe(void)
+{
+    uint32_t ulRequests = __atomic_exchange_n(&ulConsoleRequests, 0, __ATOMIC_ACQUIRE);
+
+    if (ulRequests & CONSOLE_STATS_BIT)
+        vConsoleDump();
+    if (ulRequests & CONSOLE_CLEAR_BIT)
+        vMetricsClear(&xMetrics, millis());
+    if (ulRequests & CONSOLE_CALIBRATE_BIT)
+        vCalibrateLink();
+    if (ulRequests & CONSOLE_LAYOUT_BIT)
+        vNextLayout();
+#ifdef DATA_LOGGER
+    if (ulRequests & CONSOLE_STOP_BIT)
+        vPlaybackStop();
+    if (ulRequests & CONSOLE_PLAY_BIT)
+        vPlaybackStart(100);
+    if (ulRequests & CONSOLE_FAST_BIT)
+        vPlaybackStart(PLAYBACK_FAST_PERCENT);
+    if (ulRequests & CONSOLE_BENCH_BIT)
+        vPlaybackStart(PLAYBACK_UNTHROTTLED);
+#endif
 }
 
-void vPrintOilAndCoolantTemp(void *pvParameters)
+// Once, after the first boost value and with the link held: what this
+// connection needed goes to NVS for the next boot, then the profile is printed
+void vBootComplete(void)
 {
-    static int8_t cReceivedOilTemperature = 0;
-    static int8_t cReceivedCoolantTemperature = 0;
-    static int8_t cReceivedOilTemperatureMaxValue = 0;
-    static int8_t cReceivedCoolantTemperatureMaxValue = 0;
+    int8_t i8Protocol = i8ElmLinkProtocol(&xElmLink);
 
-    for (;;)
+    if (i8Protocol > 0)
     {
-        xQueuePeek(xQueueOil, &cReceivedOilTemperature, portMAX_DELAY);
-        xQueuePeek(xQueueCoolant, &cReceivedCoolantTemperature, portMAX_DELAY);
-        xQueuePeek(xQueueOilMaxValue, &cReceivedOilTemperatureMaxValue, portMAX_DELAY);
-        xQueuePeek(xQueueCoolantMaxValue, &cReceivedCoolantTemperatureMaxValue, portMAX_DELAY);
-
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            if ((cReceivedOilTemperature >= -39) && (cReceivedOilTemperature <= 126))
-            {
-                vOilTempColor(cReceivedOilTemperature);
-                tft.Print_Number_Int(cReceivedOilTemperature, 72, 59, 4, ' ', 10);
-
-                vOilTempColor(cReceivedOilTemperatureMaxValue);
-                tft.Set_Text_Size(1);
-                if (cReceivedOilTemperatureMaxValue > TEMP_RESET_VALUE)
-                    tft.Print_Number_Int(cReceivedOilTemperatureMaxValue, 109, 84, 4, ' ', 10);
-                else
-                    tft.Print_String("   ", 109, 84);
-
-                DEBUG_PRINTSS("Oil Temp: %d\n", cReceivedOilTemperature);
-            }
+        bAdapterCacheSetProtocol(&xAdapterCache, i8Protocol);
+        xAcquisition.xRecovery.ucProtocol = i8Protocol;
+    }
 
-            if ((cReceivedCoolantTemperature >= -39) && (cReceivedCoolantTemperature <= 126))
-            {
-                vCoolantTempColor(cReceivedCoolantTemperature);
-                tft.Print_Number_Int(cReceivedCoolantTemperature, 5, 100, 4, ' ', 10);
+    if (bAdapterAddressKnown)
+    {
+        uint8_t ucAddress[ADAPTER_ADDRESS_LENGTH];
 
-                vCoolantTempColor(cReceivedCoolantTemperatureMaxValue);
-                tft.Set_Text_Size(1);
-                if (cReceivedCoolantTemperatureMaxValue > TEMP_RESET_VALUE)
-                    tft.Print_Number_Int(cReceivedCoolantTemperatureMaxValue, 23, 120, 4, ' ', 10);
-                else
-                    tft.Print_String("   ", 23, 120);
+        for (register uint8_t i = 0; i < ADAPTER_ADDRESS_LENGTH; i++)
+            ucAddress[i] = ucAdapterAddress[i];
+        bAdapterCacheSetAddress(&xAdapterCache, ucAddress);
+    }
 
-                DEBUG_PRINTSS("Coolant: %d\n", cReceivedCoolantTemperature);
-            }
+#ifdef DEBUG
+    vReportPrintBoot(&xBootProfile);
+#endif
+    bBootReported = true;
+}
 
-            xSemaphoreGive(xSemaphore);
-        }
+// The calibrated profile lost answers to NO DATA, the next boot calibrates again
+void vProfileDropped(void)
+{
+    xAcquisition.bProfileDropped = false;
+    bAdapterCacheClearProfile(&xAdapterCache);
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Print Oil and Coolant Temp: %d\n", uxHighWaterMark);
+#ifdef DEBUG
+    printf("Link profile missed answers, back to the ELM327's timeout\n");
 #endif
-
-        vTaskDelay(300 / portTICK_PERIOD_MS);
-    }
 }
 
-void vPrintTimingAdvance(void *pvParameters)
+void vObdScheduler(void *pvParameters)
 {
-    static int8_t cReceivedTimingAdvance = 0;
+    uint32_t ulLastReport = millis();
+
+    xLinkOwnerTask = xTaskGetCurrentTaskHandle();
 
     for (;;)
     {
-        xQueuePeek(xQueueTimingAdvance, &cReceivedTimingAdvance, portMAX_DELAY);
-
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
+        uint32_t ulReset = ulTelemetryApplyResets(&xTelemetry);
+        if (ulReset != 0)
         {
-            if ((cReceivedTimingAdvance >= -63) && (cReceivedTimingAdvance <= 63))
+            xEventGroupSetBits(xRenderEvents, ulReset);
+#ifdef DATA_LOGGER
+            if (bPlaying) // Clears the log's max on screen now, the kept one when the playback stops
+                ulPlaybackResets |= ulReset;
+            else
+#endif
             {
-                tft.Set_Text_colour(WHITE);
-                tft.Set_Text_Back_colour(BLACK);
-                tft.Set_Text_Size(2);
-
-                tft.Print_Number_Int(cReceivedTimingAdvance, 48, 100, 4, ' ', 10);
-
-                DEBUG_PRINTSS("Timing: %d\n", cReceivedTimingAdvance);
+                xLockTake(&xLinkLock, portMAX_DELAY);
+                vMaxStoreClear(&xMaxStore, ulReset, millis());
+                vLockGive(&xLinkLock);
             }
-
-            xSemaphoreGive(xSemaphore);
         }
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Print Timing Advance: %d\n", uxHighWaterMark);
+        vConsoleServe();
+
+#ifdef DATA_LOGGER
+        if (bPlaying)
+        {
+            vPlaybackServe();
+            continue;
+        }
 #endif
 
-        vTaskDelay(300 / portTICK_PERIOD_MS);
+        // The scheduler is the only user of the ELM327 link, so it waits for
+        // it instead of dropping the cycle
+        xLockTake(&xLinkLock, portMAX_DELAY);
+        uint32_t ulIdle = ulAcquisitionStep(&xAcquisition);
+        if (!bBootReported && (xBootProfile.ulFirstReadingUs != 0))
+            vBootComplete();
+        if (xAcquisition.bProfileDropped)
+            vProfileDropped();
+        bMaxStoreService(&xMaxStore, millis());
+        vLockGive(&xLinkLock);
+
+        if (ulIdle > 0)
+        {
+            vTaskDelay(ulIdle / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        if (millis() - ulLastReport >= SCHED_REPORT_PERIOD_MS)
+        {
+            vReportSchedule();
+            ulLastReport = millis();
+        }
     }
 }
 
-void vPrintHPFPPressure(void *pvParameters)
+// Sleeps until the acquisition side flags a changed channel, then redraws
+// every pending field in one burst under a single display lock. While an
+// estimated channel is moving between samples it wakes every
+// ESTIMATOR_FRAME_MS as well, to draw the estimate
+void vRender(void *pvParameters)
 {
-    static uint16_t ui16ReceivedHPFPPressure = 0;
+    static EstimatorBank_t xEstimators;
+    uint32_t ulMoving = 0;
+
+    vEstimatorBankInit(&xEstimators, xVehicleEstimators);
 
     for (;;)
     {
-        xQueuePeek(xQueueHPFPPressure, &ui16ReceivedHPFPPressure, portMAX_DELAY);
-
-        uint8_t ucReceivedHPFPPressure = ui16ReceivedHPFPPressure / 100;
-
-        if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-        {
-            if ((ucReceivedHPFPPressure >= 1) && (ucReceivedHPFPPressure <= 254))
-            {
-                tft.Set_Text_colour(WHITE);
-                tft.Set_Text_Back_colour(BLACK);
-                tft.Set_Text_Size(2);
+        TickType_t xWait = ulMoving ? pdMS_TO_TICKS(ESTIMATOR_FRAME_MS) : portMAX_DELAY;
+        EventBits_t xPending = xEventGroupWaitBits(xRenderEvents, RENDER_ALL_BITS, pdTRUE, pdFALSE, xWait);
+        TelemetrySnapshot_t xSnapshot;
 
-                tft.Print_Number_Int(ucReceivedHPFPPressure, 90, 100, 4, ' ', 10);
+        vTelemetryRead(&xTelemetry, &xSnapshot);
 
-                DEBUG_PRINTSS("HPFP: %d\n", ui16ReceivedHPFPPressure);
-            }
+        xPending = (xPending & RENDER_ALL_BITS) | ulMoving;
+        ulMoving = ulEstimatorBankApply(&xEstimators, &xSnapshot, millis());
 
-            xSemaphoreGive(xSemaphore);
+        if (xLockTake(&xDisplayLock, portMAX_DELAY) == pdTRUE)
+        {
+            vGaugesRender(&xSnapshot, xPending);
+            vLockGive(&xDisplayLock);
         }
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Print HPFP: %d\n", uxHighWaterMark);
-#endif
-
-        vTaskDelay(300 / portTICK_PERIOD_MS);
+        vMetricsDrawn(&xMetrics, xPending, micros());
+        ulRenderFrames++;
+        xEventGroupSetBits(xRenderEvents, RENDER_DONE_BIT);
     }
 }
 
 void vTouchPadRead(void *pvParameters)
 {
-    static uint16_t ui16IncrementVar = 0;
-
     for (;;)
     {
-        if ((isPressed()) && (ui16IncrementVar <= 5))
-        {
-            vTaskDelay(100 / portTICK_PERIOD_MS);
-            ui16IncrementVar++;
-        }
-        else if (ui16IncrementVar > 0)
-        {
-            if (ui16IncrementVar > 50)
-            {
-                DEBUG_PRINTSS("Incremento: %d RESTART ESP32\n", ui16IncrementVar);
-
-                /*
-                .
-                .
-                .
-                */
-            }
-            /*else if ((ui16IncrementVar > 5) && (ui16IncrementVar <= 50))*/
-            if (ui16IncrementVar >= 5)
-            {
-                DEBUG_PRINTSS("Incremento: %d RESET VALUES\n", ui16IncrementVar);
+        InputEvent_t xEvent = xInputPoll(&xTouchButton);
 
-                uint8_t ui8BoostMin = BOOST_RESET_VALUE;
-                int8_t i8IATMin = TEMP_RESET_VALUE;
-                int8_t i8OilMin = TEMP_RESET_VALUE;
-                int8_t i8CoolantMin = TEMP_RESET_VALUE;
-
-                xQueueOverwrite(xQueueBoostMaxValue, &ui8BoostMin);
-                xQueueOverwrite(xQueueIATMaxValue, &i8IATMin);
-                xQueueOverwrite(xQueueOilMaxValue, &i8OilMin);
-                xQueueOverwrite(xQueueCoolantMaxValue, &i8CoolantMin);
-
-                if (xSemaphoreTake(xSemaphore, (TickType_t)10) == pdTRUE)
-                {
-                    tft.Set_Text_Size(1);
-                    tft.Print_String("    ", 103, 43);
-                    tft.Print_String("   ", 45, 84);
-                    tft.Print_String("   ", 109, 84);
-                    tft.Print_String("   ", 23, 120);
-
-                    xSemaphoreGive(xSemaphore);
-                }
-            }
+        if (xEvent == INPUT_EVENT_RESET)
+        {
+            DEBUG_PRINTS("RESET VALUES\n");
 
-            ui16IncrementVar = 0;
+            // Applied by the acquisition task, which also clears the kept copy
+            vTelemetryRequestReset(&xTelemetry, KEPT_MAX_BITS);
         }
 
-#ifdef DEBUG_WATERMARK
-        uint32_t uxHighWaterMark = uxCheckHighWaterMark();
-        DEBUG_PRINTSS("Free Stack Touch Pad Read: %d\n", uxHighWaterMark);
-#endif
+        vConsolePoll();
 
-        vTaskDelay(30 / portTICK_PERIOD_MS);
+        vTaskDelay(((xEvent == INPUT_EVENT_HELD) ? INPUT_HOLD_TICK_MS : INPUT_POLL_MS) / portTICK_PERIOD_MS);
     }
 }
 
-void setup()
+#ifdef DATA_LOGGER
+// Lowest priority: flash writes and erases take as long as they take, the
+// ring absorbs the wait
+void vLogWriter(void *pvParameters)
 {
-    static uint8_t ucBoostMaxValue = 0;
-    static int8_t cIATMaxValue = -127;
-    static int8_t cOilTemperatureMaxValue = -127;
-    static int8_t cCoolantTemperatureMaxValue = -127;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
+        if (ulLoggerFlush(&xLogger) > 0)
+            xLogFile.flush();
+    }
+}
+#endif
+
+// Startup stages, run by vStartupWorker on both cores as soon as what they
+// depend on is done. The boot messages on the display come from UNPAIR and
+// CONNECT only, and HOME_SCREEN waits for CONNECT, so the display needs no
+// lock before the render task exists
+typedef enum
+{
+    STAGE_NVS,
+    STAGE_BLUETOOTH,
+    STAGE_UNPAIR,
+    STAGE_CONNECT,
+    STAGE_ELM_START,
+    STAGE_CALIBRATE,
+    STAGE_ACQUISITION,
+    STAGE_DISPLAY,
+    STAGE_TOUCH,
+    STAGE_HOME_SCREEN,
+    STAGE_LOGGER,
+    STAGE_COUNT
+} StartupStageId_t;
+
+#define STARTUP_ALL_BITS (STARTUP_BIT(STAGE_COUNT) - 1)
+
+static Startup_t xStartup;
+static EventGroupHandle_t xStartupEvents; // STARTUP_BIT of each finished stage
+
+void vStageNvs(void)
+{
     esp_err_t i32NVSReturn = nvs_flash_init();
     if (i32NVSReturn == ESP_ERR_NVS_NO_FREE_PAGES || i32NVSReturn == ESP_ERR_NVS_NEW_VERSION_FOUND)
     {
@@ -868,80 +1080,203 @@ void setup()
     }
     ESP_ERROR_CHECK(i32NVSReturn);
 
-    xSemaphore = xSemaphoreCreateMutex();
-    xSemaphoreGive(xSemaphore);
-
-    xQueueBoost = xQueueCreate(1, sizeof(uint8_t));
-    if (xQueueBoost == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueBoost");
-    xQueueIAT = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueIAT == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueIAT");
-    xQueueOil = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueOil == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueOil");
-    xQueueCoolant = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueCoolant == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueCoolant");
-    xQueueTimingAdvance = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueTimingAdvance == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueTimingAdvance");
-    xQueueHPFPPressure = xQueueCreate(1, sizeof(uint16_t));
-    if (xQueueHPFPPressure == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueHPFPPressure");
-
-    xQueueBoostMaxValue = xQueueCreate(1, sizeof(uint8_t));
-    if (xQueueBoostMaxValue == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueBoostMaxValue");
-    xQueueIATMaxValue = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueIATMaxValue == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueIATMaxValue");
-    xQueueOilMaxValue = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueOilMaxValue == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueOilMaxValue");
-    xQueueCoolantMaxValue = xQueueCreate(1, sizeof(int8_t));
-    if (xQueueCoolantMaxValue == NULL)
-        DEBUG_PRINTS("\nError allocating xQueueCoolantMaxValue");
-
-    xQueueOverwrite(xQueueBoostMaxValue, &ucBoostMaxValue);
-    xQueueOverwrite(xQueueIATMaxValue, &cIATMaxValue);
-    xQueueOverwrite(xQueueOilMaxValue, &cOilTemperatureMaxValue);
-    xQueueOverwrite(xQueueCoolantMaxValue, &cCoolantTemperatureMaxValue);
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &xNvsHandle) == ESP_OK)
+    {
+        bAdapterCacheLoad(&xAdapterCache);
+        bMaxStoreLoad(&xMaxStore, millis());
+        vRestoreMaxValues();
+        esp_register_shutdown_handler(vMaxStoreShutdown);
+    }
+    else
+        DEBUG_PRINTS("\nError opening NVS");
+}
 
+void vStageBluetooth(void)
+{
     bInitBluetooth();
+}
+
+void vStageConnect(void)
+{
+    vConnectAdapter();
+    tft.Print_String("\n\tConnected to OBDII", LEFT, tft.Get_Text_Y_Cousur());
+}
+
+void vStageElmStart(void)
+{
+    // vOnBluetoothData wakes this worker until the scheduler task takes the link
+    xLinkOwnerTask = xTaskGetCurrentTaskHandle();
+
+    xAcquisition.xRecovery.ucProtocol = xAdapterCache.xRecord.ucProtocol;
+    if (xAdapterCache.xRecord.bHasProfile)
+        xElmLink.xProfile = xAdapterCache.xRecord.xProfile;
+
+    // Paced by the adapter's prompts, no fixed delays. A dead or wrong
+    // adapter is tried again less and less often, connected again first if
+    // the link dropped meanwhile
+    int8_t i8Stage = BOOT_STAGE_NONE;
+    bool bStarted = false;
+
+    for (uint32_t ulBackoffMs = ADAPTER_RETRY_BACKOFF_MS;;)
+    {
+        for (register uint8_t i = 0; (i < ELM_START_ATTEMPTS) && !bStarted; i++)
+            bStarted = bElmLinkStart(&xElmLink, xAdapterCache.xRecord.ucProtocol);
+
+        vBootProfileEnd(&xBootProfile, i8Stage);
+
+        if (bStarted)
+            break;
+
+        if (ulBackoffMs == ADAPTER_RETRY_BACKOFF_MS)
+            tft.Print_String("\n\tOBDII not answering", LEFT, tft.Get_Text_Y_Cousur());
+        DEBUG_PRINTSS("ELM327 not answering, trying again in %u ms\n", (unsigned)ulBackoffMs);
+
+        ulBackoffMs = ulAdapterBackoff(ulBackoffMs);
+
+        if (!SerialBT.connected())
+            vConnectAdapter();
+
+        i8Stage = i8BootProfileBegin(&xBootProfile, "elm retry");
+    }
+
+    // Before the calibration, which leaves the PIDs set aside out
+    if (!bAcquisitionReadSupport(&xAcquisition))
+        DEBUG_PRINTS("No supported PIDs list\n");
+}
+
+// Only with a new adapter or car, the cached profile is applied by AT Z's
+// configuration otherwise
+void vStageCalibrate(void)
+{
+    if (!xAdapterCache.xRecord.bHasProfile)
+        vCalibrateLink();
+}
+
+void vStageAcquisition(void)
+{
+    if (xTaskCreatePinnedToCore(vObdScheduler, "OBD Scheduler", 1024 * 4, NULL, 4, &xSchedulerTask, CORE_0) != pdPASS)
+        DEBUG_PRINTS("\nError allocating OBD Scheduler Task");
+}
+
+void vStageDisplay(void)
+{
     vSetupDisplay();
-    vUnpairDevices();
-    vSetupELM();
+    vGaugesInit(&xTftSurface, &xClock);
+}
+
+void vStageTouch(void)
+{
     vSetupTouchPad();
-    vHomeScreen();
 
-    if (xTaskCreatePinnedToCore(vGetBoost, "Get Boost", 1024 * 3, NULL, 4, NULL, CORE_0) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Get Boost Task");
-    if (xTaskCreatePinnedToCore(vGetIAT, "Get IAT", 1024 * 3, NULL, 2, NULL, CORE_0) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Get IAT Task");
-    if (xTaskCreatePinnedToCore(vGetOilAndCoolantTemp, "Get Oil and Coolant Temp", 1024 * 3, NULL, 2, NULL, CORE_0) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Get Oil and Coolant Temperatures Task");
-    if (xTaskCreatePinnedToCore(vGetTimingAdvance, "Get Timing (Relative to 1st Cyl)", 1024 * 3, NULL, 3, NULL, CORE_0) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Get Timing Advance Task");
-    if (xTaskCreatePinnedToCore(vGetHPFPPressure, "Get HPFP Pressure", 1024 * 3, NULL, 3, NULL, CORE_0) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Get High Pressure Fuel Pump Pressure Task");
-
-    if (xTaskCreatePinnedToCore(vPrintBoost, "Print Boost", 1024 * 3, NULL, 4, NULL, CORE_1) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Print Boost Task");
-    if (xTaskCreatePinnedToCore(vPrintIAT, "Print IAT", 1024 * 3, NULL, 3, NULL, CORE_1) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Print IAT Task");
-    if (xTaskCreatePinnedToCore(vPrintOilAndCoolantTemp, "Print Oil and Coolant Temp", 1024 * 3, NULL, 3, NULL, CORE_1) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Print Oil and Coolant Temperatures Task");
-    if (xTaskCreatePinnedToCore(vPrintTimingAdvance, "Print Timing (Relative to 1st Cyl)", 1024 * 3, NULL, 3, NULL, CORE_1) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Print Print Timing Advance Task");
-    if (xTaskCreatePinnedToCore(vPrintHPFPPressure, "Print HPFP Pressure", 1024 * 3, NULL, 3, NULL, CORE_1) != pdPASS)
-        DEBUG_PRINTS("\nError allocating Print Print High Pressure Fuel Pump Pressure Task");
-
-    if (xTaskCreatePinnedToCore(vTouchPadRead, "Touch Pad Read", 1024 * 3, NULL, 3, NULL, CORE_1) != pdPASS)
+    if (xTaskCreatePinnedToCore(vTouchPadRead, "Touch Pad Read", 1024 * 3, NULL, 3, &xTouchTask, CORE_1) != pdPASS)
         DEBUG_PRINTS("\nError allocating Touch Pad Read Task");
 }
 
+// Drawn while the ELM327 is still being reset on the other core
+void vStageHomeScreen(void)
+{
+    vHomeScreen();
+
+    if (xTaskCreatePinnedToCore(vRender, "Render", 1024 * 3, NULL, 4, &xRenderTask, CORE_1) != pdPASS)
+        DEBUG_PRINTS("\nError allocating Render Task");
+}
+
+void vStageLogger(void)
+{
+#ifdef DATA_LOGGER
+    if (bSetupLogger() && (xTaskCreatePinnedToCore(vLogWriter, "Log Writer", 1024 * 3, NULL, 1, &xLogWriterTask, CORE_1) != pdPASS))
+        DEBUG_PRINTS("\nError allocating Log Writer Task");
+#endif
+}
+
+// In table order a worker takes the first stage that is ready, so the order
+// is the priority among ready stages. The Bluetooth chain on core 0 is the
+// long one; core 1 brings up the display and touch pad and mounts the
+// filesystem meanwhile
+static const StartupStage_t xStartupStages[STAGE_COUNT] = {
+    {"nvs", vStageNvs, 0, CORE_0},
+    {"bluetooth", vStageBluetooth, STARTUP_BIT(STAGE_NVS), CORE_0},
+    {"unpair", vUnpairDevices, STARTUP_BIT(STAGE_BLUETOOTH) | STARTUP_BIT(STAGE_DISPLAY), CORE_0},
+    {"connect", vStageConnect, STARTUP_BIT(STAGE_UNPAIR), CORE_0},
+    {"elm start", vStageElmStart, STARTUP_BIT(STAGE_CONNECT), CORE_0},
+    {"calibrate", vStageCalibrate, STARTUP_BIT(STAGE_ELM_START), CORE_0},
+    {"acquisition", vStageAcquisition, STARTUP_BIT(STAGE_CALIBRATE) | STARTUP_BIT(STAGE_LOGGER), CORE_0},
+    {"display", vStageDisplay, 0, CORE_1},
+    {"touch", vStageTouch, 0, CORE_1},
+    {"home screen", vStageHomeScreen, STARTUP_BIT(STAGE_DISPLAY) | STARTUP_BIT(STAGE_CONNECT), CORE_1},
+    {"logger", vStageLogger, 0, CORE_1},
+};
+
+// Runs every stage of its core, sleeping until some other stage ends
+// whenever none is ready. The pending bits come from the event group, not
+// from xStartup, so a stage that ended between the two reads still wakes it
+void vStartupWorker(uint8_t ucCore)
+{
+    while (!bStartupFinished(&xStartup, ucCore))
+    {
+        int8_t i8Stage = i8StartupClaim(&xStartup, ucCore);
+
+        if (i8Stage < 0)
+        {
+            EventBits_t xPending = STARTUP_ALL_BITS & ~xEventGroupGetBits(xStartupEvents);
+
+            xEventGroupWaitBits(xStartupEvents, xPending, pdFALSE, pdFALSE, portMAX_DELAY);
+            continue;
+        }
+
+        vStartupRun(&xStartup, i8Stage);
+        xEventGroupSetBits(xStartupEvents, STARTUP_BIT(i8Stage));
+    }
+}
+
+void vStartupWorkerTask(void *pvParameters)
+{
+    vStartupWorker(CORE_0);
+    vTaskDelete(NULL);
+}
+
+void setup()
+{
+    vBootProfileInit(&xBootProfile, &xClock);
+
+    Serial.begin(CONSOLE_BAUD);
+
+    vTelemetryInit(&xTelemetry, xVehicleChannelStats);
+    vMetricsInit(&xMetrics, millis());
+    vMaxStoreInit(&xMaxStore, &xNvs, KEPT_MAX_BITS);
+    vAdapterCacheInit(&xAdapterCache, &xNvs);
+
+    vBroadcastInit(&xBroadcastMonitor, xVehicleBroadcastSignals, ucVehicleBroadcastSignalCount);
+    vElmLinkInit(&xElmLink, &xBluetoothTransport, &xClock);
+#ifdef OBD_MULTI_PID
+    vAcquisitionInit(&xAcquisition, xVehicleJobs, ucVehicleJobCount, OBD_MULTI_PID_MAX, &xElmLink, &xBroadcastMonitor, vPublishChannel, vError, &xClock);
+#else
+    vAcquisitionInit(&xAcquisition, xVehicleJobs, ucVehicleJobCount, 1, &xElmLink, &xBroadcastMonitor, vPublishChannel, vError, &xClock);
+#endif
+    vInputInit(&xTouchButton, &xTouchPad);
+
+    if (!bLockCreate(&xLinkLock))
+        DEBUG_PRINTS("\nError allocating xLinkLock");
+    if (!bLockCreate(&xDisplayLock))
+        DEBUG_PRINTS("\nError allocating xDisplayLock");
+
+    xRenderEvents = xEventGroupCreate();
+    if (xRenderEvents == NULL)
+        DEBUG_PRINTS("\nError allocating xRenderEvents");
+
+    xStartupEvents = xEventGroupCreate();
+    if (xStartupEvents == NULL)
+        DEBUG_PRINTS("\nError allocating xStartupEvents");
+
+    vStartupInit(&xStartup, xStartupStages, STAGE_COUNT, &xBootProfile);
+
+    if (xTaskCreatePinnedToCore(vStartupWorkerTask, "Startup", 1024 * 4, NULL, STARTUP_WORKER_PRIORITY, NULL, CORE_0) != pdPASS)
+        DEBUG_PRINTS("\nError allocating Startup Task");
+
+    vStartupWorker(CORE_1); // setup() runs on core 1
+}
+
 void loop()
 {
     vTaskDelay(100 / portTICK_PERIOD_MS);
-}
\ No newline at end of file
+}
@@ -0,0 +1,169 @@
+#include "max_store.h"
+
+#include <math.h>
+#include <string.h>
+#include "telemetry.h"
+
+static void vEmptyRecord(MaxRecord_t *pxRecord)
+{
+    memset(pxRecord, 0, sizeof(MaxRecord_t));
+    pxRecord->ucVersion = MAX_STORE_VERSION;
+    pxRecord->ucChannelCount = CHANNEL_COUNT;
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        pxRecord->xMax[i].fMax = TELEMETRY_NO_MAX;
+}
+
+void vMaxStoreInit(MaxStore_t *pxStore, const HalKeyValue_t *pxKeyValue, uint32_t ulChannelMask)
+{
+    memset(pxStore, 0, sizeof(MaxStore_t));
+    pxStore->pxStore = pxKeyValue;
+    pxStore->ulChannelMask = ulChannelMask;
+
+    vEmptyRecord(&pxStore->xRecord);
+    vEmptyRecord(&pxStore->xCommitted);
+}
+
+// Reads the values kept from earlier drives and counts this one as a new
+// session. A missing or foreign record starts from scratch
+bool bMaxStoreLoad(MaxStore_t *pxStore, uint32_t ulNowMs)
+{
+    const HalKeyValue_t *pxKeyValue = pxStore->pxStore;
+    MaxRecord_t xRecord;
+    bool bLoaded = pxKeyValue->bLoad(pxKeyValue->pvContext, MAX_STORE_KEY, &xRecord, sizeof(xRecord)) &&
+                   (xRecord.ucVersion == MAX_STORE_VERSION) && (xRecord.ucChannelCount == CHANNEL_COUNT);
+
+    if (bLoaded)
+        pxStore->xRecord = xRecord;
+
+    pxStore->xRecord.ulSessions++;
+
+    // The session count itself is worth one write per boot
+    bMaxStoreCommit(pxStore, ulNowMs);
+
+    return bLoaded;
+}
+
+static bool bSignificant(float fOld, float fNew)
+{
+    if (fOld == TELEMETRY_NO_MAX)
+        return true;
+
+    float fThreshold = fabsf(fOld) * MAX_STORE_SIGNIFICANT_PERMILLE / 1000.0f;
+
+    if (fThreshold < MAX_STORE_SIGNIFICANT_MIN)
+        fThreshold = MAX_STORE_SIGNIFICANT_MIN;
+
+    return fabsf(fNew - fOld) >= fThreshold;
+}
+
+static void vMarkDirty(MaxStore_t *pxStore, uint32_t ulNowMs)
+{
+    if (!pxStore->bDirty)
+        pxStore->ulDirtySinceMs = ulNowMs;
+
+    pxStore->bDirty = true;
+}
+
+// With every published value and the channel's max from the telemetry
+// store. Only RAM is touched here
+void vMaxStoreUpdate(MaxStore_t *pxStore, uint8_t ucChannel, float fMax, uint32_t ulNowMs)
+{
+    pxStore->ulLastValueMs = ulNowMs;
+
+    if ((ucChannel >= CHANNEL_COUNT) || !(pxStore->ulChannelMask & (1UL << ucChannel)))
+        return;
+
+    StoredMax_t *pxMax = &pxStore->xRecord.xMax[ucChannel];
+
+    if (fMax <= pxMax->fMax)
+        return;
+
+    pxMax->fMax = fMax;
+    pxMax->ulSession = pxStore->xRecord.ulSessions;
+    pxMax->ulUptimeMs = ulNowMs;
+    pxStore->ulUpdates++;
+
+    if (bSignificant(pxStore->xCommitted.xMax[ucChannel].fMax, fMax))
+        pxStore->bSignificant = true;
+
+    vMarkDirty(pxStore, ulNowMs);
+}
+
+// A reset by the driver is rare and deliberate, so it goes to flash at the
+// next interval like a significant change
+void vMaxStoreClear(MaxStore_t *pxStore, uint32_t ulChannelMask, uint32_t ulNowMs)
+{
+    ulChannelMask &= pxStore->ulChannelMask;
+    if (ulChannelMask == 0)
+        return;
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (ulChannelMask & (1UL << i))
+        {
+            pxStore->xRecord.xMax[i].fMax = TELEMETRY_NO_MAX;
+            pxStore->xRecord.xMax[i].ulSession = pxStore->xRecord.ulSessions;
+            pxStore->xRecord.xMax[i].ulUptimeMs = ulNowMs;
+        }
+    }
+
+    pxStore->bSignificant = true;
+    vMarkDirty(pxStore, ulNowMs);
+}
+
+// Called often from the owner's loop; commits when the policy allows.
+// Returns true if it wrote
+bool bMaxStoreService(MaxStore_t *pxStore, uint32_t ulNowMs)
+{
+    if (!pxStore->bDirty)
+        return false;
+
+    // The ignition went off; the adapter usually stays powered, so this is
+    // the drive's last chance rather than a power loss
+    if ((ulNowMs - pxStore->ulLastValueMs >= MAX_STORE_QUIET_MS) && (ulNowMs - pxStore->ulLastCommitMs >= MAX_STORE_QUIET_MS))
+        return bMaxStoreCommit(pxStore, ulNowMs);
+
+    if (ulNowMs - pxStore->ulLastCommitMs < MAX_STORE_MIN_INTERVAL_MS)
+        return false;
+
+    if (!pxStore->bSignificant && (ulNowMs - pxStore->ulDirtySinceMs < MAX_STORE_PERIOD_MS))
+        return false;
+
+    return bMaxStoreCommit(pxStore, ulNowMs);
+}
+
+// Writes now, whatever the policy says: on boot and from shutdown hooks
+bool bMaxStoreCommit(MaxStore_t *pxStore, uint32_t ulNowMs)
+{
+    const HalKeyValue_t *pxKeyValue = pxStore->pxStore;
+
+    pxStore->xRecord.ulWrites++;
+
+    if (!pxKeyValue->bStore(pxKeyValue->pvContext, MAX_STORE_KEY, &pxStore->xRecord, sizeof(MaxRecord_t)))
+    {
+        pxStore->xRecord.ulWrites--;
+        pxStore->ulFailures++;
+        pxStore->ulLastCommitMs = ulNowMs; // Retry at the next interval, not in a loop
+        return false;
+    }
+
+    pxStore->xCommitted = pxStore->xRecord;
+    pxStore->bDirty = false;
+    pxStore->bSignificant = false;
+    pxStore->ulLastCommitMs = ulNowMs;
+    pxStore->ulCommits++;
+
+    return true;
+}
+
+bool bMaxStoreGet(const MaxStore_t *pxStore, uint8_t ucChannel, float *pfMax)
+{
+    if ((ucChannel >= CHANNEL_COUNT) || !(pxStore->ulChannelMask & (1UL << ucChannel)) ||
+        (pxStore->xRecord.xMax[ucChannel].fMax == TELEMETRY_NO_MAX))
+        return false;
+
+    *pfMax = pxStore->xRecord.xMax[ucChannel].fMax;
+
+    return true;
+}
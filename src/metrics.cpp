@@ -0,0 +1,117 @@
+#include "metrics.h"
+
+#include <string.h>
+
+void vMetricsInit(Metrics_t *pxMetrics, uint32_t ulNowMs)
+{
+    vMetricsClear(pxMetrics, ulNowMs);
+}
+
+void vMetricsClear(Metrics_t *pxMetrics, uint32_t ulNowMs)
+{
+    memset(pxMetrics, 0, sizeof(Metrics_t));
+    pxMetrics->ulWindowStartMs = ulNowMs;
+}
+
+void vMetricsResetWindow(Metrics_t *pxMetrics, uint32_t ulNowMs)
+{
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        pxMetrics->xChannels[i].ulPublished = 0;
+        pxMetrics->xChannels[i].ulDrawn = 0;
+    }
+
+    pxMetrics->ulWindowStartMs = ulNowMs;
+}
+
+static void vRecord(MetricsChannel_t *pxChannel, MetricsStage_t xStage, uint32_t ulMicros)
+{
+    uint8_t ucBucket = 0;
+    uint32_t ulLimit = METRICS_HISTOGRAM_FIRST_US;
+
+    while ((ucBucket < METRICS_HISTOGRAM_BUCKETS - 1) && (ulMicros >= ulLimit))
+    {
+        ucBucket++;
+        ulLimit *= 2;
+    }
+
+    pxChannel->ulHistogram[xStage][ucBucket]++;
+
+    if (ulMicros > pxChannel->ulWorstUs[xStage])
+        pxChannel->ulWorstUs[xStage] = ulMicros;
+}
+
+// ulParsedUs is 0 for broadcast signals, which are published as soon as their
+// frame is decoded. Only a sample that changed the screen waits for its pixels
+void vMetricsPublished(Metrics_t *pxMetrics, uint8_t ucChannel, uint32_t ulSentUs, uint32_t ulParsedUs, uint32_t ulPublishedUs, bool bChanged)
+{
+    MetricsChannel_t *pxChannel = &pxMetrics->xChannels[ucChannel];
+
+    if (ulParsedUs == 0)
+        ulParsedUs = ulPublishedUs;
+
+    vRecord(pxChannel, METRICS_STAGE_RESPONSE, ulParsedUs - ulSentUs);
+    vRecord(pxChannel, METRICS_STAGE_PUBLISH, ulPublishedUs - ulParsedUs);
+    pxChannel->ulPublished++;
+
+    if (bChanged)
+    {
+        pxChannel->bPending = false;
+        pxChannel->ulSentUs = ulSentUs;
+        pxChannel->ulPublishedUs = ulPublishedUs;
+        pxChannel->bPending = true;
+    }
+}
+
+// After the render of every channel in ulChannelMask. A channel redrawn for
+// a reset has no sample waiting and is only counted
+void vMetricsDrawn(Metrics_t *pxMetrics, uint32_t ulChannelMask, uint32_t ulPushedUs)
+{
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        MetricsChannel_t *pxChannel = &pxMetrics->xChannels[i];
+
+        if ((ulChannelMask & ((uint32_t)1 << i)) == 0)
+            continue;
+
+        pxChannel->ulDrawn++;
+
+        if (!pxChannel->bPending)
+            continue;
+
+        pxChannel->bPending = false;
+        vRecord(pxChannel, METRICS_STAGE_RENDER, ulPushedUs - pxChannel->ulPublishedUs);
+        vRecord(pxChannel, METRICS_STAGE_GLASS, ulPushedUs - pxChannel->ulSentUs);
+    }
+}
+
+void vMetricsError(Metrics_t *pxMetrics, int8_t i8Status)
+{
+    if ((i8Status >= 0) && (i8Status < METRICS_STATUS_COUNT))
+        pxMetrics->ulErrors[i8Status]++;
+}
+
+// Upper bound of the bucket holding the given share of the samples, never
+// above the worst case. 0 without samples
+uint32_t ulMetricsPercentileUs(const MetricsChannel_t *pxChannel, MetricsStage_t xStage, uint16_t ui16Permille)
+{
+    uint32_t ulTotal = 0;
+    uint32_t ulCount = 0;
+    uint32_t ulLimit = METRICS_HISTOGRAM_FIRST_US;
+
+    for (register uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+        ulTotal += pxChannel->ulHistogram[xStage][i];
+
+    if (ulTotal == 0)
+        return 0;
+
+    for (register uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        ulCount += pxChannel->ulHistogram[xStage][i];
+        if ((uint64_t)ulCount * 1000 >= (uint64_t)ulTotal * ui16Permille)
+            return (ulLimit < pxChannel->ulWorstUs[xStage]) ? ulLimit : pxChannel->ulWorstUs[xStage];
+        ulLimit *= 2;
+    }
+
+    return pxChannel->ulWorstUs[xStage];
+}
@@ -0,0 +1,726 @@
+#include "elm_emulator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "obd.h"
+#include "can_decoder.h"
+#include "channels.h"
+#include "vehicle.h"
+
+#define REPLAY_TEXT_MAX (256 * 1024)
+#define REPLAY_EXCHANGES_MAX 4096
+
+void vElmEmulatorDefaults(ElmEmulatorConfig_t *pxConfig)
+{
+    pxConfig->ulLatencyMs = 35;
+    pxConfig->ulAtLatencyMs = 10;
+    pxConfig->ulJitterMs = 0;
+    pxConfig->ui16NoDataPermille = 0;
+    pxConfig->ui16StoppedPermille = 0;
+    pxConfig->ui16SilentPermille = 0;
+    pxConfig->ulBroadcastPeriodMs = 20;
+    pxConfig->ulSearchMs = 0;
+    pxConfig->ucProtocol = 6;
+    pxConfig->ucUnsupportedPid = 0;
+    pxConfig->ulBaud = 38400;
+    pxConfig->ulSeed = 1;
+    pxConfig->pcReplayPath = NULL;
+}
+
+const char *pcElmEmulatorUsage(void)
+{
+    return "  --latency MS      OBD request to response (35)\n"
+           "  --latency-at MS   AT command to response (10)\n"
+           "  --jitter MS       uniform extra latency (0)\n"
+           "  --no-data N       answer N per mille of OBD requests with NO DATA\n"
+           "  --stopped N       answer N per mille of OBD requests with STOPPED\n"
+           "  --silent N        never answer N per mille of OBD requests\n"
+           "  --broadcast MS    frame spacing while monitoring (20)\n"
+           "  --search MS       protocol search before the first OBD answer (0)\n"
+           "  --protocol N      the car's protocol number, 1 to 12 (6)\n"
+           "  --unsupported PID a Mode 01 PID the car does not answer, e.g. 0x0E\n"
+           "  --baud N          ELM327 UART rate, 0 for no time on the wire (38400)\n"
+           "  --seed N          random seed for jitter and injection (1)\n"
+           "  --replay FILE     answer from a recorded session ('> ' and '< ' lines)\n";
+}
+
+// Returns the index of the next unused argument, or i if argv[i] is not an
+// emulator option
+int iElmEmulatorParseOption(ElmEmulatorConfig_t *pxConfig, int argc, char **argv, int i)
+{
+    if (i + 1 >= argc)
+        return i;
+
+    const char *pcOption = argv[i];
+    const char *pcValue = argv[i + 1];
+    uint32_t ulValue = strtoul(pcValue, NULL, 0);
+
+    if (strcmp(pcOption, "--latency") == 0)
+        pxConfig->ulLatencyMs = ulValue;
+    else if (strcmp(pcOption, "--latency-at") == 0)
+        pxConfig->ulAtLatencyMs = ulValue;
+    else if (strcmp(pcOption, "--jitter") == 0)
+        pxConfig->ulJitterMs = ulValue;
+    else if (strcmp(pcOption, "--no-data") == 0)
+        pxConfig->ui16NoDataPermille = ulValue;
+    else if (strcmp(pcOption, "--stopped") == 0)
+        pxConfig->ui16StoppedPermille = ulValue;
+    else if (strcmp(pcOption, "--silent") == 0)
+        pxConfig->ui16SilentPermille = ulValue;
+    else if (strcmp(pcOption, "--broadcast") == 0)
+        pxConfig->ulBroadcastPeriodMs = ulValue;
+    else if (strcmp(pcOption, "--search") == 0)
+        pxConfig->ulSearchMs = ulValue;
+    else if (strcmp(pcOption, "--protocol") == 0)
+        pxConfig->ucProtocol = ulValue;
+    else if (strcmp(pcOption, "--unsupported") == 0)
+        pxConfig->ucUnsupportedPid = ulValue;
+    else if (strcmp(pcOption, "--baud") == 0)
+        pxConfig->ulBaud = ulValue;
+    else if (strcmp(pcOption, "--seed") == 0)
+        pxConfig->ulSeed = ulValue;
+    else if (strcmp(pcOption, "--replay") == 0)
+        pxConfig->pcReplayPath = pcValue;
+    else
+        return i;
+
+    return i + 2;
+}
+
+// Spaces and case do not matter to the ELM327
+static void vCompact(const char *pcCommand, char *pcCompact, size_t xMax)
+{
+    size_t xLength = 0;
+
+    for (const char *pc = pcCommand; (*pc != '\0') && (xLength < xMax - 1); pc++)
+        if ((*pc != ' ') && (*pc != '\r') && (*pc != '\n'))
+            pcCompact[xLength++] = ((*pc >= 'a') && (*pc <= 'z')) ? *pc - 'a' + 'A' : *pc;
+    pcCompact[xLength] = '\0';
+}
+
+// Lines starting with "> " are commands, the "< " lines after one are its
+// answer. Anything else is skipped, so a console log with ELM_LINK_TRACE
+// enabled can be replayed as is
+static bool bLoadReplay(ElmReplay_t *pxReplay, const char *pcPath)
+{
+    FILE *pxFile = fopen(pcPath, "r");
+    char cLine[256];
+    uint32_t ulTextLength = 0;
+
+    if (pxFile == NULL)
+        return false;
+
+    pxReplay->pcText = (char *)malloc(REPLAY_TEXT_MAX);
+    pxReplay->pxExchanges = (ElmReplayExchange_t *)malloc(REPLAY_EXCHANGES_MAX * sizeof(ElmReplayExchange_t));
+    pxReplay->ulExchangeCount = 0;
+    pxReplay->ulCursor = 0;
+
+    if ((pxReplay->pcText == NULL) || (pxReplay->pxExchanges == NULL))
+    {
+        fclose(pxFile);
+        return false;
+    }
+
+    ElmReplayExchange_t *pxCurrent = NULL;
+
+    while (fgets(cLine, sizeof(cLine), pxFile) != NULL)
+    {
+        size_t xLength = strcspn(cLine, "\r\n");
+        cLine[xLength] = '\0';
+
+        if ((cLine[0] == '>') && (cLine[1] == ' ') && (pxReplay->ulExchangeCount < REPLAY_EXCHANGES_MAX))
+        {
+            pxCurrent = &pxReplay->pxExchanges[pxReplay->ulExchangeCount++];
+            vCompact(&cLine[2], pxCurrent->cCommand, sizeof(pxCurrent->cCommand));
+            pxCurrent->ulOffset = ulTextLength;
+            pxCurrent->ulLength = 0;
+        }
+        else if ((cLine[0] == '<') && (cLine[1] == ' ') && (pxCurrent != NULL) && (ulTextLength + xLength < REPLAY_TEXT_MAX))
+        {
+            memcpy(&pxReplay->pcText[ulTextLength], &cLine[2], xLength - 2);
+            ulTextLength += xLength - 2;
+            pxReplay->pcText[ulTextLength++] = '\r';
+            pxCurrent->ulLength += xLength - 1;
+        }
+    }
+
+    fclose(pxFile);
+    return true;
+}
+
+// Next recorded answer to pcCompact, in recorded order and wrapping around
+static int32_t i32FindExchange(ElmReplay_t *pxReplay, const char *pcCompact)
+{
+    for (uint32_t i = 0; i < pxReplay->ulExchangeCount; i++)
+    {
+        uint32_t ulIndex = (pxReplay->ulCursor + i) % pxReplay->ulExchangeCount;
+
+        if (strcmp(pxReplay->pxExchanges[ulIndex].cCommand, pcCompact) == 0)
+        {
+            pxReplay->ulCursor = ulIndex + 1;
+            return ulIndex;
+        }
+    }
+
+    return -1;
+}
+
+// What AT Z puts back
+static void vDefaultSettings(ElmEmulator_t *pxEmulator)
+{
+    pxEmulator->bEcho = true;
+    pxEmulator->bHeaders = false;
+    pxEmulator->bSpaces = true;
+    pxEmulator->bLinefeeds = true;
+    pxEmulator->ucAdaptiveTiming = 1;
+    pxEmulator->ucTimeout = 0x32;
+}
+
+bool bElmEmulatorInit(ElmEmulator_t *pxEmulator, const ElmEmulatorConfig_t *pxConfig)
+{
+    memset(pxEmulator, 0, sizeof(*pxEmulator));
+    pxEmulator->xConfig = *pxConfig;
+    vDefaultSettings(pxEmulator);
+    pxEmulator->bAutoProtocol = true;
+    pxEmulator->i32MonitorExchange = -1;
+    pxEmulator->ulRandom = pxConfig->ulSeed != 0 ? pxConfig->ulSeed : 1;
+
+    if (pxConfig->pcReplayPath != NULL)
+        return bLoadReplay(&pxEmulator->xReplay, pxConfig->pcReplayPath);
+
+    return true;
+}
+
+static uint32_t ulRandom(ElmEmulator_t *pxEmulator)
+{
+    uint32_t x = pxEmulator->ulRandom;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return pxEmulator->ulRandom = x;
+}
+
+static bool bChance(ElmEmulator_t *pxEmulator, uint16_t ui16Permille)
+{
+    return (ui16Permille > 0) && ((ulRandom(pxEmulator) % 1000) < ui16Permille);
+}
+
+// With AT L1 every CR is followed by a LF
+static void vOutput(ElmEmulator_t *pxEmulator, const char *pcText, size_t xLength)
+{
+    for (size_t i = 0; i < xLength; i++)
+    {
+        bool bLinefeed = pxEmulator->bLinefeeds && (pcText[i] == '\r');
+
+        if (pxEmulator->xOutputLength + (bLinefeed ? 2 : 1) > sizeof(pxEmulator->cOutput))
+            return;
+
+        pxEmulator->cOutput[pxEmulator->xOutputLength++] = pcText[i];
+        if (bLinefeed)
+            pxEmulator->cOutput[pxEmulator->xOutputLength++] = '\n';
+    }
+}
+
+static void vReply(ElmEmulator_t *pxEmulator, const char *pcText)
+{
+    vOutput(pxEmulator, pcText, strlen(pcText));
+}
+
+static uint32_t ulJitterMs(ElmEmulator_t *pxEmulator)
+{
+    uint32_t ulJitter = pxEmulator->xConfig.ulJitterMs;
+
+    return (ulJitter > 0) ? ulRandom(pxEmulator) % (ulJitter + 1) : 0;
+}
+
+// Everything queued since the last read shows up together, ulLatencyMs after
+// the command that produced it
+static void vDelayOutput(ElmEmulator_t *pxEmulator, uint32_t ulLatencyMs, uint32_t ulNow)
+{
+    uint32_t ulDue = ulNow + ulLatencyMs;
+
+    if ((pxEmulator->xOutputLength == 0) || ((int32_t)(ulDue - pxEmulator->ulOutputDue) > 0))
+        pxEmulator->ulOutputDue = ulDue;
+}
+
+// A slowly cycling engine, so every field keeps changing
+static float fEngineValue(uint8_t ucChannel, uint32_t ulNow)
+{
+    float fPhase = (float)ulNow / 1000.0f;
+
+    switch (ucChannel)
+    {
+    case CHANNEL_BOOST:
+        return 100.0f + 130.0f * (0.5f + 0.5f * sinf(fPhase));
+    case CHANNEL_TIMING:
+        return 10.0f * sinf(fPhase * 0.7f);
+    case CHANNEL_HPFP:
+        return 5000.0f + 10000.0f * (0.5f + 0.5f * sinf(fPhase * 0.3f));
+    case CHANNEL_IAT:
+        return 30.0f + 10.0f * sinf(fPhase * 0.05f);
+    case CHANNEL_COOLANT:
+        return 90.0f;
+    case CHANNEL_OIL:
+        return 95.0f + 5.0f * sinf(fPhase * 0.02f);
+    }
+
+    return 0;
+}
+
+static void vEncodeSignal(const SignalDef_t *pxSignal, float fValue, uint8_t *pucData)
+{
+    int32_t i32Raw = lroundf((fValue - pxSignal->fOffset) / pxSignal->fScale);
+
+    for (register uint8_t i = 0; i < pxSignal->ucLength; i++)
+        pucData[pxSignal->ucByteOffset + i] = i32Raw >> (8 * (pxSignal->ucLength - 1 - i));
+}
+
+static void vReplyBytes(ElmEmulator_t *pxEmulator, const uint8_t *pucData, uint8_t ucLength)
+{
+    char cByte[4];
+
+    for (register uint8_t i = 0; i < ucLength; i++)
+    {
+        snprintf(cByte, sizeof(cByte), ((i == 0) || !pxEmulator->bSpaces) ? "%02X" : " %02X", pucData[i]);
+        vReply(pxEmulator, cByte);
+    }
+}
+
+// 01 00, 01 20, ...: the catalogue's PIDs in the 32 after ucBase, less the
+// unsupported one, and the next range's bit while the catalogue goes on
+static void vEncodeSupport(const ElmEmulator_t *pxEmulator, uint8_t ucBase, uint8_t *pucData)
+{
+    memset(pucData, 0, 4);
+
+    for (register uint8_t i = 0; i < ucObdPidCount(); i++)
+    {
+        uint8_t ucPid = pxObdPidAt(i)->ucPid;
+        uint8_t ucBit = ucPid - ucBase - 1;
+
+        if ((ucPid > ucBase) && (ucPid - ucBase <= 0x20) && (ucPid != pxEmulator->xConfig.ucUnsupportedPid))
+            pucData[ucBit / 8] |= 0x80 >> (ucBit % 8);
+        else if (ucPid > ucBase + 0x20)
+            pucData[3] |= 0x01;
+    }
+}
+
+// Mode 01 answer in the CAN auto formatted, headers off layout: one line for
+// up to 7 bytes, otherwise a length line and "N:" indexed lines. A response
+// count below the frame count cuts the answer short, as on the ELM327.
+// Returns the frames sent
+static uint8_t ucReplyMode01(ElmEmulator_t *pxEmulator, const char *pcCompact, uint8_t ucExpected, uint32_t ulNow)
+{
+    uint8_t ucPayload[OBD_MULTI_PID_MAX * 5 + 1];
+    uint8_t ucLength = 0;
+    size_t xCommandLength = strlen(pcCompact);
+
+    ucPayload[ucLength++] = 0x41;
+
+    for (size_t i = 2; (i + 1 < xCommandLength) && (ucLength < sizeof(ucPayload) - 5); i += 2)
+    {
+        uint8_t ucPid = (cHexLut[(uint8_t)pcCompact[i]] << 4) | cHexLut[(uint8_t)pcCompact[i + 1]];
+        const ObdPidDef_t *pxDef = pxObdFindPid(ucPid);
+
+        if ((ucPid % 0x20) == 0)
+        {
+            ucPayload[ucLength++] = ucPid;
+            vEncodeSupport(pxEmulator, ucPid, &ucPayload[ucLength]);
+            ucLength += 4;
+            continue;
+        }
+
+        if ((pxDef == NULL) || (ucPid == pxEmulator->xConfig.ucUnsupportedPid))
+            continue;
+
+        ucPayload[ucLength++] = ucPid;
+        // PIDs no gauge shows answer the middle of their range
+        pxDef->pxEncode((pxDef->ucChannel < CHANNEL_COUNT) ? fEngineValue(pxDef->ucChannel, ulNow) : (pxDef->fMin + pxDef->fMax) / 2,
+                        &ucPayload[ucLength]);
+        ucLength += pxDef->ucDataLength;
+    }
+
+    if (ucLength == 1)
+    {
+        vReply(pxEmulator, "NO DATA\r");
+        return 0;
+    }
+
+    if (ucLength <= 7)
+    {
+        vReplyBytes(pxEmulator, ucPayload, ucLength);
+        vReply(pxEmulator, "\r");
+        return 1;
+    }
+
+    char cLine[8];
+    uint8_t ucFrame[7];
+    uint8_t ucSent = 0;
+
+    snprintf(cLine, sizeof(cLine), "%03X\r", ucLength);
+    vReply(pxEmulator, cLine);
+
+    register uint8_t ucIndex;
+
+    for (ucIndex = 0; (ucSent < ucLength) && ((ucExpected == 0) || (ucIndex < ucExpected)); ucIndex++)
+    {
+        uint8_t ucFrameLength = (ucIndex == 0) ? 6 : 7;
+
+        memset(ucFrame, 0, sizeof(ucFrame));
+        for (register uint8_t i = 0; (i < ucFrameLength) && (ucSent < ucLength); i++)
+            ucFrame[i] = ucPayload[ucSent++];
+
+        snprintf(cLine, sizeof(cLine), pxEmulator->bSpaces ? "%X: " : "%X:", ucIndex & 0x0F);
+        vReply(pxEmulator, cLine);
+        vReplyBytes(pxEmulator, ucFrame, ucFrameLength);
+        vReply(pxEmulator, "\r");
+    }
+
+    return ucIndex;
+}
+
+// One monitor frame: the next line of a replayed monitor session, or the
+// first monitored broadcast ID with the simulated engine values
+static void vReplyBroadcast(ElmEmulator_t *pxEmulator, uint32_t ulNow)
+{
+    if (pxEmulator->i32MonitorExchange >= 0)
+    {
+        const ElmReplayExchange_t *pxExchange = &pxEmulator->xReplay.pxExchanges[pxEmulator->i32MonitorExchange];
+        const char *pcLines = &pxEmulator->xReplay.pcText[pxExchange->ulOffset];
+        uint32_t ulOffset = pxEmulator->ulMonitorLine;
+
+        if (ulOffset >= pxExchange->ulLength)
+            ulOffset = 0;
+
+        const char *pcEnd = (const char *)memchr(&pcLines[ulOffset], '\r', pxExchange->ulLength - ulOffset);
+        uint32_t ulLineLength = (pcEnd != NULL) ? (pcEnd - &pcLines[ulOffset]) + 1 : pxExchange->ulLength - ulOffset;
+
+        vOutput(pxEmulator, &pcLines[ulOffset], ulLineLength);
+        pxEmulator->ulMonitorLine = ulOffset + ulLineLength;
+        return;
+    }
+
+    uint16_t ui16Id = xVehicleBroadcastSignals[0].ui16CanId;
+    uint8_t ucData[8] = {0};
+    char cId[8];
+
+    for (register uint8_t i = 0; i < ucVehicleBroadcastSignalCount; i++)
+    {
+        const SignalDef_t *pxSignal = &xVehicleBroadcastSignals[i].xSignal;
+
+        if (xVehicleBroadcastSignals[i].ui16CanId == ui16Id)
+            vEncodeSignal(pxSignal, fEngineValue(pxSignal->ucChannel, ulNow), ucData);
+    }
+
+    if (pxEmulator->bHeaders)
+    {
+        snprintf(cId, sizeof(cId), pxEmulator->bSpaces ? "%03X " : "%03X", ui16Id);
+        vReply(pxEmulator, cId);
+    }
+    vReplyBytes(pxEmulator, ucData, sizeof(ucData));
+    vReply(pxEmulator, "\r");
+}
+
+static bool bIsObdRequest(const char *pcCompact)
+{
+    return (pcCompact[0] == '0') && (pcCompact[1] == '1') && (strlen(pcCompact) >= 4);
+}
+
+static uint8_t ucHexDigit(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+
+    return 0;
+}
+
+// AT SP h fixes the protocol, AT SP Ah (and AT SP 0) leave it automatic with
+// h tried first
+static void vSelectProtocol(ElmEmulator_t *pxEmulator, const char *pcArgument)
+{
+    pxEmulator->bAutoProtocol = (pcArgument[0] == 'A') || (pcArgument[0] == '0');
+    pxEmulator->ucTryProtocol = ucHexDigit((pcArgument[0] == 'A') ? pcArgument[1] : pcArgument[0]);
+    pxEmulator->ucProtocol = pxEmulator->bAutoProtocol ? 0 : pxEmulator->ucTryProtocol;
+}
+
+// Before the first OBD answer: a search unless the protocol to try first is
+// the car's. False when a fixed protocol is not the car's
+static bool bConnectProtocol(ElmEmulator_t *pxEmulator, uint32_t ulNow)
+{
+    uint8_t ucCarProtocol = pxEmulator->xConfig.ucProtocol;
+
+    if (pxEmulator->ucProtocol != 0)
+        return pxEmulator->ucProtocol == ucCarProtocol;
+
+    if (pxEmulator->ucTryProtocol != ucCarProtocol)
+    {
+        vReply(pxEmulator, "SEARCHING...\r");
+        vDelayOutput(pxEmulator, pxEmulator->xConfig.ulLatencyMs + pxEmulator->xConfig.ulSearchMs, ulNow);
+    }
+
+    pxEmulator->ucProtocol = ucCarProtocol;
+
+    return true;
+}
+
+// Frames in a recorded answer: its lines without the multi frame length line
+static uint8_t ucCountFrames(const char *pcLines, uint32_t ulLength)
+{
+    uint8_t ucFrames = 0;
+    uint32_t ulLineLength = 0;
+
+    for (uint32_t i = 0; i < ulLength; i++)
+    {
+        if (pcLines[i] != '\r')
+            ulLineLength++;
+        else
+        {
+            ucFrames += (ulLineLength > 0) && (ulLineLength != 3);
+            ulLineLength = 0;
+        }
+    }
+
+    return ucFrames;
+}
+
+// How long the ELM327 keeps listening after the last frame when no response
+// count told it the answer is complete: the full AT ST with adaptive timing
+// off, otherwise a margin over the answer times it has seen, tighter with
+// AT AT2. A rough model of the datasheet's description
+static uint32_t ulListenMs(const ElmEmulator_t *pxEmulator, uint32_t ulAnswerMs)
+{
+    uint32_t ulTimeoutMs = pxEmulator->ucTimeout * 4;
+    uint32_t ulAdaptiveMs = (pxEmulator->ucAdaptiveTiming == 2) ? (ulAnswerMs / 2 + 8) : (ulAnswerMs + 24);
+
+    if ((pxEmulator->ucAdaptiveTiming == 0) || (ulAdaptiveMs > ulTimeoutMs))
+        return ulTimeoutMs;
+
+    return ulAdaptiveMs;
+}
+
+static void vExecute(ElmEmulator_t *pxEmulator, const char *pcCommand, uint32_t ulNow)
+{
+    char cCompact[ELM_EMULATOR_COMMAND_MAX];
+    const ElmEmulatorConfig_t *pxConfig = &pxEmulator->xConfig;
+    size_t xQueued = pxEmulator->xOutputLength;
+    uint8_t ucExpected = 0;
+    uint8_t ucFrames = 0;
+    bool bObd;
+
+    vCompact(pcCommand, cCompact, sizeof(cCompact));
+    bObd = bIsObdRequest(cCompact);
+    pxEmulator->ulCommands++;
+    pxEmulator->ulObdRequests += bObd;
+
+    // An odd digit after the PIDs is the response count
+    if (bObd && (strlen(cCompact) % 2 == 1))
+    {
+        ucExpected = ucHexDigit(cCompact[strlen(cCompact) - 1]);
+        cCompact[strlen(cCompact) - 1] = '\0';
+        pxEmulator->ulCounted++;
+    }
+
+    if (pxEmulator->bEcho)
+    {
+        vReply(pxEmulator, pcCommand);
+        vReply(pxEmulator, "\r");
+    }
+
+    uint32_t ulAnswerMs = (bObd ? pxConfig->ulLatencyMs : pxConfig->ulAtLatencyMs) + ulJitterMs(pxEmulator);
+
+    vDelayOutput(pxEmulator, ulAnswerMs, ulNow);
+
+    if (bObd && bChance(pxEmulator, pxConfig->ui16SilentPermille))
+    {
+        pxEmulator->ulSilent++;
+        return;
+    }
+
+    if ((strcmp(cCompact, "ATMA") == 0) || (strncmp(cCompact, "ATMR", 4) == 0))
+    {
+        pxEmulator->bMonitoring = true;
+        pxEmulator->ulNextBroadcast = ulNow + pxConfig->ulAtLatencyMs;
+        pxEmulator->i32MonitorExchange = i32FindExchange(&pxEmulator->xReplay, cCompact);
+        pxEmulator->ulMonitorLine = 0;
+        return;
+    }
+
+    if (strcmp(cCompact, "ATZ") == 0)
+    {
+        vDefaultSettings(pxEmulator);
+        vReply(pxEmulator, "\r\rELM327 v1.5\r\r>");
+        return;
+    }
+
+    if (strcmp(cCompact, "ATDPN") == 0)
+    {
+        char cProtocol[8];
+
+        snprintf(cProtocol, sizeof(cProtocol), "%s%X\r", pxEmulator->bAutoProtocol ? "A" : "", pxEmulator->ucProtocol);
+        vReply(pxEmulator, cProtocol);
+        vReply(pxEmulator, "\r>");
+        return;
+    }
+
+    if (strncmp(cCompact, "ATSP", 4) == 0)
+        vSelectProtocol(pxEmulator, &cCompact[4]);
+    else if ((strncmp(cCompact, "ATST", 4) == 0) && (strlen(cCompact) == 6))
+        pxEmulator->ucTimeout = (ucHexDigit(cCompact[4]) << 4) | ucHexDigit(cCompact[5]);
+    else if ((strncmp(cCompact, "ATAT", 4) == 0) && (cCompact[4] >= '0') && (cCompact[4] <= '2'))
+        pxEmulator->ucAdaptiveTiming = cCompact[4] - '0';
+    else if ((strlen(cCompact) == 4) && (cCompact[0] == 'A') && (cCompact[1] == 'T') && ((cCompact[3] == '0') || (cCompact[3] == '1')))
+    {
+        bool bOn = cCompact[3] == '1';
+
+        if (cCompact[2] == 'E')
+            pxEmulator->bEcho = bOn;
+        else if (cCompact[2] == 'H')
+            pxEmulator->bHeaders = bOn;
+        else if (cCompact[2] == 'S')
+            pxEmulator->bSpaces = bOn;
+        else if (cCompact[2] == 'L')
+            pxEmulator->bLinefeeds = bOn;
+    }
+
+    int32_t i32Exchange = i32FindExchange(&pxEmulator->xReplay, cCompact);
+
+    if (bObd && !bConnectProtocol(pxEmulator, ulNow))
+        vReply(pxEmulator, "UNABLE TO CONNECT\r");
+    else if (bObd && (ulAnswerMs > pxEmulator->ucTimeout * 4u))
+    {
+        // The ELM327 gave up before the ECU answered
+        vReply(pxEmulator, "NO DATA\r");
+        pxEmulator->ulTimedOut++;
+        ulAnswerMs = pxEmulator->ucTimeout * 4;
+    }
+    else if (bObd && bChance(pxEmulator, pxConfig->ui16NoDataPermille))
+    {
+        vReply(pxEmulator, "NO DATA\r");
+        pxEmulator->ulNoData++;
+    }
+    else if (bObd && bChance(pxEmulator, pxConfig->ui16StoppedPermille))
+    {
+        vReply(pxEmulator, "STOPPED\r");
+        pxEmulator->ulStopped++;
+    }
+    else if (i32Exchange >= 0)
+    {
+        const ElmReplayExchange_t *pxExchange = &pxEmulator->xReplay.pxExchanges[i32Exchange];
+        const char *pcLines = &pxEmulator->xReplay.pcText[pxExchange->ulOffset];
+        uint32_t ulLength = pxExchange->ulLength;
+        size_t xEcho = strlen(pcCommand);
+
+        // The recording has its own echo when it was taken with echo on
+        if ((ulLength > xEcho) && (memcmp(pcLines, pcCommand, xEcho) == 0) && (pcLines[xEcho] == '\r'))
+        {
+            pcLines += xEcho + 1;
+            ulLength -= xEcho + 1;
+        }
+
+        vOutput(pxEmulator, pcLines, ulLength);
+        pxEmulator->ulReplayed++;
+        ucFrames = bObd ? ucCountFrames(pcLines, ulLength) : 0;
+    }
+    else if ((cCompact[0] == 'A') && (cCompact[1] == 'T'))
+        vReply(pxEmulator, "OK\r");
+    else if (bObd)
+        ucFrames = ucReplyMode01(pxEmulator, cCompact, ucExpected, ulNow);
+    else
+        vReply(pxEmulator, "?\r");
+
+    vReply(pxEmulator, "\r>");
+
+    // The ECU answered: the ELM327 listens for more unless the response count
+    // was reached. Then every byte of the reply crosses its UART
+    if ((ucFrames > 0) && ((ucExpected == 0) || (ucFrames < ucExpected)))
+        ulAnswerMs += ulListenMs(pxEmulator, ulAnswerMs);
+
+    if (pxConfig->ulBaud > 0)
+        ulAnswerMs += ((pxEmulator->xOutputLength - xQueued) * 10000 + pxConfig->ulBaud - 1) / pxConfig->ulBaud;
+
+    vDelayOutput(pxEmulator, ulAnswerMs, ulNow);
+}
+
+// Host to ELM327: one command per CR. Any byte stops a running monitor
+void vElmEmulatorWrite(ElmEmulator_t *pxEmulator, const char *pcData, size_t xLength, uint32_t ulNow)
+{
+    for (size_t i = 0; i < xLength; i++)
+    {
+        char c = pcData[i];
+
+        if (pxEmulator->bMonitoring)
+        {
+            pxEmulator->bMonitoring = false;
+            vReply(pxEmulator, "\r>");
+            vDelayOutput(pxEmulator, 0, ulNow);
+            continue;
+        }
+
+        if (c == '\r')
+        {
+            pxEmulator->cCommand[pxEmulator->ucCommandLength] = '\0';
+            vExecute(pxEmulator, pxEmulator->cCommand, ulNow);
+            pxEmulator->ucCommandLength = 0;
+        }
+        else if ((c != '\n') && (pxEmulator->ucCommandLength < sizeof(pxEmulator->cCommand) - 1))
+            pxEmulator->cCommand[pxEmulator->ucCommandLength++] = c;
+    }
+}
+
+// ELM327 to host: whatever is due by ulNow
+size_t xElmEmulatorRead(ElmEmulator_t *pxEmulator, char *pcData, size_t xMax, uint32_t ulNow)
+{
+    while (pxEmulator->bMonitoring && ((int32_t)(ulNow - pxEmulator->ulNextBroadcast) >= 0))
+    {
+        if (pxEmulator->xOutputLength == 0)
+            pxEmulator->ulOutputDue = pxEmulator->ulNextBroadcast;
+
+        vReplyBroadcast(pxEmulator, pxEmulator->ulNextBroadcast);
+        pxEmulator->ulNextBroadcast += pxEmulator->xConfig.ulBroadcastPeriodMs;
+        pxEmulator->ulFrames++;
+    }
+
+    if ((pxEmulator->xOutputLength == 0) || ((int32_t)(ulNow - pxEmulator->ulOutputDue) < 0))
+        return 0;
+
+    size_t xLength = pxEmulator->xOutputLength < xMax ? pxEmulator->xOutputLength : xMax;
+
+    memcpy(pcData, pxEmulator->cOutput, xLength);
+    memmove(pxEmulator->cOutput, &pxEmulator->cOutput[xLength], pxEmulator->xOutputLength - xLength);
+    pxEmulator->xOutputLength -= xLength;
+
+    return xLength;
+}
+
+// Milliseconds until xElmEmulatorRead has something, 0 if it has now
+uint32_t ulElmEmulatorNextDue(ElmEmulator_t *pxEmulator, uint32_t ulNow)
+{
+    uint32_t ulDue = ELM_EMULATOR_NOTHING_DUE;
+
+    if (pxEmulator->xOutputLength > 0)
+        ulDue = ((int32_t)(pxEmulator->ulOutputDue - ulNow) > 0) ? pxEmulator->ulOutputDue - ulNow : 0;
+
+    if (pxEmulator->bMonitoring)
+    {
+        uint32_t ulFrame = ((int32_t)(pxEmulator->ulNextBroadcast - ulNow) > 0) ? pxEmulator->ulNextBroadcast - ulNow : 0;
+
+        if (ulFrame < ulDue)
+            ulDue = ulFrame;
+    }
+
+    return ulDue;
+}
+
+void vElmEmulatorPrintStats(const ElmEmulator_t *pxEmulator)
+{
+    printf("Emulator %u commands, %u OBD requests (%u counted), %u replayed, %u NO DATA, %u STOPPED, %u unanswered, "
+           "%u timed out, %u monitor frames\n",
+           (unsigned)pxEmulator->ulCommands, (unsigned)pxEmulator->ulObdRequests, (unsigned)pxEmulator->ulCounted,
+           (unsigned)pxEmulator->ulReplayed, (unsigned)pxEmulator->ulNoData, (unsigned)pxEmulator->ulStopped,
+           (unsigned)pxEmulator->ulSilent, (unsigned)pxEmulator->ulTimedOut, (unsigned)pxEmulator->ulFrames);
+}
@@ -0,0 +1,96 @@
+#ifndef ELM_EMULATOR_H
+#define ELM_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ELM_EMULATOR_COMMAND_MAX 64
+#define ELM_EMULATOR_OUTPUT_MAX 2048
+#define ELM_EMULATOR_NOTHING_DUE 0xFFFFFFFF
+
+typedef struct
+{
+    uint32_t ulLatencyMs;          // OBD request to response
+    uint32_t ulAtLatencyMs;        // AT command to response
+    uint32_t ulJitterMs;           // Uniformly added on top of ulLatencyMs
+    uint16_t ui16NoDataPermille;   // OBD requests answered with NO DATA
+    uint16_t ui16StoppedPermille;  // OBD requests answered with STOPPED
+    uint16_t ui16SilentPermille;   // OBD requests never answered
+    uint32_t ulBroadcastPeriodMs;  // Frame spacing while monitoring
+    uint32_t ulSearchMs;           // Added to the first OBD request when the protocol must be searched
+    uint8_t ucProtocol;            // The car's protocol as AT DPN numbers it
+    uint8_t ucUnsupportedPid;      // Left out of every Mode 01 answer, 0 for none
+    uint32_t ulBaud;               // ELM327 UART to the Bluetooth module, 10 bits a byte, 0 for no wire time
+    uint32_t ulSeed;
+    const char *pcReplayPath;
+} ElmEmulatorConfig_t;
+
+// One recorded command and the lines it was answered with
+typedef struct
+{
+    char cCommand[ELM_EMULATOR_COMMAND_MAX];
+    uint32_t ulOffset; // Into cText, lines separated by '\r'
+    uint32_t ulLength;
+    int32_t i32LatencyMs; // -1 if not recorded
+} ElmReplayExchange_t;
+
+typedef struct
+{
+    char *pcText;
+    ElmReplayExchange_t *pxExchanges;
+    uint32_t ulExchangeCount;
+    uint32_t ulCursor;
+} ElmReplay_t;
+
+// ELM327 stand-in, independent of how bytes and time are delivered: the
+// in-process transport and the pty server both drive it with their clocks.
+// Answers come from a recorded session when it has the command, otherwise
+// from a simulated engine
+typedef struct
+{
+    ElmEmulatorConfig_t xConfig;
+    ElmReplay_t xReplay;
+
+    char cCommand[ELM_EMULATOR_COMMAND_MAX];
+    uint8_t ucCommandLength;
+    char cOutput[ELM_EMULATOR_OUTPUT_MAX];
+    size_t xOutputLength;
+    uint32_t ulOutputDue;
+
+    bool bEcho;
+    bool bHeaders;
+    bool bSpaces;
+    bool bLinefeeds;
+    uint8_t ucAdaptiveTiming; // AT AT0 to AT AT2
+    uint8_t ucTimeout;        // AT ST, 4 ms units
+    bool bMonitoring;
+    uint8_t ucProtocol;     // Found or set, 0 before the search
+    bool bAutoProtocol;     // AT DPN answers with the 'A' prefix
+    uint8_t ucTryProtocol;  // AT SP Ah: tried before searching
+    uint32_t ulNextBroadcast;
+    int32_t i32MonitorExchange; // Replayed monitor session, or -1
+    uint32_t ulMonitorLine;
+    uint32_t ulRandom;
+
+    uint32_t ulCommands;
+    uint32_t ulObdRequests;
+    uint32_t ulReplayed;
+    uint32_t ulNoData;
+    uint32_t ulStopped;
+    uint32_t ulSilent;
+    uint32_t ulTimedOut; // NO DATA because AT ST was shorter than the answer
+    uint32_t ulCounted;  // OBD requests with a response count
+    uint32_t ulFrames;
+} ElmEmulator_t;
+
+void vElmEmulatorDefaults(ElmEmulatorConfig_t *pxConfig);
+int iElmEmulatorParseOption(ElmEmulatorConfig_t *pxConfig, int argc, char **argv, int i);
+const char *pcElmEmulatorUsage(void);
+
+bool bElmEmulatorInit(ElmEmulator_t *pxEmulator, const ElmEmulatorConfig_t *pxConfig);
+void vElmEmulatorWrite(ElmEmulator_t *pxEmulator, const char *pcData, size_t xLength, uint32_t ulNow);
+size_t xElmEmulatorRead(ElmEmulator_t *pxEmulator, char *pcData, size_t xMax, uint32_t ulNow);
+uint32_t ulElmEmulatorNextDue(ElmEmulator_t *pxEmulator, uint32_t ulNow);
+void vElmEmulatorPrintStats(const ElmEmulator_t *pxEmulator);
+
+#endif
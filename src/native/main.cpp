@@ -0,0 +1,832 @@
+// Host build (pio run -e native): the acquisition, decoding, max tracking and
+// rendering code against the ELM327 emulator, a framebuffer and a scripted
+// touch pad.
+//
+//   .pio/build/native/program [options]
+//
+// By default the emulator runs in-process on a virtual clock, which makes a
+// run fast and repeatable. With --port the same code talks to a serial
+// device in real time instead, e.g. the pty opened by tools/elm_pty.
+
+// The unit tests (pio test -e native) build the sources with their own main
+#ifndef PIO_UNIT_TESTING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hal.h"
+#include "elm_link.h"
+#include "acquisition.h"
+#include "vehicle.h"
+#include "display.h"
+#include "gauges.h"
+#include "input.h"
+#include "telemetry.h"
+#include "report.h"
+#include "metrics.h"
+#include "logger.h"
+#include "playback.h"
+#include "max_store.h"
+#include "adapter_cache.h"
+#include "boot_profile.h"
+#include "elm_emulator.h"
+#include "native_hal.h"
+
+#define NATIVE_REPORT_PERIOD_MS 10000
+#define NATIVE_PRESS_AT_MS 30000
+#define NATIVE_PRESS_FOR_MS 700
+#define NATIVE_JOBS_MAX 32
+#define NATIVE_KEPT_MAX_BITS (GAUGES_CHANNEL_BIT(CHANNEL_BOOST) | GAUGES_CHANNEL_BIT(CHANNEL_IAT) | \
+                              GAUGES_CHANNEL_BIT(CHANNEL_OIL) | GAUGES_CHANNEL_BIT(CHANNEL_COOLANT))
+
+typedef struct
+{
+    uint16_t ui16Pixels[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+    int16_t i16X1, i16Y1, i16X2, i16Y2;
+    int16_t i16X, i16Y;
+    uint32_t ulPixels;
+} Framebuffer_t;
+
+typedef struct
+{
+    uint32_t ulRunMs;
+    const char *pcPort;
+    uint8_t ucBatchMax;
+    uint16_t ui16PeriodMs; // 0 keeps the vehicle table
+    bool bBroadcast;
+    bool bCalibrate;
+    const char *pcPpmPath;
+    const char *pcLogPath;
+    const char *pcPlayPath;
+    const char *pcNvsPath;
+    uint16_t ui16SpeedPercent;
+    bool bBarBench;
+    bool bAllPids;
+    uint8_t ucLayout;
+    ElmEmulatorConfig_t xEmulator;
+} Options_t;
+
+static Framebuffer_t xFramebuffer;
+static ElmEmulator_t xEmulator;
+static EmulatorTransport_t xEmulatorTransport;
+static SerialTransport_t xSerialTransport;
+static HalTransport_t xTransport;
+static const HalClock_t *pxClock = &xVirtualClock;
+static ElmLink_t xElmLink;
+static BroadcastMonitor_t xBroadcastMonitor;
+static Acquisition_t xAcquisition;
+static PidSchedule_t xJobs[NATIVE_JOBS_MAX];
+static uint32_t ulTotalSamples[NATIVE_JOBS_MAX];
+static Telemetry_t xTelemetry;
+static Metrics_t xMetrics;
+static Logger_t xLogger;
+static FILE *pxLogFile = NULL;
+static KeyValue_t xKeyValue;
+static const HalKeyValue_t xNvs = {&xKeyValue, bKeyValueLoad, bKeyValueStore};
+static MaxStore_t xMaxStore;
+static AdapterCache_t xAdapterCache;
+static BootProfile_t xBootProfile;
+static InputButton_t xButton;
+static uint32_t ulPendingChannels = 0;
+static EstimatorBank_t xEstimators;
+static uint32_t ulMovingChannels = 0; // Estimates drawn again at ulNextFrameMs
+static uint32_t ulNextFrameMs = 0;
+static uint32_t ulFrames = 0;
+static uint32_t ulErrors = 0;
+
+static void vFramebufferSetWindow(void *pvContext, int16_t i16X1, int16_t i16Y1, int16_t i16X2, int16_t i16Y2)
+{
+    Framebuffer_t *pxFramebuffer = (Framebuffer_t *)pvContext;
+
+    pxFramebuffer->i16X1 = i16X1;
+    pxFramebuffer->i16Y1 = i16Y1;
+    pxFramebuffer->i16X2 = i16X2;
+    pxFramebuffer->i16Y2 = i16Y2;
+    pxFramebuffer->i16X = i16X1;
+    pxFramebuffer->i16Y = i16Y1;
+}
+
+static void vFramebufferPushPixels(void *pvContext, const uint16_t *pui16Pixels, uint32_t ulCount, bool bFirst)
+{
+    Framebuffer_t *pxFramebuffer = (Framebuffer_t *)pvContext;
+
+    if (bFirst)
+    {
+        pxFramebuffer->i16X = pxFramebuffer->i16X1;
+        pxFramebuffer->i16Y = pxFramebuffer->i16Y1;
+    }
+
+    for (uint32_t i = 0; i < ulCount; i++)
+    {
+        if ((pxFramebuffer->i16X >= 0) && (pxFramebuffer->i16X < DISPLAY_WIDTH) &&
+            (pxFramebuffer->i16Y >= 0) && (pxFramebuffer->i16Y < DISPLAY_HEIGHT))
+            pxFramebuffer->ui16Pixels[pxFramebuffer->i16Y][pxFramebuffer->i16X] = pui16Pixels[i];
+
+        if (++pxFramebuffer->i16X > pxFramebuffer->i16X2)
+        {
+            pxFramebuffer->i16X = pxFramebuffer->i16X1;
+            pxFramebuffer->i16Y++;
+        }
+    }
+
+    pxFramebuffer->ulPixels += ulCount;
+}
+
+static const HalSurface_t xSurface = {&xFramebuffer, vFramebufferSetWindow, vFramebufferPushPixels};
+
+// Held once, long enough to reset the max values
+static bool bScriptedPress(void *pvContext)
+{
+    uint32_t ulNow = pxClock->ulMillis();
+
+    return (ulNow >= NATIVE_PRESS_AT_MS) && (ulNow < NATIVE_PRESS_AT_MS + NATIVE_PRESS_FOR_MS);
+}
+
+static const HalInput_t xInput = {NULL, bScriptedPress};
+
+static void vPublish(uint8_t ucChannel, float fValue)
+{
+    if (ucChannel == CHANNEL_BOOST)
+        bBootProfileFirstReading(&xBootProfile);
+
+    bool bChanged = bTelemetryPublish(&xTelemetry, ucChannel, fValue, pxClock->ulMillis());
+
+    if ((pxLogFile != NULL) && bLoggerAppend(&xLogger, ucChannel, fValue, pxClock->ulMillis()))
+        ulLoggerFlush(&xLogger);
+
+    vMetricsPublished(&xMetrics, ucChannel, xAcquisition.ulSentUs, xAcquisition.ulParsedUs, pxClock->ulMicros(), bChanged);
+
+    vMaxStoreUpdate(&xMaxStore, ucChannel, xTelemetry.xChannels[ucChannel].fMax, pxClock->ulMillis());
+
+    if (bChanged)
+        ulPendingChannels |= GAUGES_CHANNEL_BIT(ucChannel);
+}
+
+static void vError(const char *pcJob, int8_t i8Status)
+{
+    printf("%s ERROR: %s\n", pcJob, pcElmStatusName(i8Status));
+    vMetricsError(&xMetrics, i8Status);
+    ulErrors++;
+}
+
+// Playback goes through the telemetry store and the renderer only, it is
+// neither logged again nor counted as acquisition latency
+static void vPlaybackPublish(uint8_t ucChannel, float fValue)
+{
+    if (bTelemetryPublish(&xTelemetry, ucChannel, fValue, pxClock->ulMillis()))
+        ulPendingChannels |= GAUGES_CHANNEL_BIT(ucChannel);
+}
+
+static size_t xLogFileRead(void *pvContext, uint8_t *pucData, size_t xLength)
+{
+    return fread(pucData, 1, xLength, (FILE *)pvContext);
+}
+
+static size_t xLogFileAppend(void *pvContext, const uint8_t *pucData, size_t xLength)
+{
+    return fwrite(pucData, 1, xLength, (FILE *)pvContext);
+}
+
+static void vWritePpm(const char *pcPath)
+{
+    FILE *pxFile = fopen(pcPath, "wb");
+
+    if (pxFile == NULL)
+        return;
+
+    fprintf(pxFile, "P6\n%d %d\n255\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    for (register int16_t y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+        for (register int16_t x = 0; x < DISPLAY_WIDTH; x++)
+        {
+            uint16_t ui16Pixel = xFramebuffer.ui16Pixels[y][x];
+            uint8_t ucRgb[3] = {(uint8_t)((ui16Pixel >> 11) << 3), (uint8_t)(((ui16Pixel >> 5) & 0x3F) << 2), (uint8_t)((ui16Pixel & 0x1F) << 3)};
+
+            fwrite(ucRgb, 1, sizeof(ucRgb), pxFile);
+        }
+    }
+
+    fclose(pxFile);
+}
+
+static void vUsage(const char *pcProgram)
+{
+    printf("usage: %s [options]\n"
+           "  --seconds N       run time (60)\n"
+           "  --port PATH       use a serial device in real time instead of the in-process emulator\n"
+           "  --batch N         PIDs per Mode 01 request, 1 polls them one by one (%d)\n"
+           "  --period MS       poll every OBD job at this period instead of the vehicle table\n"
+           "  --no-broadcast    skip the monitor windows\n"
+           "  --no-calibrate    keep the ELM327's default timing unless --nvs has a calibrated profile\n"
+           "  --ppm FILE        write the final screen\n"
+           "  --log FILE        record the samples like the data logger does\n"
+           "  --play FILE       feed a session log to the renderer instead of polling, to its end\n"
+           "  --speed PCT       playback pace, 100 is as recorded, 0 as fast as it renders (100)\n"
+           "  --nvs DIR         keep the stored max values in DIR, so the next run starts from them\n"
+           "  --layout NAME     street, track or diagnostics (street)\n"
+           "  --all-pids        also poll every other PID of the catalogue, once a second\n"
+           "  --bar-bench       print the bytes the boost bar pushes per update, then exit\n"
+           "%s",
+           pcProgram, OBD_MULTI_PID_MAX, pcElmEmulatorUsage());
+}
+
+static bool bParseOptions(Options_t *pxOptions, int argc, char **argv)
+{
+    pxOptions->ulRunMs = 0;
+    pxOptions->pcPort = NULL;
+    pxOptions->ucBatchMax = OBD_MULTI_PID_MAX;
+    pxOptions->ui16PeriodMs = 0;
+    pxOptions->bBroadcast = true;
+    pxOptions->bCalibrate = true;
+    pxOptions->pcPpmPath = NULL;
+    pxOptions->pcLogPath = NULL;
+    pxOptions->pcPlayPath = NULL;
+    pxOptions->pcNvsPath = NULL;
+    pxOptions->ui16SpeedPercent = 100;
+    pxOptions->bBarBench = false;
+    pxOptions->bAllPids = false;
+    pxOptions->ucLayout = LAYOUT_STREET;
+    vElmEmulatorDefaults(&pxOptions->xEmulator);
+
+    for (int i = 1; i < argc;)
+    {
+        int iNext = iElmEmulatorParseOption(&pxOptions->xEmulator, argc, argv, i);
+
+        if (iNext != i)
+            i = iNext;
+        else if (strcmp(argv[i], "--no-broadcast") == 0)
+        {
+            pxOptions->bBroadcast = false;
+            i++;
+        }
+        else if (strcmp(argv[i], "--no-calibrate") == 0)
+        {
+            pxOptions->bCalibrate = false;
+            i++;
+        }
+        else if (strcmp(argv[i], "--bar-bench") == 0)
+        {
+            pxOptions->bBarBench = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "--all-pids") == 0)
+        {
+            pxOptions->bAllPids = true;
+            i++;
+        }
+        else if (i + 1 >= argc)
+            return false;
+        else if (strcmp(argv[i], "--seconds") == 0)
+        {
+            pxOptions->ulRunMs = strtoul(argv[i + 1], NULL, 0) * 1000;
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--port") == 0)
+        {
+            pxOptions->pcPort = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--batch") == 0)
+        {
+            pxOptions->ucBatchMax = strtoul(argv[i + 1], NULL, 0);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--period") == 0)
+        {
+            pxOptions->ui16PeriodMs = strtoul(argv[i + 1], NULL, 0);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--ppm") == 0)
+        {
+            pxOptions->pcPpmPath = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--log") == 0)
+        {
+            pxOptions->pcLogPath = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--play") == 0)
+        {
+            pxOptions->pcPlayPath = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--nvs") == 0)
+        {
+            pxOptions->pcNvsPath = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--speed") == 0)
+        {
+            pxOptions->ui16SpeedPercent = strtoul(argv[i + 1], NULL, 0);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--layout") == 0)
+        {
+            int8_t i8Layout = i8LayoutFind(argv[i + 1]);
+
+            if (i8Layout < 0)
+                return false;
+
+            pxOptions->ucLayout = i8Layout;
+            i += 2;
+        }
+        else
+            return false;
+    }
+
+    if ((pxOptions->ucBatchMax < 1) || (pxOptions->ucBatchMax > OBD_MULTI_PID_MAX))
+        return false;
+
+    // Polling runs a minute by default, playback to the end of the log
+    if ((pxOptions->ulRunMs == 0) && (pxOptions->pcPlayPath == NULL))
+        pxOptions->ulRunMs = 60000;
+
+    return true;
+}
+
+// A copy of the vehicle table with the benchmark overrides applied
+static uint8_t ucBuildJobs(const Options_t *pxOptions)
+{
+    uint8_t ucCount = 0;
+
+    for (register uint8_t i = 0; (i < ucVehicleJobCount) && (ucCount < NATIVE_JOBS_MAX); i++)
+    {
+        if (!pxOptions->bBroadcast && (xVehicleJobs[i].ucPid == SCHED_NON_OBD))
+            continue;
+
+        xJobs[ucCount] = xVehicleJobs[i];
+
+        if ((pxOptions->ui16PeriodMs > 0) && (xJobs[ucCount].ucPid != SCHED_NON_OBD))
+            xJobs[ucCount].ui16PeriodMs = pxOptions->ui16PeriodMs;
+
+        ucCount++;
+    }
+
+    if (!pxOptions->bAllPids)
+        return ucCount;
+
+    uint8_t ucVehicleCount = ucCount;
+
+    for (register uint8_t i = 0; (i < ucObdPidCount()) && (ucCount < NATIVE_JOBS_MAX); i++)
+    {
+        const ObdPidDef_t *pxDef = pxObdPidAt(i);
+        bool bPolled = false;
+
+        for (register uint8_t j = 0; j < ucVehicleCount; j++)
+            bPolled |= (xJobs[j].ucPid == pxDef->ucPid);
+
+        if (bPolled)
+            continue;
+
+        xJobs[ucCount] = SCHED_JOB(pxDef->pcName, pxDef->ucPid, 1000, 1, 5000);
+
+        if (pxOptions->ui16PeriodMs > 0)
+            xJobs[ucCount].ui16PeriodMs = pxOptions->ui16PeriodMs;
+
+        ucCount++;
+    }
+
+    return ucCount;
+}
+
+static void vAccumulateSamples(void)
+{
+    for (register uint8_t i = 0; i < xAcquisition.xScheduler.ucJobCount; i++)
+        ulTotalSamples[i] += xJobs[i].ulSamples;
+}
+
+static void vRenderPending(void)
+{
+    uint32_t ulNow = pxClock->ulMillis();
+
+    if ((ulMovingChannels != 0) && ((int32_t)(ulNow - ulNextFrameMs) >= 0))
+        ulPendingChannels |= ulMovingChannels;
+
+    if (ulPendingChannels == 0)
+        return;
+
+    TelemetrySnapshot_t xSnapshot;
+
+    vTelemetryRead(&xTelemetry, &xSnapshot);
+    ulMovingChannels = ulEstimatorBankApply(&xEstimators, &xSnapshot, ulNow);
+    vGaugesRender(&xSnapshot, ulPendingChannels);
+    vMetricsDrawn(&xMetrics, ulPendingChannels, pxClock->ulMicros());
+    ulPendingChannels = 0;
+    ulNextFrameMs = ulNow + ESTIMATOR_FRAME_MS;
+    ulFrames++;
+}
+
+// An idle wait cut short for the next estimator frame
+static uint32_t ulUntilFrame(uint32_t ulWait)
+{
+    if (ulMovingChannels == 0)
+        return ulWait;
+
+    int32_t i32Left = (int32_t)(ulNextFrameMs - pxClock->ulMillis());
+
+    if (i32Left <= 0)
+        return 1;
+
+    return ((uint32_t)i32Left < ulWait) ? (uint32_t)i32Left : ulWait;
+}
+
+static void vPollInput(uint32_t ulStart, uint32_t *pulNextPoll)
+{
+    if ((int32_t)(pxClock->ulMillis() - *pulNextPoll) < 0)
+        return;
+
+    InputEvent_t xEvent = xInputPoll(&xButton);
+
+    if (xEvent == INPUT_EVENT_RESET)
+    {
+        printf("RESET VALUES at %u ms\n", (unsigned)(pxClock->ulMillis() - ulStart));
+        vTelemetryRequestReset(&xTelemetry, GAUGES_CHANNEL_BIT(CHANNEL_BOOST) | GAUGES_CHANNEL_BIT(CHANNEL_IAT) |
+                                                GAUGES_CHANNEL_BIT(CHANNEL_OIL) | GAUGES_CHANNEL_BIT(CHANNEL_COOLANT));
+    }
+
+    *pulNextPoll = pxClock->ulMillis() + ((xEvent == INPUT_EVENT_HELD) ? INPUT_HOLD_TICK_MS : INPUT_POLL_MS);
+}
+
+// Drives the renderer from a session log. Paced playback runs on the virtual
+// clock; unthrottled it renders after every timestamp and reports the host
+// throughput, which makes it a render benchmark
+static int iRunPlayback(const Options_t *pxOptions)
+{
+    static Playback_t xPlayback;
+    FILE *pxFile = fopen(pxOptions->pcPlayPath, "rb");
+    bool bUnthrottled = pxOptions->ui16SpeedPercent == PLAYBACK_UNTHROTTLED;
+
+    pxClock = bUnthrottled ? &xHostClock : &xVirtualClock;
+
+    HalStorage_t xStorage = {pxFile, NULL, xLogFileRead};
+    uint32_t ulStart = pxClock->ulMillis();
+    uint64_t ullStartUs = xHostClock.ulMicros();
+    uint32_t ulNextInputPoll = ulStart;
+    uint32_t ulFields = 0;
+
+    if ((pxFile == NULL) || !bPlaybackOpen(&xPlayback, &xStorage, pxOptions->ui16SpeedPercent, ulStart))
+    {
+        printf("cannot play %s\n", pxOptions->pcPlayPath);
+        return 2;
+    }
+
+    vTelemetryInit(&xTelemetry, xVehicleChannelStats);
+    vEstimatorBankInit(&xEstimators, xVehicleEstimators);
+    vMetricsInit(&xMetrics, ulStart);
+    vGaugesInit(&xSurface, &xHostClock);
+    vGaugesSetLayout(pxOptions->ucLayout);
+    vInputInit(&xButton, &xInput);
+
+    while ((pxOptions->ulRunMs == 0) || (pxClock->ulMillis() - ulStart < pxOptions->ulRunMs))
+    {
+        ulPendingChannels |= ulTelemetryApplyResets(&xTelemetry);
+
+        uint32_t ulWait = ulPlaybackStep(&xPlayback, vPlaybackPublish, pxClock->ulMillis());
+
+        if (ulWait == PLAYBACK_END)
+            break;
+
+        vRenderPending();
+
+        if (!bUnthrottled)
+        {
+            vPollInput(ulStart, &ulNextInputPoll);
+            if (ulWait > 0)
+                vVirtualClockAdvance(ulUntilFrame(ulWait) * 1000);
+        }
+    }
+
+    double dSeconds = (uint32_t)(xHostClock.ulMicros() - ullStartUs) / 1e6;
+    DisplayStats_t xDisplayStats = xDisplayTakeStats();
+
+    for (register uint8_t i = 0; i < RENDER_HISTOGRAM_BUCKETS; i++)
+        ulFields += xDisplayStats.ulRenderHistogram[i];
+
+    printf("=== playback of %.1f s of log at %u%%, %.3f s host time\n",
+           (xPlayback.xNext.ulTimestampMs - xPlayback.ulLogStartMs) / 1000.0, pxOptions->ui16SpeedPercent, dSeconds);
+    printf("%u samples, %u frames, %u field updates, %u glyphs, %u bytes pushed\n", (unsigned)xPlayback.ulSamples,
+           (unsigned)ulFrames, (unsigned)ulFields, (unsigned)xDisplayStats.ulGlyphsDrawn, (unsigned)xDisplayStats.ulBytesPushed);
+    if (bUnthrottled && (dSeconds > 0))
+        printf("%.0f samples/s, %.0f frames/s, %.0f field updates/s\n", xPlayback.ulSamples / dSeconds, ulFrames / dSeconds, ulFields / dSeconds);
+    printf("Log %u blocks, %u damaged\n", (unsigned)xPlayback.xReader.ulBlocks, (unsigned)xPlayback.xReader.ulBadBlocks);
+
+    if (pxOptions->pcPpmPath != NULL)
+        vWritePpm(pxOptions->pcPpmPath);
+
+    fclose(pxFile);
+
+    return 0;
+}
+
+// One bar update, returning the bytes it pushed
+static uint32_t ulBarUpdate(DisplayBar_t *pxBar, float fValue, float fPeak)
+{
+    vBarDraw(pxBar, fValue, fPeak);
+
+    return xDisplayTakeStats().ulBytesPushed;
+}
+
+static void vBarBenchPrint(const char *pcLabel, uint32_t ulUpdates, uint32_t ulBytes)
+{
+    printf("%-28s %5u updates %7u bytes %7.1f bytes/update\n", pcLabel, (unsigned)ulUpdates, (unsigned)ulBytes,
+           (double)ulBytes / ulUpdates);
+}
+
+// The street layout's boost bar, for small and large value changes, next to
+// what repainting the whole bar every time would push
+static int iRunBarBench(void)
+{
+    const LayoutWidget_t *pxWidget = pxLayoutWidget(&xLayouts[LAYOUT_STREET], WIDGET_BAR, CHANNEL_BOOST);
+    DisplayBar_t xBar;
+    uint32_t ulBytes = 0;
+    uint32_t ulUpdates = 0;
+    float fMin = pxWidget->pxFormat->i32Zero;
+    float fMax = pxWidget->pxFormat->i32ValidMax;
+    float fPeak = fMin;
+
+    vDisplayInit(&xSurface, xHostClock.ulMicros);
+    vBarInit(&xBar, pxWidget->i16X, pxWidget->i16Y, pxWidget->i16Width, pxWidget->i16Height, fMin, fMax, pxWidget->pxColour,
+             pxWidget->ui16Colour);
+
+    printf("Boost bar %ux%u, %.0f to %.0f kPa\n", pxWidget->i16Width, pxWidget->i16Height, fMin, fMax);
+    vBarBenchPrint("first draw", 1, ulBarUpdate(&xBar, 150, 150));
+
+    // Up and down by 1 kPa, about a third of a row, with the peak following
+    for (register uint8_t ucPass = 0; ucPass < 10; ucPass++)
+    {
+        for (register int16_t i = 0; i < 200; i++)
+        {
+            float fValue = 150 + ((i < 100) ? i : (200 - i));
+
+            if (fValue > fPeak)
+                fPeak = fValue;
+            ulBytes += ulBarUpdate(&xBar, fValue, fPeak);
+            ulUpdates++;
+        }
+    }
+    vBarBenchPrint("1 kPa steps", ulUpdates, ulBytes);
+
+    ulBytes = 0;
+    ulUpdates = 0;
+    for (register uint16_t i = 0; i < 1000; i++)
+    {
+        ulBytes += ulBarUpdate(&xBar, 150 + 5 * ((i % 20 < 10) ? (i % 20) : (20 - i % 20)), fPeak);
+        ulUpdates++;
+    }
+    vBarBenchPrint("5 kPa steps", ulUpdates, ulBytes);
+
+    // Full throttle and back: the whole range every update
+    ulBytes = 0;
+    ulUpdates = 0;
+    for (register uint16_t i = 0; i < 1000; i++)
+    {
+        ulBytes += ulBarUpdate(&xBar, (i & 1) ? fMax : fMin, fMax);
+        ulUpdates++;
+    }
+    vBarBenchPrint("full range swings", ulUpdates, ulBytes);
+
+    ulBytes = 0;
+    ulUpdates = 0;
+    for (register uint16_t i = 0; i < 1000; i++)
+    {
+        vBarInvalidate(&xBar);
+        ulBytes += ulBarUpdate(&xBar, 150 + (i % 100), fMax);
+        ulUpdates++;
+    }
+    vBarBenchPrint("whole bar repainted", ulUpdates, ulBytes);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options_t xOptions;
+
+    if (!bParseOptions(&xOptions, argc, argv))
+    {
+        vUsage(argv[0]);
+        return 2;
+    }
+
+    if (xOptions.bBarBench)
+        return iRunBarBench();
+
+    if (xOptions.pcPlayPath != NULL)
+        return iRunPlayback(&xOptions);
+
+    if (xOptions.pcPort != NULL)
+    {
+        if (!bSerialTransportOpen(&xSerialTransport, xOptions.pcPort, &xElmLink))
+        {
+            printf("cannot open %s\n", xOptions.pcPort);
+            return 2;
+        }
+
+        xTransport = (HalTransport_t){&xSerialTransport, xSerialTransportWrite, vSerialTransportWait};
+        pxClock = &xHostClock;
+    }
+    else
+    {
+        if (!bElmEmulatorInit(&xEmulator, &xOptions.xEmulator))
+        {
+            printf("cannot load %s\n", xOptions.xEmulator.pcReplayPath);
+            return 2;
+        }
+
+        xEmulatorTransport.pxEmulator = &xEmulator;
+        xEmulatorTransport.pxLink = &xElmLink;
+        xTransport = (HalTransport_t){&xEmulatorTransport, xEmulatorTransportWrite, vEmulatorTransportWait};
+    }
+
+    static HalStorage_t xLogStorage;
+
+    if (xOptions.pcLogPath != NULL)
+    {
+        pxLogFile = fopen(xOptions.pcLogPath, "wb");
+        if (pxLogFile == NULL)
+        {
+            printf("cannot write %s\n", xOptions.pcLogPath);
+            return 2;
+        }
+
+        xLogStorage = (HalStorage_t){pxLogFile, xLogFileAppend, NULL};
+        vLoggerInit(&xLogger, &xLogStorage);
+    }
+
+    uint8_t ucJobCount = ucBuildJobs(&xOptions);
+    uint32_t ulStart = pxClock->ulMillis();
+    uint32_t ulNextReport = ulStart + NATIVE_REPORT_PERIOD_MS;
+    uint32_t ulNextInputPoll = ulStart;
+    uint32_t ulExchanges = 0;
+    uint64_t ullBusyMs = 0;
+    uint32_t ulLongestMs = 0;
+
+    vTelemetryInit(&xTelemetry, xVehicleChannelStats);
+    vEstimatorBankInit(&xEstimators, xVehicleEstimators);
+    vMetricsInit(&xMetrics, ulStart);
+
+    float fMax;
+
+    xKeyValue.pcDirectory = xOptions.pcNvsPath;
+    vMaxStoreInit(&xMaxStore, &xNvs, NATIVE_KEPT_MAX_BITS);
+    bMaxStoreLoad(&xMaxStore, ulStart);
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (bMaxStoreGet(&xMaxStore, i, &fMax))
+            vTelemetryRestoreMax(&xTelemetry, i, fMax);
+    }
+
+    vBroadcastInit(&xBroadcastMonitor, xVehicleBroadcastSignals, ucVehicleBroadcastSignalCount);
+    vElmLinkInit(&xElmLink, &xTransport, pxClock);
+
+    // As on the ESP32 after the Bluetooth connection: the protocol and link
+    // profile cached by an earlier run with the same --nvs directory are used
+    // first, the calibration only runs without a cached profile
+    vBootProfileInit(&xBootProfile, pxClock);
+    vAdapterCacheInit(&xAdapterCache, &xNvs);
+    bAdapterCacheLoad(&xAdapterCache);
+    if (xAdapterCache.xRecord.bHasProfile)
+        xElmLink.xProfile = xAdapterCache.xRecord.xProfile;
+
+    vAcquisitionInit(&xAcquisition, xJobs, ucJobCount, xOptions.ucBatchMax, &xElmLink, &xBroadcastMonitor, vPublish, vError, pxClock);
+    xAcquisition.xRecovery.ucProtocol = xAdapterCache.xRecord.ucProtocol;
+
+    bool bBootReported = false;
+    int8_t i8Stage = i8BootProfileBegin(&xBootProfile, "elm start");
+    if (!bElmLinkStart(&xElmLink, xAdapterCache.xRecord.ucProtocol))
+        printf("ELM327 did not answer AT Z\n");
+    vBootProfileEnd(&xBootProfile, i8Stage);
+
+    i8Stage = i8BootProfileBegin(&xBootProfile, "pid support");
+    if (!bAcquisitionReadSupport(&xAcquisition))
+        printf("No supported PIDs list, PIDs are set aside after %u misses\n", SCHED_QUARANTINE_FAILURES);
+    vBootProfileEnd(&xBootProfile, i8Stage);
+
+    if (xOptions.bCalibrate && !xAdapterCache.xRecord.bHasProfile)
+    {
+        ElmCalibrationResult_t xCalibration;
+
+        i8Stage = i8BootProfileBegin(&xBootProfile, "calibrate");
+        if (bAcquisitionCalibrate(&xAcquisition, &xCalibration))
+            bAdapterCacheSetProfile(&xAdapterCache, &xElmLink.xProfile);
+        vBootProfileEnd(&xBootProfile, i8Stage);
+        vReportPrintCalibration(&xCalibration);
+    }
+    vGaugesInit(&xSurface, &xHostClock); // Render time is always host CPU time
+    vGaugesSetLayout(xOptions.ucLayout);
+    vInputInit(&xButton, &xInput);
+
+    while (pxClock->ulMillis() - ulStart < xOptions.ulRunMs)
+    {
+        uint32_t ulReset = ulTelemetryApplyResets(&xTelemetry);
+
+        vMaxStoreClear(&xMaxStore, ulReset, pxClock->ulMillis());
+        bMaxStoreService(&xMaxStore, pxClock->ulMillis());
+        ulPendingChannels |= ulReset;
+
+        uint32_t ulStepStart = pxClock->ulMillis();
+        uint32_t ulIdle = ulAcquisitionStep(&xAcquisition);
+
+        if (ulIdle == 0)
+        {
+            uint32_t ulStep = pxClock->ulMillis() - ulStepStart;
+
+            ulExchanges++;
+            ullBusyMs += ulStep;
+            if (ulStep > ulLongestMs)
+                ulLongestMs = ulStep;
+        }
+
+        if (xAcquisition.bProfileDropped)
+        {
+            xAcquisition.bProfileDropped = false;
+            bAdapterCacheClearProfile(&xAdapterCache);
+            printf("Link profile missed answers, back to the ELM327's timeout\n");
+        }
+
+        if (!bBootReported && (xBootProfile.ulFirstReadingUs != 0))
+        {
+            int8_t i8Protocol = i8ElmLinkProtocol(&xElmLink);
+
+            if (i8Protocol > 0)
+            {
+                bAdapterCacheSetProtocol(&xAdapterCache, i8Protocol);
+                xAcquisition.xRecovery.ucProtocol = i8Protocol;
+            }
+
+            vReportPrintBoot(&xBootProfile);
+            bBootReported = true;
+        }
+
+        vRenderPending();
+        vPollInput(ulStart, &ulNextInputPoll);
+
+        // Through the transport, so what the ELM327 sends meanwhile (e.g. after
+        // a recovery reset) is delivered as it would be on the ESP32
+        if (ulIdle > 0)
+            xTransport.vWaitForData(xTransport.pvContext, ulUntilFrame(ulIdle));
+
+        if ((int32_t)(pxClock->ulMillis() - ulNextReport) >= 0)
+        {
+            DisplayStats_t xDisplayStats = xDisplayTakeStats();
+            TelemetrySnapshot_t xSnapshot;
+
+            printf("--- %u s\n", (unsigned)((pxClock->ulMillis() - ulStart) / 1000));
+            vReportPrint(&xAcquisition, &xDisplayStats, &xTelemetry, pxClock->ulMillis());
+            vReportPrintMetrics(&xMetrics, pxClock->ulMillis());
+            vTelemetryRead(&xTelemetry, &xSnapshot);
+            vReportPrintStats(&xSnapshot);
+            vAccumulateSamples();
+            vSchedulerResetWindow(&xAcquisition.xScheduler, pxClock->ulMillis());
+            vMetricsResetWindow(&xMetrics, pxClock->ulMillis());
+            ulNextReport += NATIVE_REPORT_PERIOD_MS;
+        }
+    }
+
+    uint32_t ulElapsed = pxClock->ulMillis() - ulStart;
+    uint32_t ulSamples = 0;
+
+    vAccumulateSamples();
+    printf("=== %u ms, batch %u\n", (unsigned)ulElapsed, xOptions.ucBatchMax);
+    for (register uint8_t i = 0; i < ucJobCount; i++)
+    {
+        printf("%-8s %6u samples %7.2f/s\n", xJobs[i].pcName, (unsigned)ulTotalSamples[i], ulTotalSamples[i] * 1000.0 / ulElapsed);
+        ulSamples += ulTotalSamples[i];
+    }
+    printf("Total    %6u samples %7.2f/s, %u exchanges, %.1f ms mean, %u ms longest, %u errors\n",
+           (unsigned)ulSamples, ulSamples * 1000.0 / ulElapsed, (unsigned)ulExchanges,
+           ulExchanges > 0 ? (double)ullBusyMs / ulExchanges : 0.0, (unsigned)ulLongestMs, (unsigned)ulErrors);
+
+    if (xOptions.pcPort == NULL)
+        vElmEmulatorPrintStats(&xEmulator);
+
+    bMaxStoreCommit(&xMaxStore, pxClock->ulMillis()); // As the shutdown hook would
+    printf("Max store session %u: %u commits (%.1f per hour), %u lifetime, %u updates coalesced, %u failed\n",
+           (unsigned)xMaxStore.xRecord.ulSessions, (unsigned)xMaxStore.ulCommits, xMaxStore.ulCommits * 3600000.0 / ulElapsed,
+           (unsigned)xMaxStore.xRecord.ulWrites, (unsigned)xMaxStore.ulUpdates, (unsigned)xMaxStore.ulFailures);
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        const StoredMax_t *pxMax = &xMaxStore.xRecord.xMax[i];
+
+        if (bMaxStoreGet(&xMaxStore, i, &fMax))
+            printf("  %-8s max %.2f in session %u at %u ms\n", pcChannelName(i), fMax, (unsigned)pxMax->ulSession, (unsigned)pxMax->ulUptimeMs);
+    }
+
+    if (pxLogFile != NULL)
+    {
+        bLoggerSeal(&xLogger);
+        ulLoggerFlush(&xLogger);
+        printf("Logger %u samples in %ld bytes, %u dropped, %u write errors\n", (unsigned)xLogger.ulSamples, ftell(pxLogFile),
+               (unsigned)xLogger.ulDropped, (unsigned)xLogger.ulWriteErrors);
+        fclose(pxLogFile);
+    }
+
+    if (xOptions.pcPpmPath != NULL)
+        vWritePpm(xOptions.pcPpmPath);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include "native_hal.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t ullVirtualUs = 0;
+
+static uint32_t ulHostMicros(void)
+{
+    struct timespec xNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    return (uint32_t)((uint64_t)xNow.tv_sec * 1000000 + xNow.tv_nsec / 1000);
+}
+
+static uint32_t ulHostMillis(void)
+{
+    struct timespec xNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    return (uint32_t)((uint64_t)xNow.tv_sec * 1000 + xNow.tv_nsec / 1000000);
+}
+
+const HalClock_t xHostClock = {ulHostMillis, ulHostMicros};
+
+static uint32_t ulVirtualMillis(void)
+{
+    return ullVirtualUs / 1000;
+}
+
+static uint32_t ulVirtualMicros(void)
+{
+    return ullVirtualUs;
+}
+
+const HalClock_t xVirtualClock = {ulVirtualMillis, ulVirtualMicros};
+
+void vVirtualClockAdvance(uint32_t ulMicros)
+{
+    ullVirtualUs += ulMicros;
+}
+
+size_t xEmulatorTransportWrite(void *pvContext, const char *pcData, size_t xLength)
+{
+    EmulatorTransport_t *pxTransport = (EmulatorTransport_t *)pvContext;
+
+    vElmEmulatorWrite(pxTransport->pxEmulator, pcData, xLength, ulVirtualMillis());
+
+    return xLength;
+}
+
+// Jumps to whatever comes first: the next emulator output or the timeout
+void vEmulatorTransportWait(void *pvContext, uint32_t ulTimeoutMs)
+{
+    EmulatorTransport_t *pxTransport = (EmulatorTransport_t *)pvContext;
+    uint32_t ulDue = ulElmEmulatorNextDue(pxTransport->pxEmulator, ulVirtualMillis());
+    char cData[256];
+    size_t xLength;
+
+    if (ulDue > ulTimeoutMs)
+    {
+        vVirtualClockAdvance(ulTimeoutMs * 1000);
+        return;
+    }
+
+    vVirtualClockAdvance(ulDue * 1000);
+
+    while ((xLength = xElmEmulatorRead(pxTransport->pxEmulator, cData, sizeof(cData), ulVirtualMillis())) > 0)
+        vElmLinkReceive(pxTransport->pxLink, (const uint8_t *)cData, xLength);
+}
+
+bool bSerialTransportOpen(SerialTransport_t *pxSerial, const char *pcPath, ElmLink_t *pxLink)
+{
+    struct termios xTermios;
+
+    pxSerial->pxLink = pxLink;
+    pxSerial->iFd = open(pcPath, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (pxSerial->iFd < 0)
+        return false;
+
+    if (tcgetattr(pxSerial->iFd, &xTermios) == 0)
+    {
+        cfmakeraw(&xTermios);
+        cfsetispeed(&xTermios, B38400);
+        cfsetospeed(&xTermios, B38400);
+        tcsetattr(pxSerial->iFd, TCSANOW, &xTermios);
+    }
+
+    return true;
+}
+
+size_t xSerialTransportWrite(void *pvContext, const char *pcData, size_t xLength)
+{
+    SerialTransport_t *pxSerial = (SerialTransport_t *)pvContext;
+    ssize_t xWritten = write(pxSerial->iFd, pcData, xLength);
+
+    return xWritten > 0 ? xWritten : 0;
+}
+
+void vSerialTransportWait(void *pvContext, uint32_t ulTimeoutMs)
+{
+    SerialTransport_t *pxSerial = (SerialTransport_t *)pvContext;
+    struct pollfd xPoll = {pxSerial->iFd, POLLIN, 0};
+    uint8_t ucData[256];
+    ssize_t xLength;
+
+    if (poll(&xPoll, 1, ulTimeoutMs) <= 0)
+        return;
+
+    while ((xLength = read(pxSerial->iFd, ucData, sizeof(ucData))) > 0)
+        vElmLinkReceive(pxSerial->pxLink, ucData, xLength);
+}
+
+static KeyValueRecord_t *pxFindRecord(KeyValue_t *pxKeyValue, const char *pcKey, bool bCreate)
+{
+    for (register uint8_t i = 0; i < KEY_VALUE_RECORDS; i++)
+    {
+        if (strcmp(pxKeyValue->xRecords[i].cKey, pcKey) == 0)
+            return &pxKeyValue->xRecords[i];
+    }
+
+    for (register uint8_t i = 0; bCreate && (i < KEY_VALUE_RECORDS); i++)
+    {
+        if (pxKeyValue->xRecords[i].cKey[0] == '\0')
+        {
+            strncpy(pxKeyValue->xRecords[i].cKey, pcKey, KEY_VALUE_KEY_MAX - 1);
+            return &pxKeyValue->xRecords[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool bKeyValueLoad(void *pvContext, const char *pcKey, void *pvData, size_t xLength)
+{
+    KeyValue_t *pxKeyValue = (KeyValue_t *)pvContext;
+    KeyValueRecord_t *pxRecord = pxFindRecord(pxKeyValue, pcKey, false);
+
+    if ((pxRecord == NULL) && (pxKeyValue->pcDirectory != NULL))
+    {
+        char cPath[256];
+        FILE *pxFile;
+
+        snprintf(cPath, sizeof(cPath), "%s/%s", pxKeyValue->pcDirectory, pcKey);
+        pxFile = fopen(cPath, "rb");
+        if ((pxFile != NULL) && ((pxRecord = pxFindRecord(pxKeyValue, pcKey, true)) != NULL))
+            pxRecord->xLength = fread(pxRecord->ucData, 1, KEY_VALUE_DATA_MAX, pxFile);
+        if (pxFile != NULL)
+            fclose(pxFile);
+    }
+
+    if ((pxRecord == NULL) || (pxRecord->xLength != xLength))
+        return false;
+
+    memcpy(pvData, pxRecord->ucData, xLength);
+
+    return true;
+}
+
+bool bKeyValueStore(void *pvContext, const char *pcKey, const void *pvData, size_t xLength)
+{
+    KeyValue_t *pxKeyValue = (KeyValue_t *)pvContext;
+    KeyValueRecord_t *pxRecord = pxFindRecord(pxKeyValue, pcKey, true);
+
+    if ((pxRecord == NULL) || (xLength > KEY_VALUE_DATA_MAX))
+        return false;
+
+    memcpy(pxRecord->ucData, pvData, xLength);
+    pxRecord->xLength = xLength;
+    pxKeyValue->ulWrites++;
+
+    if (pxKeyValue->pcDirectory != NULL)
+    {
+        char cPath[256];
+        FILE *pxFile;
+
+        snprintf(cPath, sizeof(cPath), "%s/%s", pxKeyValue->pcDirectory, pcKey);
+        pxFile = fopen(cPath, "wb");
+        if (pxFile == NULL)
+            return false;
+        fwrite(pvData, 1, xLength, pxFile);
+        fclose(pxFile);
+    }
+
+    return true;
+}
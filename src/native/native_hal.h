@@ -0,0 +1,62 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "elm_link.h"
+#include "elm_emulator.h"
+
+// Monotonic host time
+extern const HalClock_t xHostClock;
+
+// Simulated time that only moves when the emulator transport waits, so runs
+// are fast and repeatable
+extern const HalClock_t xVirtualClock;
+void vVirtualClockAdvance(uint32_t ulMicros);
+
+// The emulator in-process, on xVirtualClock
+typedef struct
+{
+    ElmEmulator_t *pxEmulator;
+    ElmLink_t *pxLink;
+} EmulatorTransport_t;
+
+size_t xEmulatorTransportWrite(void *pvContext, const char *pcData, size_t xLength);
+void vEmulatorTransportWait(void *pvContext, uint32_t ulTimeoutMs);
+
+// A serial device, e.g. the pty of tools/elm_pty or a USB ELM327, on
+// xHostClock
+typedef struct
+{
+    int iFd;
+    ElmLink_t *pxLink;
+} SerialTransport_t;
+
+bool bSerialTransportOpen(SerialTransport_t *pxSerial, const char *pcPath, ElmLink_t *pxLink);
+size_t xSerialTransportWrite(void *pvContext, const char *pcData, size_t xLength);
+void vSerialTransportWait(void *pvContext, uint32_t ulTimeoutMs);
+
+// NVS stand-in. Records live in RAM, and also in files under pcDirectory
+// when it is set, so a second run sees what the first stored
+#define KEY_VALUE_RECORDS 8
+#define KEY_VALUE_KEY_MAX 16
+#define KEY_VALUE_DATA_MAX 512
+
+typedef struct
+{
+    char cKey[KEY_VALUE_KEY_MAX];
+    uint8_t ucData[KEY_VALUE_DATA_MAX];
+    size_t xLength;
+} KeyValueRecord_t;
+
+typedef struct
+{
+    const char *pcDirectory;
+    KeyValueRecord_t xRecords[KEY_VALUE_RECORDS];
+    uint32_t ulWrites;
+} KeyValue_t;
+
+bool bKeyValueLoad(void *pvContext, const char *pcKey, void *pvData, size_t xLength);
+bool bKeyValueStore(void *pvContext, const char *pcKey, const void *pvData, size_t xLength);
+
+#endif
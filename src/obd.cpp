@@ -0,0 +1,232 @@
+#include "obd.h"
+#include "channels.h"
+#include "sensor_channel.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Sorted by PID. Formulas from SAE J1979. Decode: data bytes, scale numerator and
+// denominator, offset; then the plausible range and the units. A channel has
+// one source: coolant and oil come from the broadcast (src/vehicle.cpp), so
+// their PIDs publish to no channel
+typedef SensorChannel<LinearDecode<1, 100, 255, 0>, ValueRange<0, 100>, Percent> PercentA_t;
+typedef SensorChannel<LinearDecode<1, 100, 128, -100>, ValueRange<-100, 100>, Percent> FuelTrim_t;
+typedef SensorChannel<LinearDecode<1, 1, 1, 0>, ValueRange<0, 255>, Kilopascal> KilopascalA_t;
+
+static constexpr ObdPidDef_t xObdPids[] = {
+    PercentA_t::xDef(PID_ENGINE_LOAD, CHANNEL_NONE, "Load"),
+    SensorChannel<LinearDecode<1, 1, 1, -40>, ValueRange<-40, 150>, Celsius>::xDef(PID_COOLANT_TEMP, CHANNEL_NONE, "Coolant"),
+    FuelTrim_t::xDef(PID_SHORT_TERM_FUEL_TRIM, CHANNEL_NONE, "STFT"),
+    FuelTrim_t::xDef(PID_LONG_TERM_FUEL_TRIM, CHANNEL_NONE, "LTFT"),
+    SensorChannel<LinearDecode<1, 1, 1, 0>, ValueRange<10, 255>, Kilopascal>::xDef(PID_INTAKE_MANIFOLD_PRESSURE, CHANNEL_BOOST, "MAP"),
+    SensorChannel<LinearDecode<2, 1, 4, 0>, ValueRange<0, 12000>, Rpm>::xDef(PID_ENGINE_SPEED, CHANNEL_NONE, "RPM"),
+    SensorChannel<LinearDecode<1, 1, 1, 0>, ValueRange<0, 255>, KilometresPerHour>::xDef(PID_VEHICLE_SPEED, CHANNEL_NONE, "Speed"),
+    SensorChannel<LinearDecode<1, 1, 2, -64>, ValueRange<-64, 64>, Degrees>::xDef(PID_TIMING_ADVANCE, CHANNEL_TIMING, "Timing"),
+    SensorChannel<LinearDecode<1, 1, 1, -40>, ValueRange<-40, 150>, Celsius>::xDef(PID_INTAKE_AIR_TEMP, CHANNEL_IAT, "IAT"),
+    SensorChannel<LinearDecode<2, 1, 100, 0>, ValueRange<0, 656>, GramsPerSecond>::xDef(PID_MAF_RATE, CHANNEL_NONE, "MAF"),
+    PercentA_t::xDef(PID_THROTTLE_POSITION, CHANNEL_NONE, "Throttle"),
+    SensorChannel<LinearDecode<2, 1, 1, 0>, ValueRange<0, 65535>, Seconds>::xDef(PID_RUN_TIME, CHANNEL_NONE, "Run time"),
+    SensorChannel<LinearDecode<2, 79, 1000, 0>, ValueRange<0, 5178>, Kilopascal>::xDef(PID_FUEL_RAIL_PRESSURE, CHANNEL_NONE, "FRP"),
+    SensorChannel<LinearDecode<2, 10, 1, 0>, ValueRange<0, 40000>, Kilopascal>::xDef(PID_FUEL_RAIL_GAUGE_PRESSURE, CHANNEL_HPFP, "HPFP"),
+    PercentA_t::xDef(PID_FUEL_LEVEL, CHANNEL_NONE, "Fuel"),
+    SensorChannel<LinearDecode<1, 1, 1, 0>, ValueRange<50, 120>, Kilopascal>::xDef(PID_BAROMETRIC_PRESSURE, CHANNEL_NONE, "Baro"),
+    SensorChannel<LinearDecode<2, 1, 1000, 0>, ValueRange<0, 30>, Volts>::xDef(PID_MODULE_VOLTAGE, CHANNEL_NONE, "Voltage"),
+    SensorChannel<LinearDecode<2, 100, 255, 0>, ValueRange<0, 25700>, Percent>::xDef(PID_ABSOLUTE_LOAD, CHANNEL_NONE, "Abs load"),
+    SensorChannel<LinearDecode<2, 2, 65536, 0>, ValueRange<0, 2>, Ratio>::xDef(PID_COMMANDED_LAMBDA, CHANNEL_NONE, "Lambda"),
+    PercentA_t::xDef(PID_RELATIVE_THROTTLE, CHANNEL_NONE, "Rel thr"),
+    SensorChannel<LinearDecode<1, 1, 1, -40>, ValueRange<-40, 80>, Celsius>::xDef(PID_AMBIENT_AIR_TEMP, CHANNEL_NONE, "Ambient"),
+    PercentA_t::xDef(PID_ACCELERATOR_POSITION, CHANNEL_NONE, "Pedal"),
+    SensorChannel<LinearDecode<1, 1, 1, -40>, ValueRange<-40, 160>, Celsius>::xDef(PID_OIL_TEMP, CHANNEL_NONE, "Oil"),
+    SensorChannel<LinearDecode<2, 1, 20, 0>, ValueRange<0, 3277>, LitresPerHour>::xDef(PID_FUEL_RATE, CHANNEL_NONE, "Fuel rate"),
+};
+
+#define OBD_PID_COUNT (sizeof(xObdPids) / sizeof(xObdPids[0]))
+
+static constexpr bool bSortedByPid(const ObdPidDef_t *pxDefs, size_t xCount)
+{
+    return (xCount < 2) || ((pxDefs[0].ucPid < pxDefs[1].ucPid) && bSortedByPid(pxDefs + 1, xCount - 1));
+}
+
+static_assert(bSortedByPid(xObdPids, OBD_PID_COUNT), "xObdPids must be sorted by PID");
+
+// Binary search, every decoded PID goes through here
+const ObdPidDef_t *pxObdFindPid(uint8_t ucPid)
+{
+    uint8_t ucLow = 0;
+    uint8_t ucHigh = OBD_PID_COUNT;
+
+    while (ucLow < ucHigh)
+    {
+        uint8_t ucMiddle = (ucLow + ucHigh) / 2;
+
+        if (xObdPids[ucMiddle].ucPid == ucPid)
+            return &xObdPids[ucMiddle];
+
+        if (xObdPids[ucMiddle].ucPid < ucPid)
+            ucLow = ucMiddle + 1;
+        else
+            ucHigh = ucMiddle;
+    }
+
+    return NULL;
+}
+
+// For walking the whole table, e.g. to poll every PID the car answers
+const ObdPidDef_t *pxObdPidAt(uint8_t ucIndex)
+{
+    return (ucIndex < OBD_PID_COUNT) ? &xObdPids[ucIndex] : NULL;
+}
+
+uint8_t ucObdPidCount(void)
+{
+    return OBD_PID_COUNT;
+}
+
+size_t xObdBuildMultiPidRequest(char *pcRequest, size_t xSize, const uint8_t *pucPids, uint8_t ucCount)
+{
+    if ((ucCount == 0) || (ucCount > OBD_MULTI_PID_MAX) || (xSize < (size_t)(3 + (2 * ucCount))))
+        return 0;
+
+    size_t xLength = sprintf(pcRequest, "01");
+
+    for (register uint8_t i = 0; i < ucCount; i++)
+        xLength += sprintf(pcRequest + xLength, "%02X", pucPids[i]);
+
+    return xLength;
+}
+
+// CAN frames in the answer, for the ELM327's response count suffix: one
+// frame carries up to 7 payload bytes, a first frame 6 and each following
+// one 7. 0 if a PID's length is unknown
+uint8_t ucObdExpectedFrames(const uint8_t *pucPids, uint8_t ucCount)
+{
+    uint8_t ucPayload = 1; // 0x41
+
+    for (register uint8_t i = 0; i < ucCount; i++)
+    {
+        const ObdPidDef_t *pxDef = pxObdFindPid(pucPids[i]);
+
+        if (pxDef == NULL)
+            return 0;
+
+        ucPayload += 1 + pxDef->ucDataLength;
+    }
+
+    if (ucPayload <= 7)
+        return 1;
+
+    // ISO-TP: a first frame with 6 bytes, then consecutive frames of 7
+    uint8_t ucRest = ucPayload - 6;
+
+    return 1 + (ucRest + 6) / 7; // Rounded up
+}
+
+void vObdResponseStart(ObdResponse_t *pxResponse, const char *pcRequest, bool bHeaders)
+{
+    vIsoTpStart(&pxResponse->xMessage);
+    pxResponse->pcRequest = pcRequest;
+    pxResponse->bHeaders = bHeaders;
+}
+
+void vObdResponseFeedLine(ObdResponse_t *pxResponse, const char *pcLine, size_t xLength)
+{
+    // The echoed request is valid hex too
+    if ((pxResponse->pcRequest != NULL) && (xLength == strlen(pxResponse->pcRequest)) && (memcmp(pcLine, pxResponse->pcRequest, xLength) == 0))
+        return;
+
+    xIsoTpFeedLine(&pxResponse->xMessage, pcLine, xLength, pxResponse->bHeaders);
+}
+
+// Returns how many of the requested PIDs were in the answer, in range or not
+uint8_t ucObdResponseDecode(const ObdResponse_t *pxResponse, ObdPidValue_t *pxValues, uint8_t ucCount)
+{
+    const IsoTpMessage_t *pxMessage = &pxResponse->xMessage;
+    const uint8_t *pucBytes = pxMessage->ucPayload;
+    uint8_t ucByteCount = ucIsoTpPayloadLength(pxMessage);
+    uint8_t ucParsed = 0;
+
+    for (register uint8_t i = 0; i < ucCount; i++)
+    {
+        pxValues[i].bPresent = false;
+        pxValues[i].bValid = false;
+    }
+
+    if (!bIsoTpComplete(pxMessage) || (ucByteCount < 2) || (pucBytes[0] != 0x41))
+        return 0;
+
+    // Walk PID/data pairs; anything after the last requested PID is CAN padding
+    uint8_t k = 1;
+
+    while (k < ucByteCount)
+    {
+        uint8_t ucPid = pucBytes[k++];
+        const ObdPidDef_t *pxDef = pxObdFindPid(ucPid);
+        ObdPidValue_t *pxValue = NULL;
+
+        for (register uint8_t i = 0; i < ucCount; i++)
+        {
+            if ((pxValues[i].ucPid == ucPid) && !pxValues[i].bPresent)
+            {
+                pxValue = &pxValues[i];
+                break;
+            }
+        }
+
+        if ((pxValue == NULL) || (pxDef == NULL) || (k + pxDef->ucDataLength > ucByteCount))
+            break;
+
+        pxValue->bPresent = true;
+        pxValue->bValid = pxDef->pxDecode(&pucBytes[k], &pxValue->fValue);
+        ucParsed++;
+        k += pxDef->ucDataLength;
+    }
+
+    return ucParsed;
+}
+
+// The answer to 01 00, 01 20, ...: four bytes, the MSB of the first for
+// PID ucBase + 1. Sets the supported PIDs' bits of the OBD_SUPPORT_BYTES bitmap
+bool bObdResponseSupport(const ObdResponse_t *pxResponse, uint8_t ucBase, uint8_t *pucSupported)
+{
+    const IsoTpMessage_t *pxMessage = &pxResponse->xMessage;
+    const uint8_t *pucBytes = pxMessage->ucPayload;
+
+    if (!bIsoTpComplete(pxMessage) || (ucIsoTpPayloadLength(pxMessage) < 6) || (pucBytes[0] != 0x41) || (pucBytes[1] != ucBase))
+        return false;
+
+    for (register uint8_t i = 0; i < 32; i++)
+    {
+        uint16_t ui16Pid = ucBase + 1 + i; // The last bit of 01 E0 would be PID 0x100
+
+        if ((ui16Pid <= 0xFF) && (pucBytes[2 + (i / 8)] & (0x80 >> (i % 8))))
+            pucSupported[ui16Pid / 8] |= 1 << (ui16Pid % 8);
+    }
+
+    return true;
+}
+
+bool bObdPidSupported(const uint8_t *pucSupported, uint8_t ucPid)
+{
+    return (pucSupported[ucPid / 8] & (1 << (ucPid % 8))) != 0;
+}
+
+uint8_t ucObdParseMultiPidResponse(const char *pcResponse, const char *pcRequest, bool bHeaders, ObdPidValue_t *pxValues, uint8_t ucCount)
+{
+    ObdResponse_t xResponse;
+    const char *pcLine = pcResponse;
+
+    vObdResponseStart(&xResponse, pcRequest, bHeaders);
+
+    while (*pcLine != '\0')
+    {
+        size_t xLength = strcspn(pcLine, "\r\n>");
+
+        vObdResponseFeedLine(&xResponse, pcLine, xLength);
+
+        pcLine += xLength;
+        if (*pcLine != '\0')
+            pcLine++;
+    }
+
+    return ucObdResponseDecode(&xResponse, pxValues, ucCount);
+}
@@ -0,0 +1,59 @@
+#include "playback.h"
+
+bool bPlaybackOpen(Playback_t *pxPlayback, const HalStorage_t *pxStorage, uint16_t ui16SpeedPercent, uint32_t ulNowMs)
+{
+    pxPlayback->ui16SpeedPercent = ui16SpeedPercent;
+    pxPlayback->ulStartMs = ulNowMs;
+    pxPlayback->ulSamples = 0;
+    pxPlayback->ulSteps = 0;
+
+    if (!bLogReaderOpen(&pxPlayback->xReader, pxStorage))
+        return false;
+
+    pxPlayback->bHasNext = bLogReaderNext(&pxPlayback->xReader, &pxPlayback->xNext);
+    pxPlayback->ulLogStartMs = pxPlayback->xNext.ulTimestampMs;
+
+    return pxPlayback->bHasNext;
+}
+
+// Log time the playback has reached at ulNowMs
+static uint32_t ulLogNow(const Playback_t *pxPlayback, uint32_t ulNowMs)
+{
+    return pxPlayback->ulLogStartMs + (uint32_t)(((uint64_t)(ulNowMs - pxPlayback->ulStartMs) * pxPlayback->ui16SpeedPercent) / 100);
+}
+
+// Publishes every sample that is due, or when unthrottled the samples that
+// share the next timestamp, so the caller can render in between. Returns 0
+// after publishing, PLAYBACK_END after the last sample, otherwise the time
+// until the next one is due
+uint32_t ulPlaybackStep(Playback_t *pxPlayback, BroadcastPublish_t xPublish, uint32_t ulNowMs)
+{
+    if (!pxPlayback->bHasNext)
+        return PLAYBACK_END;
+
+    uint32_t ulDueMs = pxPlayback->xNext.ulTimestampMs;
+
+    if (pxPlayback->ui16SpeedPercent != PLAYBACK_UNTHROTTLED)
+    {
+        uint32_t ulAheadMs = ulDueMs - ulLogNow(pxPlayback, ulNowMs);
+
+        if ((int32_t)ulAheadMs > 0)
+            return (uint32_t)(((uint64_t)ulAheadMs * 100) / pxPlayback->ui16SpeedPercent) + 1;
+
+        ulDueMs = ulLogNow(pxPlayback, ulNowMs);
+    }
+
+    while (pxPlayback->bHasNext && ((int32_t)(pxPlayback->xNext.ulTimestampMs - ulDueMs) <= 0))
+    {
+        if (pxPlayback->xNext.ucChannel < CHANNEL_COUNT) // Logged by a build with more channels
+        {
+            xPublish(pxPlayback->xNext.ucChannel, pxPlayback->xNext.fValue);
+            pxPlayback->ulSamples++;
+        }
+        pxPlayback->bHasNext = bLogReaderNext(&pxPlayback->xReader, &pxPlayback->xNext);
+    }
+
+    pxPlayback->ulSteps++;
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "report.h"
+
+#include <stdio.h>
+
+// Rates since the last vSchedulerResetWindow, link and render counters
+void vReportPrint(const Acquisition_t *pxAcquisition, const DisplayStats_t *pxDisplayStats, const Telemetry_t *pxTelemetry, uint32_t ulNow)
+{
+    const Scheduler_t *pxScheduler = &pxAcquisition->xScheduler;
+    const ElmLink_t *pxLink = pxAcquisition->pxLink;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+    {
+        const PidSchedule_t *pxJob = &pxScheduler->pxJobs[i];
+        uint32_t ulAchieved = ulSchedulerAchievedRate(pxScheduler, pxJob, ulNow);
+        uint32_t ulRequested = ulSchedulerRequestedRate(pxJob);
+
+        printf("Sched %-8s %2u.%02u Hz of %2u.%02u Hz, %u failed, %u late%s\n", pxJob->pcName,
+               (unsigned)(ulAchieved / 1000), (unsigned)((ulAchieved % 1000) / 10),
+               (unsigned)(ulRequested / 1000), (unsigned)((ulRequested % 1000) / 10),
+               (unsigned)pxJob->ulFailures, (unsigned)pxJob->ulMissedDeadlines,
+               pxJob->bQuarantined ? ", quarantined" : "");
+    }
+
+    const ElmRecovery_t *pxRecovery = &pxAcquisition->xRecovery;
+
+    printf("Recovery");
+    for (register uint8_t i = 0; i < ELM_RECOVERY_TIER_COUNT; i++)
+        printf(" %s %u (%u ms)", pcElmRecoveryTierName(i), (unsigned)pxRecovery->ulCount[i], (unsigned)(pxRecovery->ulLinkUs[i] / 1000));
+    printf(", %u reset timeouts\n", (unsigned)pxRecovery->ulResetTimeouts);
+
+    printf("Framer %u lines, %u wrapped, %u truncated, %u bytes dropped\n",
+           (unsigned)pxLink->xFramer.ulLines, (unsigned)pxLink->xFramer.ulWrappedLines,
+           (unsigned)pxLink->xFramer.ulTruncatedLines, (unsigned)pxLink->xRing.ulDropped);
+
+    uint32_t ulWindow = ulNow - pxScheduler->ulWindowStart;
+    printf("Display %u B/s, %u glyphs drawn, %u unchanged glyphs and %u unchanged fields skipped\n",
+           ulWindow > 0 ? (unsigned)(((uint64_t)pxDisplayStats->ulBytesPushed * 1000) / ulWindow) : 0,
+           (unsigned)pxDisplayStats->ulGlyphsDrawn, (unsigned)pxDisplayStats->ulGlyphsSkipped,
+           (unsigned)pxDisplayStats->ulFieldsSkipped);
+    printf("Render time histogram (us):");
+    for (register uint8_t i = 0; i < RENDER_HISTOGRAM_BUCKETS - 1; i++)
+        printf(" <%u:%u", (unsigned)(RENDER_HISTOGRAM_FIRST_US << i), (unsigned)pxDisplayStats->ulRenderHistogram[i]);
+    printf(" more:%u", (unsigned)pxDisplayStats->ulRenderHistogram[RENDER_HISTOGRAM_BUCKETS - 1]);
+    printf(", glyph cache %u hits %u misses\n", (unsigned)pxDisplayStats->ulCacheHits, (unsigned)pxDisplayStats->ulCacheMisses);
+    printf("Telemetry generation %u, %u reader retries\n", (unsigned)ulTelemetryGeneration(pxTelemetry), (unsigned)pxTelemetry->ulRetries);
+}
+
+static void vPrintMillis(uint32_t ulMicros)
+{
+    printf("%u.%u", (unsigned)(ulMicros / 1000), (unsigned)((ulMicros % 1000) / 100));
+}
+
+// p50 and p99 as bucket bounds, then the worst case, in ms
+static void vPrintStage(const char *pcLabel, const MetricsChannel_t *pxChannel, MetricsStage_t xStage)
+{
+    printf(" %s <=", pcLabel);
+    vPrintMillis(ulMetricsPercentileUs(pxChannel, xStage, 500));
+    printf(" <=");
+    vPrintMillis(ulMetricsPercentileUs(pxChannel, xStage, 990));
+    printf(" ");
+    vPrintMillis(pxChannel->ulWorstUs[xStage]);
+}
+
+// Rates for the current window, latencies since the last clear
+void vReportPrintMetrics(const Metrics_t *pxMetrics, uint32_t ulNow)
+{
+    uint32_t ulWindow = ulNow - pxMetrics->ulWindowStartMs;
+
+    printf("Latency ms: p50 p99 max\n");
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        const MetricsChannel_t *pxChannel = &pxMetrics->xChannels[i];
+        uint32_t ulPublished = ulWindow > 0 ? (uint32_t)(((uint64_t)pxChannel->ulPublished * 100000) / ulWindow) : 0;
+        uint32_t ulDrawn = ulWindow > 0 ? (uint32_t)(((uint64_t)pxChannel->ulDrawn * 100000) / ulWindow) : 0;
+
+        printf("%-8s %2u.%02u Hz in %2u.%02u Hz out", pcChannelName(i),
+               (unsigned)(ulPublished / 100), (unsigned)(ulPublished % 100), (unsigned)(ulDrawn / 100), (unsigned)(ulDrawn % 100));
+        vPrintStage("resp", pxChannel, METRICS_STAGE_RESPONSE);
+        vPrintStage("pub", pxChannel, METRICS_STAGE_PUBLISH);
+        vPrintStage("draw", pxChannel, METRICS_STAGE_RENDER);
+        vPrintStage("glass", pxChannel, METRICS_STAGE_GLASS);
+        printf("\n");
+    }
+
+    printf("ELM errors:");
+    for (register uint8_t i = 1; i < METRICS_STATUS_COUNT; i++)
+    {
+        if (pxMetrics->ulErrors[i] > 0)
+            printf(" %s %u", pcElmStatusName(i), (unsigned)pxMetrics->ulErrors[i]);
+    }
+    printf("\n");
+}
+
+// The derived values as the display and logger see them
+void vReportPrintStats(const TelemetrySnapshot_t *pxSnapshot)
+{
+    printf("Stats        min      max  average     peak  above s\n");
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        const TelemetryChannel_t *pxChannel = &pxSnapshot->xChannels[i];
+        const ChannelSummary_t *pxStats = &pxChannel->xStats;
+
+        if (!pxChannel->bValid)
+            continue;
+
+        printf("%-8s %8.1f %8.1f %8.1f %8.1f %8u\n", pcChannelName(i), pxStats->fMin, pxStats->fMax, pxStats->fAverage,
+               pxStats->fPeak, (unsigned)(pxStats->ulAboveMs / 1000));
+    }
+}
+
+// Start and duration of each stage in ms; stages may overlap
+void vReportPrintBoot(const BootProfile_t *pxProfile)
+{
+    printf("Boot stage      start  took\n");
+    uint8_t ucCount = (pxProfile->ucCount < BOOT_STAGE_MAX) ? pxProfile->ucCount : BOOT_STAGE_MAX;
+
+    for (register uint8_t i = 0; i < ucCount; i++)
+    {
+        const BootStage_t *pxStage = &pxProfile->xStages[i];
+
+        if (__atomic_load_n(&pxStage->pcName, __ATOMIC_ACQUIRE) == NULL)
+            continue;
+
+        printf("%-14s %6u ", pxStage->pcName, (unsigned)(pxStage->ulStartUs / 1000));
+        if (pxStage->ulEndUs != 0)
+            printf("%5u\n", (unsigned)((pxStage->ulEndUs - pxStage->ulStartUs) / 1000));
+        else
+            printf("  ...\n");
+    }
+
+    if (pxProfile->ulFirstReadingUs != 0)
+        printf("First boost reading at %u ms\n", (unsigned)(pxProfile->ulFirstReadingUs / 1000));
+    else
+        printf("No boost reading yet\n");
+}
+
+void vReportPrintCalibration(const ElmCalibrationResult_t *pxResult)
+{
+    printf("ELM profile        mean  worst failed\n");
+    for (register uint8_t i = 0; i < pxResult->ucCount; i++)
+    {
+        const ElmCalibration_t *pxCandidate = &pxResult->xCandidates[i];
+        const ElmProfile_t *pxProfile = &pxCandidate->xProfile;
+
+        printf("AT%u ST %02X %-5s ", pxProfile->ucAdaptiveTiming, pxProfile->ucTimeout, pxProfile->bResponseCount ? "count" : "");
+        vPrintMillis(pxCandidate->ulMeanUs);
+        printf(" ");
+        vPrintMillis(pxCandidate->ulWorstUs);
+        printf(" %u%s\n", (unsigned)pxCandidate->ucFailures, (i == pxResult->i8Chosen) ? "  kept" : "");
+    }
+
+    if (pxResult->i8Chosen < 0)
+        printf("No stable profile, kept the previous one\n");
+}
@@ -0,0 +1,220 @@
+#include "scheduler.h"
+
+#include <stddef.h>
+
+// Wrap-safe "a is before b" for millisecond timestamps
+static bool bBefore(uint32_t ulA, uint32_t ulB)
+{
+    return (int32_t)(ulA - ulB) < 0;
+}
+
+static bool bEarlier(const PidSchedule_t *pxA, const PidSchedule_t *pxB)
+{
+    if (pxA->ulDeadline != pxB->ulDeadline)
+        return bBefore(pxA->ulDeadline, pxB->ulDeadline);
+
+    return pxA->ucPriority > pxB->ucPriority;
+}
+
+void vSchedulerInit(Scheduler_t *pxScheduler, PidSchedule_t *pxJobs, uint8_t ucJobCount, uint8_t ucBatchMax, uint32_t ulNow)
+{
+    pxScheduler->pxJobs = pxJobs;
+    pxScheduler->ucJobCount = ucJobCount;
+    pxScheduler->ucBatchMax = ucBatchMax;
+    pxScheduler->bSupportKnown = false;
+
+    for (register uint8_t i = 0; i < ucJobCount; i++)
+    {
+        pxJobs[i].ulRelease = ulNow;
+        pxJobs[i].ulDeadline = ulNow + pxJobs[i].ui16StaleMs;
+        pxJobs[i].ulFailures = 0;
+        pxJobs[i].ulMissedDeadlines = 0;
+        pxJobs[i].ucUnanswered = 0;
+        pxJobs[i].bAnswered = false;
+        pxJobs[i].bQuarantined = false;
+    }
+
+    vSchedulerResetWindow(pxScheduler, ulNow);
+}
+
+int8_t cSchedulerNext(const Scheduler_t *pxScheduler, uint32_t ulNow)
+{
+    int8_t cNext = SCHED_NO_JOB;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+    {
+        const PidSchedule_t *pxJob = &pxScheduler->pxJobs[i];
+
+        if (bBefore(ulNow, pxJob->ulRelease))
+            continue;
+
+        if ((cNext == SCHED_NO_JOB) || bEarlier(pxJob, &pxScheduler->pxJobs[cNext]))
+            cNext = i;
+    }
+
+    return cNext;
+}
+
+uint32_t ulSchedulerIdleMs(const Scheduler_t *pxScheduler, uint32_t ulNow)
+{
+    uint32_t ulIdle = UINT32_MAX;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+    {
+        uint32_t ulRelease = pxScheduler->pxJobs[i].ulRelease;
+
+        if (!bBefore(ulNow, ulRelease))
+            return 0;
+
+        if (ulRelease - ulNow < ulIdle)
+            ulIdle = ulRelease - ulNow;
+    }
+
+    return ulIdle;
+}
+
+// Adds the head job plus every other Mode 01 job that is released or within
+// half a period of its release, earliest deadline first, so they share one
+// request instead of each paying a round trip shortly after
+uint8_t ucSchedulerCollectBatch(const Scheduler_t *pxScheduler, int8_t cHead, uint32_t ulNow, int8_t *pcBatch)
+{
+    const PidSchedule_t *pxJobs = pxScheduler->pxJobs;
+    uint8_t ucCount = 0;
+
+    pcBatch[ucCount++] = cHead;
+
+    if (pxJobs[cHead].ucPid == SCHED_NON_OBD)
+        return ucCount;
+
+    while (ucCount < pxScheduler->ucBatchMax)
+    {
+        int8_t cBest = SCHED_NO_JOB;
+
+        for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+        {
+            bool bTaken = false;
+
+            for (register uint8_t k = 0; k < ucCount; k++)
+                bTaken |= (pcBatch[k] == i);
+
+            if (bTaken || (pxJobs[i].ucPid == SCHED_NON_OBD))
+                continue;
+
+            if (bBefore(ulNow + (pxJobs[i].ui16PeriodMs / 2), pxJobs[i].ulRelease))
+                continue;
+
+            if ((cBest == SCHED_NO_JOB) || bEarlier(&pxJobs[i], &pxJobs[cBest]))
+                cBest = i;
+        }
+
+        if (cBest == SCHED_NO_JOB)
+            break;
+
+        pcBatch[ucCount++] = cBest;
+    }
+
+    return ucCount;
+}
+
+// A PID the ECU left out of its answer is retried at its next release
+// first, then at twice, four times... its period up to SCHED_BACKOFF_MAX_MS.
+// Unless the supported PIDs are known, one that never answered is set aside
+// after SCHED_QUARANTINE_FAILURES misses, so an unsupported PID stops
+// costing a request every period
+static void vBackOff(Scheduler_t *pxScheduler, PidSchedule_t *pxJob, uint32_t ulNow)
+{
+    if (pxJob->ucUnanswered < UINT8_MAX)
+        pxJob->ucUnanswered++;
+
+    if (!pxScheduler->bSupportKnown && !pxJob->bAnswered && (pxJob->ucUnanswered >= SCHED_QUARANTINE_FAILURES))
+    {
+        pxJob->bQuarantined = true;
+        pxJob->ulRelease = ulNow + SCHED_QUARANTINE_RETRY_MS;
+        return;
+    }
+
+    uint32_t ulBackoff = pxJob->ui16PeriodMs;
+
+    for (register uint8_t i = 1; (i < pxJob->ucUnanswered) && (ulBackoff < SCHED_BACKOFF_MAX_MS); i++)
+        ulBackoff <<= 1;
+
+    if (ulBackoff > SCHED_BACKOFF_MAX_MS)
+        ulBackoff = SCHED_BACKOFF_MAX_MS;
+
+    pxJob->ulRelease = ulNow + ulBackoff;
+}
+
+void vSchedulerComplete(Scheduler_t *pxScheduler, int8_t cJob, SchedResult_t xResult, uint32_t ulNow)
+{
+    PidSchedule_t *pxJob = &pxScheduler->pxJobs[cJob];
+
+    if (bBefore(pxJob->ulDeadline, ulNow) && !pxJob->bQuarantined)
+        pxJob->ulMissedDeadlines++;
+
+    // Keep the phase while on time so rates do not drift, restart it when late
+    pxJob->ulRelease += pxJob->ui16PeriodMs;
+    if (bBefore(pxJob->ulRelease, ulNow))
+        pxJob->ulRelease = ulNow + pxJob->ui16PeriodMs;
+
+    if (xResult == SCHED_RESULT_OK)
+    {
+        pxJob->ulSamples++;
+        pxJob->ulDeadline = ulNow + pxJob->ui16StaleMs;
+        pxJob->ucUnanswered = 0;
+        pxJob->bAnswered = true;
+        pxJob->bQuarantined = false;
+        return;
+    }
+
+    pxJob->ulFailures++;
+
+    // Set aside until it answers
+    if (pxJob->bQuarantined)
+        pxJob->ulRelease = ulNow + SCHED_QUARANTINE_RETRY_MS;
+    else if (xResult == SCHED_RESULT_NO_ANSWER)
+        vBackOff(pxScheduler, pxJob, ulNow);
+}
+
+// A PID the ECU does not list as supported is only asked every
+// SCHED_QUARANTINE_RETRY_MS, in case the list was wrong
+void vSchedulerSetAside(Scheduler_t *pxScheduler, int8_t cJob, uint32_t ulNow)
+{
+    PidSchedule_t *pxJob = &pxScheduler->pxJobs[cJob];
+
+    pxJob->bQuarantined = true;
+    pxJob->ulRelease = ulNow + SCHED_QUARANTINE_RETRY_MS;
+}
+
+uint8_t ucSchedulerQuarantined(const Scheduler_t *pxScheduler)
+{
+    uint8_t ucCount = 0;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+        ucCount += pxScheduler->pxJobs[i].bQuarantined;
+
+    return ucCount;
+}
+
+// Rates are in milli-hertz to stay in integer math
+uint32_t ulSchedulerRequestedRate(const PidSchedule_t *pxJob)
+{
+    return 1000000UL / pxJob->ui16PeriodMs;
+}
+
+uint32_t ulSchedulerAchievedRate(const Scheduler_t *pxScheduler, const PidSchedule_t *pxJob, uint32_t ulNow)
+{
+    uint32_t ulWindow = ulNow - pxScheduler->ulWindowStart;
+
+    if (ulWindow == 0)
+        return 0;
+
+    return (uint32_t)(((uint64_t)pxJob->ulSamples * 1000000ULL) / ulWindow);
+}
+
+void vSchedulerResetWindow(Scheduler_t *pxScheduler, uint32_t ulNow)
+{
+    pxScheduler->ulWindowStart = ulNow;
+
+    for (register uint8_t i = 0; i < pxScheduler->ucJobCount; i++)
+        pxScheduler->pxJobs[i].ulSamples = 0;
+}
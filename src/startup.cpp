@@ -0,0 +1,66 @@
+#include "startup.h"
+
+void vStartupInit(Startup_t *pxStartup, const StartupStage_t *pxStages, uint8_t ucCount, BootProfile_t *pxProfile)
+{
+    pxStartup->pxStages = pxStages;
+    pxStartup->ucCount = (ucCount < STARTUP_STAGE_MAX) ? ucCount : STARTUP_STAGE_MAX;
+    pxStartup->ulClaimed = 0;
+    pxStartup->ulDone = 0;
+    pxStartup->pxProfile = pxProfile;
+}
+
+static bool bRunsOn(const StartupStage_t *pxStage, uint8_t ucCore)
+{
+    return (pxStage->ucCore == STARTUP_ANY_CORE) || (ucCore == STARTUP_ANY_CORE) || (pxStage->ucCore == ucCore);
+}
+
+// The first stage in table order that this worker may run and whose
+// dependencies are done, or -1 if it has to wait for another worker
+int8_t i8StartupClaim(Startup_t *pxStartup, uint8_t ucCore)
+{
+    uint32_t ulDone = ulStartupDone(pxStartup);
+
+    for (register uint8_t i = 0; i < pxStartup->ucCount; i++)
+    {
+        const StartupStage_t *pxStage = &pxStartup->pxStages[i];
+        uint32_t ulBit = STARTUP_BIT(i);
+
+        if (!bRunsOn(pxStage, ucCore) || ((pxStage->ulDependsOn & ulDone) != pxStage->ulDependsOn))
+            continue;
+
+        if (!(__atomic_fetch_or(&pxStartup->ulClaimed, ulBit, __ATOMIC_ACQ_REL) & ulBit))
+            return i;
+    }
+
+    return -1;
+}
+
+void vStartupRun(Startup_t *pxStartup, int8_t i8Stage)
+{
+    const StartupStage_t *pxStage = &pxStartup->pxStages[i8Stage];
+    int8_t i8Profile = i8BootProfileBegin(pxStartup->pxProfile, pxStage->pcName);
+
+    pxStage->vRun();
+
+    vBootProfileEnd(pxStartup->pxProfile, i8Profile);
+    __atomic_fetch_or(&pxStartup->ulDone, STARTUP_BIT(i8Stage), __ATOMIC_RELEASE);
+}
+
+// Every stage this worker may run has been claimed
+bool bStartupFinished(const Startup_t *pxStartup, uint8_t ucCore)
+{
+    uint32_t ulClaimed = __atomic_load_n(&pxStartup->ulClaimed, __ATOMIC_ACQUIRE);
+
+    for (register uint8_t i = 0; i < pxStartup->ucCount; i++)
+    {
+        if (bRunsOn(&pxStartup->pxStages[i], ucCore) && !(ulClaimed & STARTUP_BIT(i)))
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t ulStartupDone(const Startup_t *pxStartup)
+{
+    return __atomic_load_n(&pxStartup->ulDone, __ATOMIC_ACQUIRE);
+}
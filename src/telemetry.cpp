@@ -0,0 +1,143 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+static void vWriteBegin(Telemetry_t *pxTelemetry)
+{
+    uint32_t ulSequence = __atomic_load_n(&pxTelemetry->ulSequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&pxTelemetry->ulSequence, ulSequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void vWriteEnd(Telemetry_t *pxTelemetry)
+{
+    uint32_t ulSequence = __atomic_load_n(&pxTelemetry->ulSequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&pxTelemetry->ulSequence, ulSequence + 1, __ATOMIC_RELEASE);
+}
+
+// pxStatsConfig has one entry per channel
+void vTelemetryInit(Telemetry_t *pxTelemetry, const ChannelStatsConfig_t *pxStatsConfig)
+{
+    pxTelemetry->ulSequence = 0;
+    pxTelemetry->ulResetMask = 0;
+    pxTelemetry->ulRetries = 0;
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        pxTelemetry->xChannels[i].fValue = 0;
+        pxTelemetry->xChannels[i].fMax = TELEMETRY_NO_MAX;
+        pxTelemetry->xChannels[i].ulTimestampMs = 0;
+        pxTelemetry->xChannels[i].bValid = false;
+        memset(&pxTelemetry->xChannels[i].xStats, 0, sizeof(ChannelSummary_t));
+        vChannelStatsInit(&pxTelemetry->xStats[i], &pxStatsConfig[i]);
+    }
+}
+
+// Writer side. Returns true when the value or the max changed, i.e. when the
+// channel needs to be redrawn
+bool bTelemetryPublish(Telemetry_t *pxTelemetry, uint8_t ucChannel, float fValue, uint32_t ulNowMs)
+{
+    if (ucChannel >= CHANNEL_COUNT)
+        return false;
+
+    TelemetryChannel_t *pxChannel = &pxTelemetry->xChannels[ucChannel];
+    bool bChanged = !pxChannel->bValid || (pxChannel->fValue != fValue);
+    ChannelSummary_t xSummary;
+
+    // Outside the write, the history is only the writer's
+    vChannelStatsAdd(&pxTelemetry->xStats[ucChannel], fValue, ulNowMs, &xSummary);
+
+    vWriteBegin(pxTelemetry);
+
+    pxChannel->fValue = fValue;
+    pxChannel->xStats = xSummary;
+    pxChannel->ulTimestampMs = ulNowMs;
+    pxChannel->bValid = true;
+
+    if (fValue > pxChannel->fMax)
+    {
+        pxChannel->fMax = fValue;
+        bChanged = true;
+    }
+
+    vWriteEnd(pxTelemetry);
+
+    return bChanged;
+}
+
+// Any task. The max values are cleared by the writer on its next pass
+void vTelemetryRequestReset(Telemetry_t *pxTelemetry, uint32_t ulChannelMask)
+{
+    __atomic_fetch_or(&pxTelemetry->ulResetMask, ulChannelMask, __ATOMIC_RELEASE);
+}
+
+// Writer side. Returns the mask of channels whose max was cleared. Their
+// statistics start over too; the summary readers have stays until the next
+// sample
+uint32_t ulTelemetryApplyResets(Telemetry_t *pxTelemetry)
+{
+    uint32_t ulMask = __atomic_exchange_n(&pxTelemetry->ulResetMask, 0, __ATOMIC_ACQUIRE);
+
+    if (ulMask == 0)
+        return 0;
+
+    vWriteBegin(pxTelemetry);
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (ulMask & (1UL << i))
+        {
+            pxTelemetry->xChannels[i].fMax = TELEMETRY_NO_MAX;
+            vChannelStatsReset(&pxTelemetry->xStats[i]);
+        }
+    }
+
+    vWriteEnd(pxTelemetry);
+
+    return ulMask;
+}
+
+// Writer side, e.g. with the max values kept from the last drive
+void vTelemetryRestoreMax(Telemetry_t *pxTelemetry, uint8_t ucChannel, float fMax)
+{
+    if (ucChannel >= CHANNEL_COUNT)
+        return;
+
+    vWriteBegin(pxTelemetry);
+    pxTelemetry->xChannels[ucChannel].fMax = fMax;
+    vWriteEnd(pxTelemetry);
+}
+
+// Reader side. Never blocks the writer; copies again if a write overlapped
+void vTelemetryRead(Telemetry_t *pxTelemetry, TelemetrySnapshot_t *pxSnapshot)
+{
+    uint32_t ulBefore;
+    uint32_t ulAfter;
+
+    for (;;)
+    {
+        ulBefore = __atomic_load_n(&pxTelemetry->ulSequence, __ATOMIC_ACQUIRE);
+
+        if ((ulBefore & 1) == 0)
+        {
+            memcpy(pxSnapshot->xChannels, pxTelemetry->xChannels, sizeof(pxSnapshot->xChannels));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            ulAfter = __atomic_load_n(&pxTelemetry->ulSequence, __ATOMIC_RELAXED);
+
+            if (ulAfter == ulBefore)
+                break;
+        }
+
+        __atomic_fetch_add(&pxTelemetry->ulRetries, 1, __ATOMIC_RELAXED);
+    }
+
+    pxSnapshot->ulGeneration = ulBefore >> 1;
+}
+
+// Increases by one with every completed write
+uint32_t ulTelemetryGeneration(const Telemetry_t *pxTelemetry)
+{
+    return __atomic_load_n(&pxTelemetry->ulSequence, __ATOMIC_ACQUIRE) >> 1;
+}
@@ -0,0 +1,45 @@
+#include "vehicle.h"
+
+#include "obd.h"
+#include "channels.h"
+
+PidSchedule_t xVehicleJobs[] = {
+    // Name, PID, period ms, priority, stale ms
+    SCHED_JOB("Boost", PID_INTAKE_MANIFOLD_PRESSURE, 100, 4, 300),
+    SCHED_JOB("Timing", PID_TIMING_ADVANCE, 100, 3, 300),
+    SCHED_JOB("HPFP", PID_FUEL_RAIL_GAUGE_PRESSURE, 100, 3, 300),
+    SCHED_JOB("IAT", PID_INTAKE_AIR_TEMP, 1000, 2, 5000),
+    SCHED_JOB("Oil/ECT", SCHED_NON_OBD, 1000, 2, 3000),
+};
+const uint8_t ucVehicleJobCount = sizeof(xVehicleJobs) / sizeof(xVehicleJobs[0]);
+
+const BroadcastSignal_t xVehicleBroadcastSignals[] = {
+    // CAN ID, {channel, byte offset, length, signed, scale, offset}
+    {0x488, {CHANNEL_COOLANT, 0, 1, false, 1.0f, -40.0f}},
+    {0x488, {CHANNEL_OIL, 5, 1, false, 1.0f, -40.0f}},
+};
+const uint8_t ucVehicleBroadcastSignalCount = sizeof(xVehicleBroadcastSignals) / sizeof(xVehicleBroadcastSignals[0]);
+
+// Indexed by Channel_t. The thresholds are where the gauges turn orange
+const ChannelStatsConfig_t xVehicleChannelStats[CHANNEL_COUNT] = {
+    // Window ms, average ms, hold ms, decay per s, threshold
+    {3000, 1000, 2000, 20.0f, 240.0f},               // Boost, kPa absolute
+    {60000, 10000, 5000, 1.0f, 50.0f},               // IAT
+    {60000, 10000, 5000, 1.0f, 100.0f},              // Oil
+    {60000, 10000, 5000, 1.0f, 100.0f},              // Coolant
+    {3000, 1000, 2000, 5.0f, STATS_NO_THRESHOLD},    // Timing
+    {3000, 1000, 2000, 2000.0f, STATS_NO_THRESHOLD}, // HPFP, kPa
+};
+
+// Indexed by Channel_t. Only the fast channels are animated between samples.
+// Beta below 1 keeps one noisy sample from setting the whole rate; tuned with
+// tools/estimator_check
+const EstimatorConfig_t xVehicleEstimators[CHANNEL_COUNT] = {
+    // Alpha, beta, max rate per s, horizon ms, margin, valid min and max
+    {1.0f, 0.8f, 600.0f, 500, 10.0f, 0.0f, 255.0f}, // Boost, kPa
+    {1.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0.0f},        // IAT
+    {1.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0.0f},        // Oil
+    {1.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0.0f},        // Coolant
+    {1.0f, 0.8f, 60.0f, 500, 1.0f, -64.0f, 63.5f},  // Timing, degrees
+    {1.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 0.0f},        // HPFP
+};
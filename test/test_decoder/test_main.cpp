@@ -0,0 +1,164 @@
+#include <unity.h>
+
+#include <string.h>
+#include "obd.h"
+#include "can_decoder.h"
+
+static const uint8_t ucPids[] = {PID_INTAKE_MANIFOLD_PRESSURE, PID_TIMING_ADVANCE, PID_FUEL_RAIL_GAUGE_PRESSURE, PID_INTAKE_AIR_TEMP};
+#define PID_COUNT (sizeof(ucPids) / sizeof(ucPids[0]))
+
+static ObdPidValue_t xValues[OBD_MULTI_PID_MAX];
+
+void setUp(void)
+{
+    memset(xValues, 0, sizeof(xValues));
+    for (register uint8_t i = 0; i < PID_COUNT; i++)
+        xValues[i].ucPid = ucPids[i];
+}
+
+void tearDown(void)
+{
+}
+
+static uint8_t ucParse(const char *pcAnswer, bool bHeaders)
+{
+    return ucObdParseMultiPidResponse(pcAnswer, "010B0E230F", bHeaders, xValues, PID_COUNT);
+}
+
+static void vAssertBatch(void)
+{
+    for (register uint8_t i = 0; i < PID_COUNT; i++)
+    {
+        TEST_ASSERT_TRUE(xValues[i].bPresent);
+        TEST_ASSERT_TRUE(xValues[i].bValid);
+    }
+
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, xValues[0].fValue); // 0x64 kPa
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 8.0f, xValues[1].fValue);   // 0x90 / 2 - 64 degrees
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 3000.0f, xValues[2].fValue); // 0x012C * 10 kPa
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, xValues[3].fValue);   // 0x46 - 40 degrees C
+}
+
+// The same two frame answer in each format the ELM327 prints it in
+void test_isotp_headers_off_with_spaces(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(PID_COUNT, ucParse("00A\r0: 41 0B 64 0E 90 23\r1: 01 2C 0F 46 00 00 00\r\r>", false));
+    vAssertBatch();
+}
+
+void test_isotp_headers_off_without_spaces(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(PID_COUNT, ucParse("00A\r0:410B640E9023\r1:012C0F46000000\r\r>", false));
+    vAssertBatch();
+}
+
+void test_isotp_headers_on(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(PID_COUNT, ucParse("7E8 10 0A 41 0B 64 0E 90 23\r7E8 21 01 2C 0F 46 00 00 00\r\r>", true));
+    vAssertBatch();
+}
+
+void test_isotp_echo_is_skipped(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(PID_COUNT, ucParse("010B0E230F\r00A\r0: 41 0B 64 0E 90 23\r1: 01 2C 0F 46 00 00 00\r\r>", false));
+    vAssertBatch();
+}
+
+void test_isotp_missing_consecutive_frame(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, ucParse("00A\r0: 41 0B 64 0E 90 23\r\r>", false));
+    TEST_ASSERT_FALSE(xValues[0].bPresent);
+}
+
+void test_isotp_out_of_sequence(void)
+{
+    IsoTpMessage_t xMessage;
+
+    vIsoTpStart(&xMessage);
+    TEST_ASSERT_EQUAL(DECODE_OK, xIsoTpFeedLine(&xMessage, "7E8 10 0A 41 0B 64 0E 90 23", 27, true));
+    TEST_ASSERT_EQUAL(DECODE_BAD_SEQUENCE, xIsoTpFeedLine(&xMessage, "7E8 22 01 2C 0F 46 00 00 00", 27, true));
+    TEST_ASSERT_FALSE(bIsoTpComplete(&xMessage));
+}
+
+void test_single_frame_answer(void)
+{
+    uint8_t ucRpm[] = {PID_ENGINE_SPEED};
+    ObdPidValue_t xRpm;
+
+    xRpm.ucPid = PID_ENGINE_SPEED;
+    TEST_ASSERT_EQUAL_UINT8(1, ucObdParseMultiPidResponse("41 0C 1A F8\r\r>", "010C", false, &xRpm, 1));
+    TEST_ASSERT_TRUE(xRpm.bValid);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1726.0f, xRpm.fValue); // 0x1AF8 / 4
+    TEST_ASSERT_EQUAL_UINT8(1, ucObdExpectedFrames(ucRpm, 1));
+}
+
+// Only the PID the ECU left out is missing, the others still decode
+void test_pid_left_out(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(2, ucParse("41 0B 64 0F 46\r\r>", false));
+    TEST_ASSERT_TRUE(xValues[0].bPresent);
+    TEST_ASSERT_FALSE(xValues[1].bPresent);
+    TEST_ASSERT_FALSE(xValues[2].bPresent);
+    TEST_ASSERT_TRUE(xValues[3].bPresent);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, xValues[3].fValue);
+}
+
+void test_no_data(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, ucParse("NO DATA\r\r>", false));
+    TEST_ASSERT_FALSE(xValues[0].bPresent);
+}
+
+// A first frame carries 6 payload bytes, each consecutive frame 7
+void test_expected_frames(void)
+{
+    uint8_t ucLong[] = {PID_ENGINE_SPEED, PID_ENGINE_SPEED, PID_ENGINE_SPEED, PID_ENGINE_SPEED, PID_ENGINE_SPEED};
+
+    TEST_ASSERT_EQUAL_UINT8(2, ucObdExpectedFrames(ucPids, PID_COUNT)); // 10 bytes
+    TEST_ASSERT_EQUAL_UINT8(3, ucObdExpectedFrames(ucLong, 5));        // 16 bytes
+    TEST_ASSERT_EQUAL_UINT8(2, ucObdExpectedFrames(ucLong, 4));        // 13 bytes
+}
+
+void test_support_bitmap(void)
+{
+    ObdResponse_t xResponse;
+    uint8_t ucSupported[OBD_SUPPORT_BYTES];
+
+    memset(ucSupported, 0, sizeof(ucSupported));
+    vObdResponseStart(&xResponse, "0100", false);
+    vObdResponseFeedLine(&xResponse, "41 00 BE 1F A8 13", 17);
+
+    TEST_ASSERT_TRUE(bObdResponseSupport(&xResponse, 0x00, ucSupported));
+    TEST_ASSERT_TRUE(bObdPidSupported(ucSupported, 0x01));
+    TEST_ASSERT_FALSE(bObdPidSupported(ucSupported, 0x02));
+    TEST_ASSERT_TRUE(bObdPidSupported(ucSupported, PID_ENGINE_SPEED));
+    TEST_ASSERT_FALSE(bObdPidSupported(ucSupported, PID_INTAKE_MANIFOLD_PRESSURE));
+    TEST_ASSERT_TRUE(bObdPidSupported(ucSupported, 0x20)); // The next range is listed
+    TEST_ASSERT_FALSE(bObdResponseSupport(&xResponse, 0x20, ucSupported));
+}
+
+void test_pid_table_lookup(void)
+{
+    for (register uint8_t i = 0; i < ucObdPidCount(); i++)
+        TEST_ASSERT_TRUE(pxObdFindPid(pxObdPidAt(i)->ucPid) == pxObdPidAt(i));
+
+    TEST_ASSERT_NULL(pxObdFindPid(0x02));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_isotp_headers_off_with_spaces);
+    RUN_TEST(test_isotp_headers_off_without_spaces);
+    RUN_TEST(test_isotp_headers_on);
+    RUN_TEST(test_isotp_echo_is_skipped);
+    RUN_TEST(test_isotp_missing_consecutive_frame);
+    RUN_TEST(test_isotp_out_of_sequence);
+    RUN_TEST(test_single_frame_answer);
+    RUN_TEST(test_pid_left_out);
+    RUN_TEST(test_no_data);
+    RUN_TEST(test_expected_frames);
+    RUN_TEST(test_support_bitmap);
+    RUN_TEST(test_pid_table_lookup);
+    return UNITY_END();
+}
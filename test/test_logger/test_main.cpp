@@ -0,0 +1,165 @@
+#include <unity.h>
+
+#include <string.h>
+#include "logger.h"
+
+#define FILE_MAX (LOGGER_FILE_HEADER_SIZE + (LOGGER_BLOCK_COUNT * LOGGER_BLOCK_SIZE))
+
+// The log file in RAM
+typedef struct
+{
+    uint8_t ucData[FILE_MAX];
+    size_t xLength;
+    size_t xReadOffset;
+} MemoryFile_t;
+
+static MemoryFile_t xFile;
+static Logger_t xLogger;
+
+static size_t xFileAppend(void *pvContext, const uint8_t *pucData, size_t xLength)
+{
+    MemoryFile_t *pxFile = (MemoryFile_t *)pvContext;
+
+    if (pxFile->xLength + xLength > FILE_MAX)
+        xLength = FILE_MAX - pxFile->xLength;
+
+    memcpy(&pxFile->ucData[pxFile->xLength], pucData, xLength);
+    pxFile->xLength += xLength;
+
+    return xLength;
+}
+
+static size_t xFileRead(void *pvContext, uint8_t *pucData, size_t xLength)
+{
+    MemoryFile_t *pxFile = (MemoryFile_t *)pvContext;
+
+    if (pxFile->xReadOffset + xLength > pxFile->xLength)
+        xLength = pxFile->xLength - pxFile->xReadOffset;
+
+    memcpy(pucData, &pxFile->ucData[pxFile->xReadOffset], xLength);
+    pxFile->xReadOffset += xLength;
+
+    return xLength;
+}
+
+static const HalStorage_t xStorage = {&xFile, xFileAppend, xFileRead};
+
+void setUp(void)
+{
+    memset(&xFile, 0, sizeof(xFile));
+    vLoggerInit(&xLogger, &xStorage);
+}
+
+void tearDown(void)
+{
+}
+
+static float fSample(uint32_t i)
+{
+    return (float)((int32_t)(i * 37 % 400) - 150) / 4.0f; // Steps of 0.25, negative as well
+}
+
+void test_round_trip(void)
+{
+    LogReader_t xReader;
+    LogSample_t xSample;
+    uint32_t ulCount = 0;
+
+    for (uint32_t i = 0; i < 100; i++)
+        bLoggerAppend(&xLogger, i % CHANNEL_COUNT, fSample(i), 1000 + i * 20);
+    bLoggerSeal(&xLogger);
+    TEST_ASSERT_EQUAL_UINT32(1, ulLoggerFlush(&xLogger));
+
+    TEST_ASSERT_TRUE(bLogReaderOpen(&xReader, &xStorage));
+    TEST_ASSERT_EQUAL_UINT8(CHANNEL_COUNT, xReader.ucChannelCount);
+
+    while (bLogReaderNext(&xReader, &xSample))
+    {
+        TEST_ASSERT_EQUAL_UINT32(1000 + ulCount * 20, xSample.ulTimestampMs);
+        TEST_ASSERT_EQUAL_UINT8(ulCount % CHANNEL_COUNT, xSample.ucChannel);
+        TEST_ASSERT_FLOAT_WITHIN(0.005f, fSample(ulCount), xSample.fValue);
+        ulCount++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(100, ulCount);
+    TEST_ASSERT_EQUAL_UINT32(0, xReader.ulBadBlocks);
+}
+
+// Blocks fill up and age out; each one starts its deltas over
+void test_round_trip_across_blocks(void)
+{
+    LogReader_t xReader;
+    LogSample_t xSample;
+    uint32_t ulCount = 0;
+
+    for (uint32_t i = 0; i < 300; i++)
+        bLoggerAppend(&xLogger, CHANNEL_BOOST, 100.0f + i * 0.01f, i * 100);
+    bLoggerSeal(&xLogger);
+    ulLoggerFlush(&xLogger);
+
+    TEST_ASSERT_GREATER_THAN(1, xLogger.ulWritten);
+    TEST_ASSERT_TRUE(bLogReaderOpen(&xReader, &xStorage));
+
+    while (bLogReaderNext(&xReader, &xSample))
+    {
+        TEST_ASSERT_EQUAL_UINT32(ulCount * 100, xSample.ulTimestampMs);
+        TEST_ASSERT_FLOAT_WITHIN(0.005f, 100.0f + ulCount * 0.01f, xSample.fValue);
+        ulCount++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(300, ulCount);
+    TEST_ASSERT_EQUAL_UINT32(xLogger.ulWritten, xReader.ulBlocks);
+}
+
+// A block torn by a power cut is skipped, the next one still decodes
+void test_damaged_block_is_skipped(void)
+{
+    LogReader_t xReader;
+    LogSample_t xSample;
+
+    bLoggerAppend(&xLogger, CHANNEL_IAT, 25.0f, 0);
+    bLoggerSeal(&xLogger);
+    bLoggerAppend(&xLogger, CHANNEL_IAT, 26.5f, 500);
+    bLoggerSeal(&xLogger);
+    TEST_ASSERT_EQUAL_UINT32(2, ulLoggerFlush(&xLogger));
+
+    memset(&xFile.ucData[LOGGER_FILE_HEADER_SIZE + 4], 0xFF, 2); // The first block's length
+
+    TEST_ASSERT_TRUE(bLogReaderOpen(&xReader, &xStorage));
+    TEST_ASSERT_TRUE(bLogReaderNext(&xReader, &xSample));
+    TEST_ASSERT_EQUAL_UINT32(500, xSample.ulTimestampMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 26.5f, xSample.fValue);
+    TEST_ASSERT_FALSE(bLogReaderNext(&xReader, &xSample));
+    TEST_ASSERT_EQUAL_UINT32(1, xReader.ulBadBlocks);
+}
+
+// Without the writer the ring fills and drops instead of blocking
+void test_full_ring_drops(void)
+{
+    for (uint32_t i = 0; xLogger.ulDropped == 0; i++)
+        bLoggerAppend(&xLogger, CHANNEL_BOOST, (float)(i % 2), i * 10);
+
+    TEST_ASSERT_EQUAL_UINT32(LOGGER_BLOCK_COUNT, xLogger.ulSealed - xLogger.ulWritten);
+    TEST_ASSERT_EQUAL_UINT32(LOGGER_BLOCK_COUNT, ulLoggerFlush(&xLogger));
+    TEST_ASSERT_EQUAL_UINT32(0, xLogger.ulWriteErrors);
+}
+
+void test_foreign_file_is_refused(void)
+{
+    LogReader_t xReader;
+
+    xFileAppend(&xFile, (const uint8_t *)"RIFF\x01\x06\x00\x02", LOGGER_FILE_HEADER_SIZE);
+
+    TEST_ASSERT_FALSE(bLogReaderOpen(&xReader, &xStorage));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_round_trip_across_blocks);
+    RUN_TEST(test_damaged_block_is_skipped);
+    RUN_TEST(test_full_ring_drops);
+    RUN_TEST(test_foreign_file_is_refused);
+    return UNITY_END();
+}
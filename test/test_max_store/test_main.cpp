@@ -0,0 +1,122 @@
+#include <unity.h>
+
+#include <string.h>
+#include "max_store.h"
+#include "native_hal.h"
+
+#define KEPT_BITS ((1UL << CHANNEL_BOOST) | (1UL << CHANNEL_IAT))
+
+static KeyValue_t xNvsData;
+static const HalKeyValue_t xNvs = {&xNvsData, bKeyValueLoad, bKeyValueStore};
+static MaxStore_t xStore;
+
+void setUp(void)
+{
+    memset(&xNvsData, 0, sizeof(xNvsData));
+    vMaxStoreInit(&xStore, &xNvs, KEPT_BITS);
+    bMaxStoreLoad(&xStore, 0);
+}
+
+void tearDown(void)
+{
+}
+
+// Values every 100 ms with the max rising by fStep each time, from ulFrom to ulTo
+static void vDrive(uint32_t ulFrom, uint32_t ulTo, float fStart, float fStep)
+{
+    float fMax = fStart;
+
+    for (uint32_t ulNow = ulFrom; ulNow < ulTo; ulNow += 100)
+    {
+        vMaxStoreUpdate(&xStore, CHANNEL_BOOST, fMax, ulNow);
+        bMaxStoreService(&xStore, ulNow);
+        fMax += fStep;
+    }
+}
+
+void test_boot_commits_the_session(void)
+{
+    MaxStore_t xNext;
+
+    TEST_ASSERT_EQUAL_UINT32(1, xStore.ulCommits);
+    TEST_ASSERT_EQUAL_UINT32(1, xStore.xRecord.ulSessions);
+
+    vMaxStoreInit(&xNext, &xNvs, KEPT_BITS);
+    TEST_ASSERT_TRUE(bMaxStoreLoad(&xNext, 0));
+    TEST_ASSERT_EQUAL_UINT32(2, xNext.xRecord.ulSessions);
+}
+
+// A max that keeps rising is written at most every MAX_STORE_MIN_INTERVAL_MS
+void test_rising_max_is_rate_limited(void)
+{
+    vDrive(0, 3600000, 100.0f, 0.01f);
+
+    TEST_ASSERT_LESS_OR_EQUAL(1 + 3600000 / MAX_STORE_MIN_INTERVAL_MS, xStore.ulCommits);
+    TEST_ASSERT_GREATER_THAN(1, xStore.ulCommits);
+}
+
+// Small rises wait for MAX_STORE_PERIOD_MS
+void test_small_change_waits_for_the_period(void)
+{
+    vDrive(0, MAX_STORE_MIN_INTERVAL_MS + 1000, 100.0f, 0.0f);
+    TEST_ASSERT_EQUAL_UINT32(2, xStore.ulCommits); // Boot, then the first value
+
+    vMaxStoreUpdate(&xStore, CHANNEL_BOOST, 101.0f, 200000);
+    vDrive(200000, 200000 + MAX_STORE_PERIOD_MS - 1000, 101.0f, 0.0f);
+    TEST_ASSERT_EQUAL_UINT32(2, xStore.ulCommits);
+
+    vDrive(200000 + MAX_STORE_PERIOD_MS, 200000 + MAX_STORE_PERIOD_MS + 1000, 101.0f, 0.0f);
+    TEST_ASSERT_EQUAL_UINT32(3, xStore.ulCommits);
+}
+
+// The ECU going quiet ends the drive, a pending change is written then
+void test_quiet_commits_pending_change(void)
+{
+    vDrive(0, MAX_STORE_MIN_INTERVAL_MS + 1000, 100.0f, 0.0f);
+    vDrive(200000, 201000, 101.0f, 0.0f);
+    TEST_ASSERT_TRUE(xStore.bDirty);
+
+    TEST_ASSERT_FALSE(bMaxStoreService(&xStore, 201000 + MAX_STORE_QUIET_MS - 200));
+    TEST_ASSERT_TRUE(bMaxStoreService(&xStore, 201000 + MAX_STORE_QUIET_MS));
+    TEST_ASSERT_FALSE(xStore.bDirty);
+}
+
+void test_untracked_channel_is_ignored(void)
+{
+    float fMax;
+
+    vMaxStoreUpdate(&xStore, CHANNEL_TIMING, 20.0f, 100);
+
+    TEST_ASSERT_FALSE(xStore.bDirty);
+    TEST_ASSERT_FALSE(bMaxStoreGet(&xStore, CHANNEL_TIMING, &fMax));
+}
+
+void test_clear_is_kept(void)
+{
+    MaxStore_t xNext;
+    float fMax;
+
+    vMaxStoreUpdate(&xStore, CHANNEL_IAT, 45.0f, 100);
+    vMaxStoreUpdate(&xStore, CHANNEL_BOOST, 150.0f, 100);
+    bMaxStoreCommit(&xStore, 100);
+    vMaxStoreClear(&xStore, 1UL << CHANNEL_IAT, 200);
+    bMaxStoreCommit(&xStore, 200);
+
+    vMaxStoreInit(&xNext, &xNvs, KEPT_BITS);
+    bMaxStoreLoad(&xNext, 0);
+    TEST_ASSERT_FALSE(bMaxStoreGet(&xNext, CHANNEL_IAT, &fMax));
+    TEST_ASSERT_TRUE(bMaxStoreGet(&xNext, CHANNEL_BOOST, &fMax));
+    TEST_ASSERT_EQUAL_FLOAT(150.0f, fMax);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_commits_the_session);
+    RUN_TEST(test_rising_max_is_rate_limited);
+    RUN_TEST(test_small_change_waits_for_the_period);
+    RUN_TEST(test_quiet_commits_pending_change);
+    RUN_TEST(test_untracked_channel_is_ignored);
+    RUN_TEST(test_clear_is_kept);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+#include <unity.h>
+
+#include "scheduler.h"
+
+#define JOB_COUNT 3
+
+static PidSchedule_t xJobs[JOB_COUNT];
+static Scheduler_t xScheduler;
+
+void setUp(void)
+{
+    xJobs[0] = SCHED_JOB("Boost", 0x0B, 100, 3, 300);
+    xJobs[1] = SCHED_JOB("IAT", 0x0F, 1000, 1, 3000);
+    xJobs[2] = SCHED_JOB("Unlisted", 0x5C, 200, 2, 600);
+    vSchedulerInit(&xScheduler, xJobs, JOB_COUNT, 6, 0);
+}
+
+void tearDown(void)
+{
+}
+
+// Earliest deadline first, the priority breaks ties
+void test_edf_order(void)
+{
+    TEST_ASSERT_EQUAL_INT8(0, cSchedulerNext(&xScheduler, 0));
+
+    vSchedulerComplete(&xScheduler, 0, SCHED_RESULT_OK, 10);
+    TEST_ASSERT_EQUAL_INT8(2, cSchedulerNext(&xScheduler, 10));
+    TEST_ASSERT_EQUAL_UINT32(100, xJobs[0].ulRelease);
+    TEST_ASSERT_EQUAL_UINT32(310, xJobs[0].ulDeadline);
+}
+
+void test_batch_takes_jobs_due_soon(void)
+{
+    int8_t cBatch[6];
+
+    vSchedulerComplete(&xScheduler, 1, SCHED_RESULT_OK, 0); // Next release at 1000
+    TEST_ASSERT_EQUAL_UINT8(2, ucSchedulerCollectBatch(&xScheduler, 0, 0, cBatch));
+    TEST_ASSERT_EQUAL_UINT8(3, ucSchedulerCollectBatch(&xScheduler, 0, 500, cBatch));
+}
+
+// Doubling from the period up to SCHED_BACKOFF_MAX_MS
+void test_backoff(void)
+{
+    const uint32_t ulExpected[] = {100, 200, 400, 800, 1600, 3200, SCHED_BACKOFF_MAX_MS, SCHED_BACKOFF_MAX_MS};
+    uint32_t ulNow = 0;
+
+    xJobs[0].bAnswered = true; // Answered once, so it is never set aside
+
+    for (register uint8_t i = 0; i < sizeof(ulExpected) / sizeof(ulExpected[0]); i++)
+    {
+        vSchedulerComplete(&xScheduler, 0, SCHED_RESULT_NO_ANSWER, ulNow);
+        TEST_ASSERT_EQUAL_UINT32(ulNow + ulExpected[i], xJobs[0].ulRelease);
+        ulNow = xJobs[0].ulRelease;
+    }
+
+    TEST_ASSERT_FALSE(xJobs[0].bQuarantined);
+
+    vSchedulerComplete(&xScheduler, 0, SCHED_RESULT_OK, ulNow);
+    TEST_ASSERT_EQUAL_UINT8(0, xJobs[0].ucUnanswered);
+    TEST_ASSERT_EQUAL_UINT32(ulNow + 100, xJobs[0].ulRelease);
+}
+
+// A failed exchange says nothing about the PID: no backoff, no quarantine
+void test_link_failure_does_not_back_off(void)
+{
+    for (register uint8_t i = 0; i < 2 * SCHED_QUARANTINE_FAILURES; i++)
+        vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_LINK_FAILED, i * 200);
+
+    TEST_ASSERT_EQUAL_UINT8(0, xJobs[2].ucUnanswered);
+    TEST_ASSERT_FALSE(xJobs[2].bQuarantined);
+    TEST_ASSERT_EQUAL_UINT32(2000, xJobs[2].ulRelease);
+}
+
+void test_quarantine_after_misses(void)
+{
+    uint32_t ulNow = 0;
+
+    for (register uint8_t i = 0; i < SCHED_QUARANTINE_FAILURES; i++)
+    {
+        TEST_ASSERT_FALSE(xJobs[2].bQuarantined);
+        vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_NO_ANSWER, ulNow);
+        ulNow = xJobs[2].ulRelease;
+    }
+
+    TEST_ASSERT_TRUE(xJobs[2].bQuarantined);
+    TEST_ASSERT_EQUAL_UINT8(1, ucSchedulerQuarantined(&xScheduler));
+
+    // Still asked now and then, and back once it answers
+    uint32_t ulSetAside = ulNow;
+
+    vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_NO_ANSWER, ulSetAside);
+    TEST_ASSERT_EQUAL_UINT32(ulSetAside + SCHED_QUARANTINE_RETRY_MS, xJobs[2].ulRelease);
+
+    vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_OK, xJobs[2].ulRelease);
+    TEST_ASSERT_FALSE(xJobs[2].bQuarantined);
+    TEST_ASSERT_EQUAL_UINT8(0, ucSchedulerQuarantined(&xScheduler));
+}
+
+// A PID that answered once only backs off
+void test_no_quarantine_once_answered(void)
+{
+    vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_OK, 0);
+
+    for (register uint8_t i = 0; i < 2 * SCHED_QUARANTINE_FAILURES; i++)
+        vSchedulerComplete(&xScheduler, 2, SCHED_RESULT_NO_ANSWER, xJobs[2].ulRelease);
+
+    TEST_ASSERT_FALSE(xJobs[2].bQuarantined);
+}
+
+// With the supported PIDs read, only the list sets a PID aside
+void test_support_list_sets_aside(void)
+{
+    xScheduler.bSupportKnown = true;
+    vSchedulerSetAside(&xScheduler, 2, 0);
+
+    TEST_ASSERT_TRUE(xJobs[2].bQuarantined);
+    TEST_ASSERT_EQUAL_UINT32(SCHED_QUARANTINE_RETRY_MS, xJobs[2].ulRelease);
+
+    uint32_t ulNow = 0;
+
+    for (register uint8_t i = 0; i < 2 * SCHED_QUARANTINE_FAILURES; i++)
+    {
+        ulNow = xJobs[1].ulRelease;
+        vSchedulerComplete(&xScheduler, 1, SCHED_RESULT_NO_ANSWER, ulNow);
+    }
+
+    TEST_ASSERT_FALSE(xJobs[1].bQuarantined);
+    TEST_ASSERT_EQUAL_UINT32(ulNow + SCHED_BACKOFF_MAX_MS, xJobs[1].ulRelease);
+}
+
+void test_idle_until_next_release(void)
+{
+    for (register int8_t i = 0; i < JOB_COUNT; i++)
+        vSchedulerComplete(&xScheduler, i, SCHED_RESULT_OK, 0);
+
+    TEST_ASSERT_EQUAL_INT8(SCHED_NO_JOB, cSchedulerNext(&xScheduler, 50));
+    TEST_ASSERT_EQUAL_UINT32(50, ulSchedulerIdleMs(&xScheduler, 50));
+    TEST_ASSERT_EQUAL_UINT32(0, ulSchedulerIdleMs(&xScheduler, 100));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_edf_order);
+    RUN_TEST(test_batch_takes_jobs_due_soon);
+    RUN_TEST(test_backoff);
+    RUN_TEST(test_link_failure_does_not_back_off);
+    RUN_TEST(test_quarantine_after_misses);
+    RUN_TEST(test_no_quarantine_once_answered);
+    RUN_TEST(test_support_list_sets_aside);
+    RUN_TEST(test_idle_until_next_release);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+// Host-side microbenchmark for the ELM response decoder
+//
+//   g++ -O2 -std=gnu++11 -Wno-register -Iinclude tools/decoder_bench.cpp src/can_decoder.cpp src/obd.cpp -o decoder_bench
+//   ./decoder_bench [iterations]
+//
+// Decodes the same multi-PID answer in every output format the adapter can
+// be configured for, then feeds randomly corrupted copies to check that
+// damaged frames are rejected instead of producing readings.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "obd.h"
+
+typedef struct
+{
+    const char *pcName;
+    const char *pcResponse;
+    bool bHeaders;
+} Sample_t;
+
+static const char *pcRequest = "010B0E230F";
+static const uint8_t ucPids[] = {PID_INTAKE_MANIFOLD_PRESSURE, PID_TIMING_ADVANCE, PID_FUEL_RAIL_GAUGE_PRESSURE, PID_INTAKE_AIR_TEMP};
+static const uint8_t ucPidCount = sizeof(ucPids);
+
+static const Sample_t xSamples[] = {
+    {"H0 S1 echo", "010B0E230F\r00A\r0: 41 0B 64 0E 90 23\r1: 01 2C 0F 46 00 00 00\r\r>", false},
+    {"H0 S1", "00A\r0: 41 0B 64 0E 90 23\r1: 01 2C 0F 46 00 00 00\r\r>", false},
+    {"H0 S0", "00A\r0:410B640E9023\r1:012C0F46000000\r\r>", false},
+    {"H1 S1", "7E8 10 0A 41 0B 64 0E 90 23\r7E8 21 01 2C 0F 46 00 00 00\r\r>", true},
+    {"H1 S0", "7E8100A410B640E9023\r7E821012C0F46000000\r\r>", true},
+};
+
+static uint8_t ucDecode(const char *pcResponse, bool bHeaders, ObdPidValue_t *pxValues)
+{
+    for (uint8_t i = 0; i < ucPidCount; i++)
+        pxValues[i].ucPid = ucPids[i];
+
+    return ucObdParseMultiPidResponse(pcResponse, pcRequest, bHeaders, pxValues, ucPidCount);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long ulIterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    ObdPidValue_t xValues[OBD_MULTI_PID_MAX];
+    ObdPidValue_t xReference[OBD_MULTI_PID_MAX];
+    volatile uint32_t ulSink = 0;
+
+    ucDecode(xSamples[0].pcResponse, xSamples[0].bHeaders, xReference);
+
+    printf("%-12s %10s %8s\n", "format", "ns/frame", "values");
+
+    for (size_t s = 0; s < sizeof(xSamples) / sizeof(xSamples[0]); s++)
+    {
+        auto xStart = std::chrono::steady_clock::now();
+
+        for (unsigned long n = 0; n < ulIterations; n++)
+            ulSink += ucDecode(xSamples[s].pcResponse, xSamples[s].bHeaders, xValues);
+
+        auto xEnd = std::chrono::steady_clock::now();
+        double dNs = std::chrono::duration<double, std::nano>(xEnd - xStart).count() / ulIterations;
+
+        printf("%-12s %10.1f %8u\n", xSamples[s].pcName, dNs, ucDecode(xSamples[s].pcResponse, xSamples[s].bHeaders, xValues));
+    }
+
+    // Corruption pass: drop, insert or replace one character and count values
+    // that still decode but differ from the reference. A hex digit replaced by
+    // another one cannot be detected (the ELM text has no checksum), so those
+    // mutations are left out of the garbage count
+    unsigned long ulAccepted = 0;
+    unsigned long ulGarbage = 0;
+    char cBuffer[128];
+
+    srand(1);
+
+    for (unsigned long n = 0; n < ulIterations / 10; n++)
+    {
+        const Sample_t *pxSample = &xSamples[n % (sizeof(xSamples) / sizeof(xSamples[0]))];
+        size_t xLength = strlen(pxSample->pcResponse);
+        size_t xPosition = rand() % xLength;
+        static const char cAlphabet[] = "0123456789ABCDEF :\r>";
+        char cRandom = cAlphabet[rand() % (sizeof(cAlphabet) - 1)];
+
+        memcpy(cBuffer, pxSample->pcResponse, xLength + 1);
+
+        bool bUndetectable = false;
+
+        switch (rand() % 3)
+        {
+        case 0:
+            bUndetectable = (cHexLut[(uint8_t)cBuffer[xPosition]] >= 0) && (cHexLut[(uint8_t)cRandom] >= 0);
+            cBuffer[xPosition] = cRandom;
+            break;
+        case 1:
+            memmove(&cBuffer[xPosition], &cBuffer[xPosition + 1], xLength - xPosition);
+            break;
+        default:
+            memmove(&cBuffer[xPosition + 1], &cBuffer[xPosition], xLength - xPosition + 1);
+            cBuffer[xPosition] = cRandom;
+            break;
+        }
+
+        ucDecode(cBuffer, pxSample->bHeaders, xValues);
+
+        for (uint8_t i = 0; i < ucPidCount; i++)
+        {
+            if (!xValues[i].bValid)
+                continue;
+
+            ulAccepted++;
+            ulGarbage += !bUndetectable && (xValues[i].fValue != xReference[i].fValue);
+        }
+    }
+
+    printf("corrupted: %lu values accepted, %lu differ from the reference\n", ulAccepted, ulGarbage);
+
+    return ulSink == 0;
+}
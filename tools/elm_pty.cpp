@@ -0,0 +1,114 @@
+// Serves the native ELM327 emulator on a pseudo terminal, in real time
+//
+//   g++ -O2 -std=gnu++11 -Wno-register -Iinclude -Isrc/native tools/elm_pty.cpp src/native/elm_emulator.cpp src/vehicle.cpp src/obd.cpp src/can_decoder.cpp -o elm_pty
+//   ./elm_pty [emulator options]
+//
+// Prints the slave path, which any serial client can open: the native build
+// with --port, a terminal program, or a PC OBD tool. Ctrl-C prints the
+// emulator counters.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "elm_emulator.h"
+
+static volatile sig_atomic_t bStop = 0;
+
+static void vOnSignal(int iSignal)
+{
+    bStop = 1;
+}
+
+static uint32_t ulNowMs(void)
+{
+    struct timespec xTime;
+
+    clock_gettime(CLOCK_MONOTONIC, &xTime);
+    return (uint32_t)(xTime.tv_sec * 1000 + xTime.tv_nsec / 1000000);
+}
+
+int main(int argc, char **argv)
+{
+    ElmEmulatorConfig_t xConfig;
+    static ElmEmulator_t xEmulator;
+
+    vElmEmulatorDefaults(&xConfig);
+    for (int i = 1; i < argc;)
+    {
+        int iNext = iElmEmulatorParseOption(&xConfig, argc, argv, i);
+
+        if (iNext == i)
+        {
+            printf("usage: %s [options]\n%s", argv[0], pcElmEmulatorUsage());
+            return 2;
+        }
+        i = iNext;
+    }
+
+    if (!bElmEmulatorInit(&xEmulator, &xConfig))
+    {
+        printf("cannot load %s\n", xConfig.pcReplayPath);
+        return 2;
+    }
+
+    int iMaster = posix_openpt(O_RDWR | O_NOCTTY);
+    struct termios xTermios;
+
+    if ((iMaster < 0) || (grantpt(iMaster) != 0) || (unlockpt(iMaster) != 0))
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+
+    // Raw, so CR reaches the emulator as CR and nothing is echoed twice
+    tcgetattr(iMaster, &xTermios);
+    cfmakeraw(&xTermios);
+    tcsetattr(iMaster, TCSANOW, &xTermios);
+    fcntl(iMaster, F_SETFL, O_NONBLOCK);
+
+    printf("%s\n", ptsname(iMaster));
+    fflush(stdout);
+
+    signal(SIGINT, vOnSignal);
+    signal(SIGTERM, vOnSignal);
+
+    while (!bStop)
+    {
+        uint32_t ulDue = ulElmEmulatorNextDue(&xEmulator, ulNowMs());
+        int iTimeout = (ulDue == ELM_EMULATOR_NOTHING_DUE) ? 100 : (int)ulDue;
+        struct pollfd xPoll = {iMaster, POLLIN, 0};
+        char cBuffer[256];
+        ssize_t xRead;
+        size_t xPending;
+
+        if (iTimeout > 100)
+            iTimeout = 100;
+
+        poll(&xPoll, 1, iTimeout);
+
+        // Without a client the read fails with EIO until the slave is opened
+        while ((xRead = read(iMaster, cBuffer, sizeof(cBuffer))) > 0)
+            vElmEmulatorWrite(&xEmulator, cBuffer, xRead, ulNowMs());
+
+        if ((xRead < 0) && (errno == EIO))
+            usleep(10000);
+
+        while ((xPending = xElmEmulatorRead(&xEmulator, cBuffer, sizeof(cBuffer), ulNowMs())) > 0)
+        {
+            if (write(iMaster, cBuffer, xPending) < 0)
+                break;
+        }
+    }
+
+    vElmEmulatorPrintStats(&xEmulator);
+    close(iMaster);
+
+    return 0;
+}
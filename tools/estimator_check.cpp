@@ -0,0 +1,185 @@
+// Host-side accuracy check of the display estimator against a session log
+//
+//   g++ -O2 -std=gnu++11 -Wno-register -Iinclude tools/estimator_check.cpp src/estimator.cpp src/logger.cpp src/channels.cpp src/channel_stats.cpp src/vehicle.cpp -o estimator_check
+//   ./estimator_check [--period MS] [--alpha A] [--beta B] [--horizon MS] [--margin M] session.bin
+//
+// The log, recorded at the full poll rate, is the reference. Each estimated
+// channel is thinned to one sample per --period (300 ms, a slow link) and
+// replayed into the estimator, which is read at every ESTIMATOR_FRAME_MS
+// frame as the renderer would. The error against the reference, linearly
+// interpolated between its samples, is printed next to the error of just
+// holding the last sample, which is what the display did before.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "logger.h"
+#include "vehicle.h"
+
+typedef struct
+{
+    uint32_t ulTimeMs;
+    float fValue;
+} Point_t;
+
+typedef struct
+{
+    std::vector<float> xErrors;
+    double dSum;
+} Errors_t;
+
+static size_t xFileRead(void *pvContext, uint8_t *pucData, size_t xLength)
+{
+    return fread(pucData, 1, xLength, (FILE *)pvContext);
+}
+
+static float fReference(const std::vector<Point_t> &xPoints, size_t *pxCursor, uint32_t ulTimeMs)
+{
+    while ((*pxCursor + 1 < xPoints.size()) && (xPoints[*pxCursor + 1].ulTimeMs <= ulTimeMs))
+        (*pxCursor)++;
+
+    const Point_t &xA = xPoints[*pxCursor];
+
+    if ((*pxCursor + 1 >= xPoints.size()) || (ulTimeMs <= xA.ulTimeMs))
+        return xA.fValue;
+
+    const Point_t &xB = xPoints[*pxCursor + 1];
+
+    return xA.fValue + (xB.fValue - xA.fValue) * (float)(ulTimeMs - xA.ulTimeMs) / (float)(xB.ulTimeMs - xA.ulTimeMs);
+}
+
+static void vAdd(Errors_t *pxErrors, float fError)
+{
+    pxErrors->xErrors.push_back(fabsf(fError));
+    pxErrors->dSum += fabsf(fError);
+}
+
+static void vPrint(const char *pcLabel, Errors_t *pxErrors)
+{
+    std::vector<float> &xErrors = pxErrors->xErrors;
+
+    if (xErrors.empty())
+        return;
+
+    std::sort(xErrors.begin(), xErrors.end());
+    printf("  %-9s mean %7.2f  p95 %7.2f  max %7.2f\n", pcLabel, pxErrors->dSum / xErrors.size(),
+           xErrors[xErrors.size() * 95 / 100], xErrors.back());
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ulPeriodMs = 300;
+    const char *pcPath = NULL;
+    EstimatorConfig_t xConfigs[CHANNEL_COUNT];
+    float fAlpha = -1, fBeta = -1;
+    int32_t i32HorizonMs = -1;
+    float fMargin = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--period") == 0) && (i + 1 < argc))
+            ulPeriodMs = strtoul(argv[++i], NULL, 0);
+        else if ((strcmp(argv[i], "--alpha") == 0) && (i + 1 < argc))
+            fAlpha = atof(argv[++i]);
+        else if ((strcmp(argv[i], "--beta") == 0) && (i + 1 < argc))
+            fBeta = atof(argv[++i]);
+        else if ((strcmp(argv[i], "--horizon") == 0) && (i + 1 < argc))
+            i32HorizonMs = strtol(argv[++i], NULL, 0);
+        else if ((strcmp(argv[i], "--margin") == 0) && (i + 1 < argc))
+            fMargin = atof(argv[++i]);
+        else
+            pcPath = argv[i];
+    }
+
+    FILE *pxFile = (pcPath != NULL) ? fopen(pcPath, "rb") : NULL;
+    static LogReader_t xReader;
+
+    if (pxFile == NULL)
+    {
+        fprintf(stderr, "usage: %s [--period MS] [--alpha A] [--beta B] [--horizon MS] [--margin M] session.bin\n", argv[0]);
+        return 2;
+    }
+
+    HalStorage_t xStorage = {pxFile, NULL, xFileRead};
+
+    if (!bLogReaderOpen(&xReader, &xStorage))
+    {
+        fprintf(stderr, "%s is not a session log\n", pcPath);
+        return 1;
+    }
+
+    std::vector<Point_t> xPoints[CHANNEL_COUNT];
+    LogSample_t xSample;
+
+    while (bLogReaderNext(&xReader, &xSample))
+    {
+        if (xSample.ucChannel < CHANNEL_COUNT)
+            xPoints[xSample.ucChannel].push_back((Point_t){xSample.ulTimestampMs, xSample.fValue});
+    }
+    fclose(pxFile);
+
+    printf("Thinned to one sample per %u ms, read every %u ms\n", (unsigned)ulPeriodMs, ESTIMATOR_FRAME_MS);
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        xConfigs[i] = xVehicleEstimators[i];
+        if (fAlpha >= 0)
+            xConfigs[i].fAlpha = fAlpha;
+        if (fBeta >= 0)
+            xConfigs[i].fBeta = fBeta;
+        if (i32HorizonMs >= 0)
+            xConfigs[i].ulHorizonMs = i32HorizonMs;
+        if (fMargin >= 0)
+            xConfigs[i].fMargin = fMargin;
+
+        const std::vector<Point_t> &xReference = xPoints[i];
+
+        if ((xVehicleEstimators[i].ulHorizonMs == 0) || (xReference.size() < 2))
+            continue;
+
+        Estimator_t xEstimator;
+        Errors_t xHold = {};
+        Errors_t xEstimate = {};
+        size_t xNext = 0;
+        size_t xCursor = 0;
+        uint32_t ulKeptMs = 0;
+        uint32_t ulKept = 0;
+        float fHeld = 0;
+        bool bHeld = false;
+
+        vEstimatorInit(&xEstimator, &xConfigs[i]);
+
+        for (uint32_t ulNow = xReference.front().ulTimeMs; ulNow <= xReference.back().ulTimeMs; ulNow += ESTIMATOR_FRAME_MS)
+        {
+            for (; (xNext < xReference.size()) && (xReference[xNext].ulTimeMs <= ulNow); xNext++)
+            {
+                const Point_t &xPoint = xReference[xNext];
+
+                if (bHeld && (xPoint.ulTimeMs - ulKeptMs < ulPeriodMs))
+                    continue;
+
+                vEstimatorUpdate(&xEstimator, xPoint.fValue, xPoint.ulTimeMs);
+                fHeld = xPoint.fValue;
+                ulKeptMs = xPoint.ulTimeMs;
+                bHeld = true;
+                ulKept++;
+            }
+
+            float fTruth = fReference(xReference, &xCursor, ulNow);
+
+            vAdd(&xHold, fHeld - fTruth);
+            vAdd(&xEstimate, fEstimatorAt(&xEstimator, ulNow) - fTruth);
+        }
+
+        printf("%s, %u of %u samples, alpha %.2f beta %.2f horizon %u ms\n", pcChannelName(i), (unsigned)ulKept,
+               (unsigned)xReference.size(), xConfigs[i].fAlpha, xConfigs[i].fBeta, (unsigned)xConfigs[i].ulHorizonMs);
+        vPrint("hold", &xHold);
+        vPrint("estimate", &xEstimate);
+    }
+
+    return 0;
+}
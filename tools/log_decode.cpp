@@ -0,0 +1,186 @@
+// Decodes a session log written by the data logger
+//
+//   g++ -O2 -std=gnu++11 -Wno-register -Iinclude tools/log_decode.cpp src/logger.cpp src/channels.cpp src/channel_stats.cpp src/vehicle.cpp -o log_decode
+//   ./log_decode session.bin > session.csv             time_ms,channel,value per sample
+//   ./log_decode --wide session.bin > session.csv      one column per channel, last value held
+//   ./log_decode --columns DIR session.bin             DIR/<channel>.t.u32 and .v.f32, little endian
+//
+// The column files load directly with numpy.fromfile or as Arrow/Parquet
+// columns. A summary goes to stderr, with each channel's statistics at the
+// end of the log as the display would have had them.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "logger.h"
+#include "vehicle.h"
+
+typedef enum
+{
+    OUTPUT_LONG,
+    OUTPUT_WIDE,
+    OUTPUT_COLUMNS
+} Output_t;
+
+static size_t xFileRead(void *pvContext, uint8_t *pucData, size_t xLength)
+{
+    return fread(pucData, 1, xLength, (FILE *)pvContext);
+}
+
+static void vWriteColumn(const char *pcDirectory, uint8_t ucChannel, const char *pcSuffix, const void *pvData, size_t xBytes)
+{
+    char cPath[512];
+    FILE *pxFile;
+
+    snprintf(cPath, sizeof(cPath), "%s/%s.%s", pcDirectory, pcChannelName(ucChannel), pcSuffix);
+    pxFile = fopen(cPath, "wb");
+    if (pxFile == NULL)
+    {
+        fprintf(stderr, "cannot write %s\n", cPath);
+        return;
+    }
+
+    fwrite(pvData, 1, xBytes, pxFile);
+    fclose(pxFile);
+}
+
+int main(int argc, char **argv)
+{
+    Output_t xOutput = OUTPUT_LONG;
+    const char *pcDirectory = NULL;
+    const char *pcPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--wide") == 0)
+            xOutput = OUTPUT_WIDE;
+        else if ((strcmp(argv[i], "--columns") == 0) && (i + 1 < argc))
+        {
+            xOutput = OUTPUT_COLUMNS;
+            pcDirectory = argv[++i];
+        }
+        else
+            pcPath = argv[i];
+    }
+
+    FILE *pxFile = (pcPath != NULL) ? fopen(pcPath, "rb") : NULL;
+    static LogReader_t xReader;
+
+    if (pxFile == NULL)
+    {
+        fprintf(stderr, "usage: %s [--wide | --columns DIR] session.bin\n", argv[0]);
+        return 2;
+    }
+
+    HalStorage_t xStorage = {pxFile, NULL, xFileRead};
+
+    if (!bLogReaderOpen(&xReader, &xStorage))
+    {
+        fprintf(stderr, "%s is not a session log\n", pcPath);
+        return 1;
+    }
+
+    static char cBuffer[1 << 20];
+    std::vector<uint32_t> xTimes[CHANNEL_COUNT];
+    std::vector<float> xValues[CHANNEL_COUNT];
+    float fHeld[CHANNEL_COUNT] = {};
+    bool bSeen[CHANNEL_COUNT] = {};
+    uint32_t ulFirstMs = 0;
+    uint32_t ulLastMs = 0;
+    uint32_t ulSamples = 0;
+    LogSample_t xSample;
+    static ChannelStats_t xStats[CHANNEL_COUNT];
+    ChannelSummary_t xSummary[CHANNEL_COUNT] = {};
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        vChannelStatsInit(&xStats[i], &xVehicleChannelStats[i]);
+
+    setvbuf(stdout, cBuffer, _IOFBF, sizeof(cBuffer));
+
+    if (xOutput == OUTPUT_LONG)
+        printf("time_ms,channel,value\n");
+    else if (xOutput == OUTPUT_WIDE)
+    {
+        printf("time_ms");
+        for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            printf(",%s", pcChannelName(i));
+        printf("\n");
+    }
+
+    auto xStart = std::chrono::steady_clock::now();
+
+    while (bLogReaderNext(&xReader, &xSample))
+    {
+        if (ulSamples++ == 0)
+            ulFirstMs = xSample.ulTimestampMs;
+        ulLastMs = xSample.ulTimestampMs;
+
+        if (xSample.ucChannel >= CHANNEL_COUNT)
+            continue;
+
+        vChannelStatsAdd(&xStats[xSample.ucChannel], xSample.fValue, xSample.ulTimestampMs, &xSummary[xSample.ucChannel]);
+
+        switch (xOutput)
+        {
+        case OUTPUT_LONG:
+            printf("%u,%s,%.2f\n", (unsigned)xSample.ulTimestampMs, pcChannelName(xSample.ucChannel), xSample.fValue);
+            break;
+        case OUTPUT_WIDE:
+            fHeld[xSample.ucChannel] = xSample.fValue;
+            bSeen[xSample.ucChannel] = true;
+            printf("%u", (unsigned)xSample.ulTimestampMs);
+            for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+            {
+                if (bSeen[i])
+                    printf(",%.2f", fHeld[i]);
+                else
+                    printf(",");
+            }
+            printf("\n");
+            break;
+        case OUTPUT_COLUMNS:
+            xTimes[xSample.ucChannel].push_back(xSample.ulTimestampMs);
+            xValues[xSample.ucChannel].push_back(xSample.fValue);
+            break;
+        }
+    }
+
+    if (xOutput == OUTPUT_COLUMNS)
+    {
+        for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        {
+            vWriteColumn(pcDirectory, i, "t.u32", xTimes[i].data(), xTimes[i].size() * sizeof(uint32_t));
+            vWriteColumn(pcDirectory, i, "v.f32", xValues[i].data(), xValues[i].size() * sizeof(float));
+        }
+    }
+
+    fflush(stdout);
+
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - xStart).count();
+
+    long lBytes = ftell(pxFile);
+
+    fclose(pxFile);
+    fprintf(stderr, "%u samples over %.1f s, %ld bytes (%.2f per sample), %u damaged blocks, decoded in %.3f s\n",
+            (unsigned)ulSamples, (ulLastMs - ulFirstMs) / 1000.0, lBytes,
+            ulSamples > 0 ? (double)lBytes / ulSamples : 0.0, (unsigned)xReader.ulBadBlocks, dSeconds);
+
+    for (register uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        const ChannelSummary_t *pxSummary = &xSummary[i];
+
+        if (!xStats[i].bStarted)
+            continue;
+
+        fprintf(stderr, "%-8s min %.1f max %.1f average %.1f peak %.1f", pcChannelName(i), pxSummary->fMin, pxSummary->fMax,
+                pxSummary->fAverage, pxSummary->fPeak);
+        if (xVehicleChannelStats[i].fThreshold != STATS_NO_THRESHOLD)
+            fprintf(stderr, ", %.1f s above %.0f", pxSummary->ulAboveMs / 1000.0, xVehicleChannelStats[i].fThreshold);
+        fprintf(stderr, "\n");
+    }
+
+    return 0;
+}